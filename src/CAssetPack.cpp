@@ -0,0 +1,233 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <cstdio>
+#include <cstring>
+
+#include "CAssetPack.h"
+#include "CHash.h"
+
+using namespace std;
+
+static bool PadFile(FILE *file, uint64_t alignment)
+{
+	static const uint8_t zeros[PACK_ALIGNMENT] = {};
+
+	long position = ftell(file);
+
+	if (position < 0)
+		return false;
+
+	size_t padding = size_t((alignment - uint64_t(position) % alignment) % alignment);
+
+	return (fwrite(zeros, 1, padding, file) == padding);
+}
+
+CAssetPack::CAssetPack() : m_data(nullptr), m_size(0), m_header(nullptr), m_entries(nullptr), m_slots(nullptr)
+{
+}
+
+bool CAssetPack::Open(const char *filename)
+{
+	Close();
+
+	if (!m_file.Open(filename) || m_file.GetSize() < sizeof(packheader_t))
+	{
+		Close();
+		return false;
+	}
+
+	m_data = m_file.GetData();
+	m_size = m_file.GetSize();
+	m_header = (const packheader_t *)m_data;
+
+	// The slot count must be a power of two for the probe mask.
+	if (m_header->magic != PACK_MAGIC || m_header->version != PACK_VERSION || m_header->slotCount == 0 || (m_header->slotCount & (m_header->slotCount - 1)) != 0 ||
+		m_header->tocOffset > m_size || (m_size - m_header->tocOffset) / sizeof(packentry_t) < m_header->entryCount ||
+		m_header->slotOffset > m_size || (m_size - m_header->slotOffset) / sizeof(uint32_t) < m_header->slotCount)
+	{
+		Close();
+		return false;
+	}
+
+	m_entries = (const packentry_t *)(m_data + m_header->tocOffset);
+	m_slots = (const uint32_t *)(m_data + m_header->slotOffset);
+
+	for (uint32_t i = 0; i < m_header->entryCount; i++)
+	{
+		if (m_entries[i].offset > m_size || m_entries[i].size > m_size - m_entries[i].offset || memchr(m_entries[i].name, '\0', PACK_NAME_LENGTH) == nullptr)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CAssetPack::Close()
+{
+	m_file.Close();
+	m_data = nullptr;
+	m_size = 0;
+	m_header = nullptr;
+	m_entries = nullptr;
+	m_slots = nullptr;
+}
+
+int CAssetPack::Find(const char *name) const
+{
+	if (m_header == nullptr)
+		return -1;
+
+	uint32_t mask = m_header->slotCount - 1;
+
+	// Linear probing always ends at an empty slot, since the table is never
+	// more than half full.
+	for (uint32_t slot = HashName(name) & mask, i = 0; i <= mask; slot = (slot + 1) & mask, i++)
+	{
+		uint32_t entry = m_slots[slot];
+
+		if (entry == 0 || entry > m_header->entryCount)
+			return -1;
+
+		if (!strcmp(m_entries[entry - 1].name, name))
+			return int(entry - 1);
+	}
+
+	return -1;
+}
+
+const packentry_t *CAssetPack::GetEntry(unsigned int id) const
+{
+	return (id < GetEntryCount() ? &m_entries[id] : nullptr);
+}
+
+const uint8_t *CAssetPack::GetData(unsigned int id) const
+{
+	return (id < GetEntryCount() ? m_data + m_entries[id].offset : nullptr);
+}
+
+uint64_t CAssetPack::GetSize(unsigned int id) const
+{
+	return (id < GetEntryCount() ? m_entries[id].size : 0);
+}
+
+bool CAssetPack::Write(const char *filename, const vector<PackSource> &sources)
+{
+	vector<packentry_t> entries(sources.size());
+
+	packheader_t header;
+	header.magic = PACK_MAGIC;
+	header.version = PACK_VERSION;
+	header.entryCount = uint32_t(sources.size());
+	header.slotCount = 1;
+	header.tocOffset = 0;
+	header.slotOffset = 0;
+
+	while (header.slotCount < header.entryCount * 2)
+		header.slotCount <<= 1;
+
+	vector<uint32_t> slots(header.slotCount, 0);
+
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (sources[i].name.size() >= PACK_NAME_LENGTH)
+			return false;
+
+		memset(entries[i].name, 0, PACK_NAME_LENGTH);
+		memcpy(entries[i].name, sources[i].name.c_str(), sources[i].name.size());
+
+		uint32_t slot = HashName(entries[i].name) & (header.slotCount - 1);
+
+		while (slots[slot] != 0)
+		{
+			if (!strcmp(entries[slots[slot] - 1].name, entries[i].name))
+				return false;
+
+			slot = (slot + 1) & (header.slotCount - 1);
+		}
+
+		slots[slot] = uint32_t(i + 1);
+	}
+
+	FILE *file = fopen(filename, "wb");
+
+	if (file == nullptr)
+		return false;
+
+	bool success = (fwrite(&header, sizeof(header), 1, file) == 1);
+	vector<uint8_t> buffer(65536);
+
+	for (size_t i = 0; i < sources.size() && success; i++)
+	{
+		FILE *source = fopen(sources[i].filename.c_str(), "rb");
+
+		if (source == nullptr || !PadFile(file, PACK_ALIGNMENT))
+		{
+			if (source != nullptr)
+				fclose(source);
+
+			success = false;
+			break;
+		}
+
+		entries[i].offset = uint64_t(ftell(file));
+		entries[i].size = 0;
+
+		size_t count;
+
+		while ((count = fread(buffer.data(), 1, buffer.size(), source)) > 0)
+		{
+			if (fwrite(buffer.data(), 1, count, file) != count)
+			{
+				success = false;
+				break;
+			}
+
+			entries[i].size += count;
+		}
+
+		fclose(source);
+	}
+
+	if (success && PadFile(file, sizeof(uint64_t)))
+	{
+		header.tocOffset = uint64_t(ftell(file));
+		header.slotOffset = header.tocOffset + sizeof(packentry_t) * entries.size();
+
+		success = (fwrite(entries.data(), sizeof(packentry_t), entries.size(), file) == entries.size() &&
+			fwrite(slots.data(), sizeof(uint32_t), slots.size(), file) == slots.size() &&
+			fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1);
+	}
+	else
+		success = false;
+
+	if (fclose(file) != 0)
+		success = false;
+
+	if (!success)
+		remove(filename);
+
+	return success;
+}
+
+// The 64-bit hash is folded in half, which mixes its high bits into the
+// low ones that pick the slot.
+uint32_t CAssetPack::HashName(const char *name)
+{
+	CHash hash;
+	hash.Add(name, strlen(name));
+
+	return uint32_t(hash.GetValue() ^ (hash.GetValue() >> 32));
+}
\ No newline at end of file
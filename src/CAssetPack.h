@@ -0,0 +1,91 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CASSETPACK_H__
+#define __CASSETPACK_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CMappedFile.h"
+
+#define PACK_MAGIC		0x4B415044	// "DPAK"
+#define PACK_VERSION		2
+#define PACK_ALIGNMENT		4096
+#define PACK_NAME_LENGTH	48
+
+// A pack starts with a packheader_t and is followed by each file's bytes,
+// every section starting on a PACK_ALIGNMENT boundary so that it can be
+// used in place from a mapping. The table of contents comes last: one
+// packentry_t per file, whose index is the file's id, then slotCount
+// hash slots holding an entry index plus one, or zero when empty.
+struct packheader_t
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t slotCount;
+	uint64_t tocOffset;
+	uint64_t slotOffset;
+};
+
+struct packentry_t
+{
+	char name[PACK_NAME_LENGTH];
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct PackSource
+{
+	std::string name;
+	std::string filename;
+};
+
+// Read-only view of a pack mapped into memory. Sections are paged in by
+// the system as they are touched, and stay valid until Close.
+class CAssetPack
+{
+public:
+	CAssetPack();
+	~CAssetPack() { Close(); }
+
+	bool Open(const char *filename);
+	void Close();
+	bool IsOpen() const { return m_data != nullptr; }
+
+	// Returns -1 when the pack has no file by that name.
+	int Find(const char *name) const;
+
+	unsigned int GetEntryCount() const { return (m_header != nullptr ? m_header->entryCount : 0); }
+	const packentry_t *GetEntry(unsigned int id) const;
+	const uint8_t *GetData(unsigned int id) const;
+	uint64_t GetSize(unsigned int id) const;
+
+	static bool Write(const char *filename, const std::vector<PackSource> &sources);
+	static uint32_t HashName(const char *name);
+
+private:
+	CAssetPack(const CAssetPack &) = delete;
+	CAssetPack &operator=(const CAssetPack &) = delete;
+
+	CMappedFile m_file;
+	const uint8_t *m_data;
+	size_t m_size;
+	const packheader_t *m_header;
+	const packentry_t *m_entries;
+	const uint32_t *m_slots;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include "CAutosave.h"
+
+using namespace std;
+
+CAutosave::CAutosave() : m_saveCount(0), m_failureCount(0), m_running(true)
+{
+	m_thread = thread(&CAutosave::SaveThread, this);
+}
+
+CAutosave::~CAutosave()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_condition.notify_one();
+	m_thread.join();
+}
+
+void CAutosave::Save(const shared_ptr<const MapImage> &image, const string &filename)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_pendingImage = image;
+		m_pendingFilename = filename;
+	}
+
+	m_condition.notify_one();
+}
+
+unsigned int CAutosave::GetSaveCount() const
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	return m_saveCount;
+}
+
+unsigned int CAutosave::GetFailureCount() const
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	return m_failureCount;
+}
+
+void CAutosave::SaveThread()
+{
+	unique_lock<mutex> lock(m_mutex);
+
+	while (true)
+	{
+		m_condition.wait(lock, [this]() { return !m_running || m_pendingImage; });
+
+		if (!m_pendingImage)
+			break;
+
+		shared_ptr<const MapImage> image = move(m_pendingImage);
+		string filename = move(m_pendingFilename);
+		m_pendingImage.reset();
+
+		lock.unlock();
+		bool saved = CMap::WriteImage(*image, filename.c_str());
+		lock.lock();
+
+		if (saved)
+			m_saveCount++;
+		else
+			m_failureCount++;
+	}
+}
\ No newline at end of file
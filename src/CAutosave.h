@@ -0,0 +1,59 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CAUTOSAVE_H__
+#define __CAUTOSAVE_H__
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "CMap.h"
+
+// Milliseconds between autosaves of a map that has changed.
+#define AUTOSAVE_INTERVAL	30000
+
+// Writes map images on a thread of its own, so that the editor only pays
+// for capturing them. A save queued while another is waiting replaces it,
+// since only the latest state matters. Queued saves are finished before
+// the destructor returns.
+class CAutosave
+{
+public:
+	CAutosave();
+	~CAutosave();
+
+	void Save(const std::shared_ptr<const MapImage> &image, const std::string &filename);
+
+	unsigned int GetSaveCount() const;
+	unsigned int GetFailureCount() const;
+
+private:
+	CAutosave(const CAutosave &) = delete;
+	CAutosave &operator=(const CAutosave &) = delete;
+
+	void SaveThread();
+
+	std::thread m_thread;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::shared_ptr<const MapImage> m_pendingImage;
+	std::string m_pendingFilename;
+	unsigned int m_saveCount;
+	unsigned int m_failureCount;
+	bool m_running;
+};
+
+#endif
\ No newline at end of file
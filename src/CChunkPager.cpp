@@ -0,0 +1,417 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#include <algorithm>
+#include <cstdio>
+
+#include "CChunkPager.h"
+
+using namespace std;
+
+CChunkPager::CChunkPager(size_t budget, CMapCache *mapCache) : m_budget(budget), m_mapCache(mapCache), m_memoryUsage(0), m_version(0), m_originX(0), m_originY(0), m_viewMinX(0), m_viewMinY(0), m_viewMaxX(0), m_viewMaxY(0), m_viewChanged(false), m_running(true)
+{
+	m_thread = thread(&CChunkPager::PagerThread, this);
+}
+
+CChunkPager::~CChunkPager()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_viewCondition.notify_all();
+	m_thread.join();
+}
+
+bool CChunkPager::ReadWorkspace(const char *filename)
+{
+	FILE *file = fopen(filename, "r");
+
+	if (file == nullptr)
+		return false;
+
+	string directory = filename;
+	size_t separator = directory.find_last_of("/\\");
+	directory = (separator != string::npos ? directory.substr(0, separator + 1) : string());
+
+	char line[1024];
+
+	while (fgets(line, sizeof(line), file) != nullptr)
+	{
+		int x, y;
+		char chunkFilename[1024];
+
+		if (line[0] == '#' || sscanf(line, "%d %d %1023[^\r\n]", &x, &y, chunkFilename) != 3)
+			continue;
+
+		AddChunk(x, y, directory + chunkFilename);
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+void CChunkPager::AddChunk(int x, int y, const string &filename)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	Entry &entry = m_entries[GetKey(x, y)];
+	entry.x = x;
+	entry.y = y;
+	entry.filename = filename;
+	entry.failed = false;
+}
+
+bool CChunkPager::FindChunk(const string &filename, int &x, int &y) const
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	for (const auto &entry : m_entries)
+	{
+		if (entry.second.filename == filename)
+		{
+			x = entry.second.x;
+			y = entry.second.y;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool CChunkPager::GetChunkFilename(int x, int y, string &filename) const
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	auto entry = m_entries.find(GetKey(x, y));
+
+	if (entry == m_entries.end())
+		return false;
+
+	filename = entry->second.filename;
+
+	return true;
+}
+
+void CChunkPager::GetBounds(int &minX, int &minY, int &maxX, int &maxY) const
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	minX = minY = maxX = maxY = 0;
+
+	for (const auto &entry : m_entries)
+	{
+		minX = min(minX, entry.second.x);
+		minY = min(minY, entry.second.y);
+		maxX = max(maxX, entry.second.x);
+		maxY = max(maxY, entry.second.y);
+	}
+}
+
+void CChunkPager::SetOrigin(int x, int y)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	m_originX = x;
+	m_originY = y;
+
+	// Resident chunks were built relative to the old origin.
+	for (auto &entry : m_entries)
+	{
+		if (entry.second.chunk)
+			m_memoryUsage -= entry.second.chunk->memoryUsage;
+
+		entry.second.chunk.reset();
+		entry.second.failed = false;
+	}
+
+	m_version++;
+	m_viewChanged = true;
+	m_viewCondition.notify_one();
+}
+
+void CChunkPager::SetView(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	if (minX == m_viewMinX && minY == m_viewMinY && maxX == m_viewMaxX && maxY == m_viewMaxY)
+		return;
+
+	m_viewMinX = minX;
+	m_viewMinY = minY;
+	m_viewMaxX = maxX;
+	m_viewMaxY = maxY;
+	m_viewChanged = true;
+	m_viewCondition.notify_one();
+}
+
+void CChunkPager::GetChunks(vector<shared_ptr<const Chunk>> &chunks) const
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	chunks.clear();
+
+	for (const auto &entry : m_entries)
+	{
+		if (entry.second.chunk)
+			chunks.push_back(entry.second.chunk);
+	}
+}
+
+bool CChunkPager::Pick(int32_t x, int32_t y, int32_t distance, SnapshotLine &line) const
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	float nearest = float(distance) * distance;
+	bool found = false;
+
+	for (const auto &entry : m_entries)
+	{
+		const Chunk *chunk = entry.second.chunk.get();
+
+		if (chunk == nullptr || x < chunk->minX - distance || y < chunk->minY - distance || x > chunk->maxX + distance || y > chunk->maxY + distance)
+			continue;
+
+		for (const SnapshotLine &chunkLine : chunk->lines)
+		{
+			float dx = chunkLine.x2 - chunkLine.x1, dy = chunkLine.y2 - chunkLine.y1;
+			float length = dx * dx + dy * dy;
+			float t = (length != 0.0f ? ((x - chunkLine.x1) * dx + (y - chunkLine.y1) * dy) / length : 0.0f);
+			t = max(0.0f, min(t, 1.0f));
+
+			float px = chunkLine.x1 + t * dx - x, py = chunkLine.y1 + t * dy - y;
+			float distanceSquared = px * px + py * py;
+
+			if (distanceSquared <= nearest)
+			{
+				nearest = distanceSquared;
+				line = chunkLine;
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+unsigned int CChunkPager::GetVersion() const
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	return m_version;
+}
+
+size_t CChunkPager::GetMemoryUsage() const
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	return m_memoryUsage;
+}
+
+void CChunkPager::PagerThread()
+{
+	unique_lock<mutex> lock(m_mutex);
+
+	while (m_running)
+	{
+		if (!m_viewChanged)
+		{
+			m_viewCondition.wait(lock);
+			continue;
+		}
+
+		Entry *entry = FindNextLoad();
+
+		if (entry == nullptr)
+		{
+			m_viewChanged = false;
+			continue;
+		}
+
+		int x = entry->x, y = entry->y;
+		int32_t xOffset = int32_t(x - m_originX) * CHUNK_SIZE, yOffset = int32_t(y - m_originY) * CHUNK_SIZE;
+		string filename = entry->filename;
+		unsigned int version = m_version;
+
+		lock.unlock();
+		shared_ptr<const Chunk> chunk = LoadChunk(filename, x, y, xOffset, yOffset);
+		lock.lock();
+
+		// Entries are never removed, but the origin may have moved while the
+		// chunk was loading.
+		if (m_version != version)
+			continue;
+
+		entry->chunk = chunk;
+		entry->failed = !chunk;
+
+		if (chunk)
+			m_memoryUsage += chunk->memoryUsage;
+
+		Evict();
+		m_version++;
+	}
+}
+
+// Nearest chunk that touches the view or the ring around it and is not
+// resident yet.
+CChunkPager::Entry *CChunkPager::FindNextLoad()
+{
+	Entry *next = nullptr;
+	int64_t nextDistance = 0;
+	size_t residentCount = 0;
+
+	for (auto &entry : m_entries)
+	{
+		Entry &candidate = entry.second;
+
+		if (candidate.chunk)
+			residentCount++;
+
+		if (candidate.chunk || candidate.failed || (candidate.x == m_originX && candidate.y == m_originY) || !TouchesView(candidate, CHUNK_SIZE))
+			continue;
+
+		int64_t distance = GetViewDistance(candidate);
+
+		if (next == nullptr || distance < nextDistance)
+		{
+			next = &candidate;
+			nextDistance = distance;
+		}
+	}
+
+	// Chunks around the view are only loaded while one of average size still
+	// fits in the budget, or they would just be evicted again.
+	size_t averageUsage = (residentCount != 0 ? m_memoryUsage / residentCount : 0);
+
+	if (next != nullptr && !TouchesView(*next, 0) && m_memoryUsage + averageUsage > m_budget)
+		return nullptr;
+
+	return next;
+}
+
+void CChunkPager::Evict()
+{
+	while (m_memoryUsage > m_budget)
+	{
+		Entry *farthest = nullptr;
+		int64_t farthestDistance = 0;
+
+		for (auto &entry : m_entries)
+		{
+			Entry &candidate = entry.second;
+
+			if (!candidate.chunk || TouchesView(candidate, 0))
+				continue;
+
+			int64_t distance = GetViewDistance(candidate);
+
+			if (farthest == nullptr || distance > farthestDistance)
+			{
+				farthest = &candidate;
+				farthestDistance = distance;
+			}
+		}
+
+		if (farthest == nullptr)
+			break;
+
+		m_memoryUsage -= farthest->chunk->memoryUsage;
+		farthest->chunk.reset();
+	}
+}
+
+bool CChunkPager::TouchesView(const Entry &entry, int32_t margin) const
+{
+	int64_t minX = int64_t(entry.x - m_originX) * CHUNK_SIZE, minY = int64_t(entry.y - m_originY) * CHUNK_SIZE;
+
+	return (minX <= m_viewMaxX + margin && minY <= m_viewMaxY + margin && minX + CHUNK_SIZE > m_viewMinX - margin && minY + CHUNK_SIZE > m_viewMinY - margin);
+}
+
+// Squared distance between the centres of the chunk and the view.
+int64_t CChunkPager::GetViewDistance(const Entry &entry) const
+{
+	int64_t dx = int64_t(entry.x - m_originX) * CHUNK_SIZE + CHUNK_SIZE / 2 - (int64_t(m_viewMinX) + m_viewMaxX) / 2;
+	int64_t dy = int64_t(entry.y - m_originY) * CHUNK_SIZE + CHUNK_SIZE / 2 - (int64_t(m_viewMinY) + m_viewMaxY) / 2;
+
+	return dx * dx + dy * dy;
+}
+
+shared_ptr<const Chunk> CChunkPager::LoadChunk(const string &filename, int x, int y, int32_t xOffset, int32_t yOffset) const
+{
+	CMap map;
+
+	// A chunk that cannot be read is left failed rather than shown empty.
+	if (m_mapCache != nullptr)
+	{
+		if (!m_mapCache->Read(filename.c_str(), map))
+			return nullptr;
+	}
+	else
+	{
+		bspmapex_t *bspMap = LoadBspMapEx(filename.c_str());
+
+		if (bspMap == nullptr)
+			return nullptr;
+
+		map.Read(bspMap);
+		FreeBspMapEx(bspMap);
+	}
+
+	shared_ptr<Chunk> chunk = make_shared<Chunk>();
+	chunk->x = x;
+	chunk->y = y;
+	chunk->minX = xOffset;
+	chunk->minY = yOffset;
+	chunk->maxX = xOffset + CHUNK_SIZE;
+	chunk->maxY = yOffset + CHUNK_SIZE;
+
+	CList<Line> *lines = map.GetLines();
+	CList<Thing> *things = map.GetThings();
+
+	chunk->lines.reserve(lines->UniqueSize());
+	chunk->things.reserve(things->UniqueSize());
+
+	if (!lines->IsEmpty())
+	{
+		for (CNode<Line> *currentLine = lines->Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+		{
+			if (currentLine->VisitNode() == 0)
+			{
+				const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
+				const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
+				chunk->lines.push_back({ float(vertex1->x + xOffset), float(vertex1->y + yOffset), float(vertex2->x + xOffset), float(vertex2->y + yOffset), currentLine->GetRefCount() != 1 });
+			}
+		}
+	}
+
+	if (!things->IsEmpty())
+	{
+		for (CNode<Thing> *currentThing = things->Head(); currentThing->GetData() != nullptr; currentThing = currentThing->Next())
+		{
+			if (currentThing->VisitNode() == 0)
+			{
+				const Thing *thing = currentThing->GetData();
+				chunk->things.push_back({ float(thing->x + xOffset), float(thing->y + yOffset), map.GetThingId(thing->handle) });
+			}
+		}
+	}
+
+	chunk->memoryUsage = sizeof(Chunk) + chunk->lines.capacity() * sizeof(SnapshotLine) + chunk->things.capacity() * sizeof(SnapshotThing);
+
+	return chunk;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#ifndef __CCHUNKPAGER_H__
+#define __CCHUNKPAGER_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "CMapCache.h"
+#include "CMapSnapshot.h"
+
+// Width and height of a chunk in map units, the extent of one map.
+#define CHUNK_SIZE	(256 * 8)
+
+// Read-only copy of one chunk's lines and things. Coordinates are relative
+// to the pager's origin chunk, so chunks are drawn and picked in the same
+// space as the map being edited.
+struct Chunk
+{
+	int x;
+	int y;
+	int32_t minX;
+	int32_t minY;
+	int32_t maxX;
+	int32_t maxY;
+	std::vector<SnapshotLine> lines;
+	std::vector<SnapshotThing> things;
+	size_t memoryUsage;
+};
+
+// Pages the chunks of a workspace in and out around the view on a
+// background thread. A workspace is a text file with one "x y filename"
+// line per chunk, where x and y are chunk coordinates and filenames are
+// relative to the workspace file. Chunks that touch the view or the ring
+// around it are loaded nearest first. Once the resident chunks use more
+// than the budget, the ones farthest from the view are dropped, but never
+// ones that touch the view. The origin chunk holds the map being edited
+// and is never paged in.
+class CChunkPager
+{
+public:
+	// Chunks are read through mapCache when it is not null.
+	CChunkPager(size_t budget = 64 * 1024 * 1024, CMapCache *mapCache = nullptr);
+	~CChunkPager();
+
+	bool ReadWorkspace(const char *filename);
+	void AddChunk(int x, int y, const std::string &filename);
+	bool FindChunk(const std::string &filename, int &x, int &y) const;
+	bool GetChunkFilename(int x, int y, std::string &filename) const;
+	void GetBounds(int &minX, int &minY, int &maxX, int &maxY) const;
+
+	void SetOrigin(int x, int y);
+	void SetView(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY);
+
+	void GetChunks(std::vector<std::shared_ptr<const Chunk>> &chunks) const;
+	bool Pick(int32_t x, int32_t y, int32_t distance, SnapshotLine &line) const;
+
+	// Changes whenever a chunk is paged in or out.
+	unsigned int GetVersion() const;
+	size_t GetMemoryUsage() const;
+
+private:
+	CChunkPager(const CChunkPager &) = delete;
+	CChunkPager &operator=(const CChunkPager &) = delete;
+
+	struct Entry
+	{
+		int x;
+		int y;
+		std::string filename;
+		std::shared_ptr<const Chunk> chunk;
+		bool failed;
+	};
+
+	void PagerThread();
+	Entry *FindNextLoad();
+	void Evict();
+	bool TouchesView(const Entry &entry, int32_t margin) const;
+	int64_t GetViewDistance(const Entry &entry) const;
+
+	std::shared_ptr<const Chunk> LoadChunk(const std::string &filename, int x, int y, int32_t xOffset, int32_t yOffset) const;
+	static uint64_t GetKey(int x, int y) { return (uint64_t(uint32_t(x)) << 32) | uint32_t(y); }
+
+	std::unordered_map<uint64_t, Entry> m_entries;
+	size_t m_budget;
+	CMapCache *m_mapCache;
+	size_t m_memoryUsage;
+	unsigned int m_version;
+	int m_originX;
+	int m_originY;
+	int32_t m_viewMinX;
+	int32_t m_viewMinY;
+	int32_t m_viewMaxX;
+	int32_t m_viewMaxY;
+	bool m_viewChanged;
+	bool m_running;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_viewCondition;
+	std::thread m_thread;
+};
+
+#endif
\ No newline at end of file
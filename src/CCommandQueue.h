@@ -0,0 +1,90 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CCOMMANDQUEUE_H__
+#define __CCOMMANDQUEUE_H__
+
+#include <atomic>
+
+// Single producer, single consumer ring buffer. Push may only be called
+// from one thread and Pop from one other thread.
+template <class T>
+class CCommandQueue
+{
+public:
+	CCommandQueue(unsigned int capacity = 1024);
+	~CCommandQueue();
+
+	bool Push(const T &command);
+	bool Pop(T &command);
+
+	bool IsEmpty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+	unsigned int GetCapacity() const { return m_mask + 1; }
+
+private:
+	CCommandQueue(const CCommandQueue &) = delete;
+	CCommandQueue &operator=(const CCommandQueue &) = delete;
+
+	T *m_commands;
+	unsigned int m_mask;
+	alignas(64) std::atomic<unsigned int> m_head;
+	alignas(64) std::atomic<unsigned int> m_tail;
+};
+
+template <class T>
+CCommandQueue<T>::CCommandQueue(unsigned int capacity) : m_head(0), m_tail(0)
+{
+	unsigned int size = 2;
+
+	while (size < capacity)
+		size <<= 1;
+
+	m_commands = new T[size];
+	m_mask = size - 1;
+}
+
+template <class T>
+CCommandQueue<T>::~CCommandQueue()
+{
+	delete[] m_commands;
+}
+
+template <class T>
+bool CCommandQueue<T>::Push(const T &command)
+{
+	unsigned int tail = m_tail.load(std::memory_order_relaxed);
+
+	if (tail - m_head.load(std::memory_order_acquire) > m_mask)
+		return false;
+
+	m_commands[tail & m_mask] = command;
+	m_tail.store(tail + 1, std::memory_order_release);
+
+	return true;
+}
+
+template <class T>
+bool CCommandQueue<T>::Pop(T &command)
+{
+	unsigned int head = m_head.load(std::memory_order_relaxed);
+
+	if (head == m_tail.load(std::memory_order_acquire))
+		return false;
+
+	command = m_commands[head & m_mask];
+	m_head.store(head + 1, std::memory_order_release);
+
+	return true;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,1738 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "CEditor.h"
+
+using namespace std;
+
+bool SectorIsClockwise(const Sector &sector);
+bool AABBContainsPoint(int32_t x, int32_t y, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY);
+Selection FindSelection(CList<Sector> *sectors, int32_t x, int32_t y, CNode<Sector> **selectedSector, CNode<Line> **selectedLine, CNode<Vertex> **selectedVertex);
+CNode<Line> *FindLine(const CList<Line> *lines, const Vertex *vertex1, const Vertex *vertex2);
+void ProjectPointOnSegment(const Vertex &vertex1, const Vertex &vertex2, int32_t x, int32_t y, Vertex &vertexOut);
+void CalculateSectorAABB(Sector &sector);
+void InitializeSector(Sector &sector);
+void GetSectorLoop(const Sector &sector, int polygon, ClipLoop &loop);
+void ReleaseLineHandles(CMap &map, CNode<Line> *start, CNode<Line> *end);
+void CancelSector(CMap &map, Sector &sector);
+void DeleteSector(CMap &map, CNode<Sector> &sector);
+CNode<Vertex> *SplitLine(CMap &map, CNode<Line> *lineNode, int32_t x, int32_t y);
+CNode<Vertex> *InsertVertex(CMap &map, Vertex &vertex);
+CNode<Line> *InsertLine(CMap &map, Line &line);
+void AppendSectorVertex(CMap &map, Sector &sector, Line &line, Vertex &vertex);
+CNode<Sector> *InsertSector(CMap &map, Sector &sector);
+CNode<Sector> *CloseSector(CMap &map, Sector &sector, Line &line);
+void MoveVertex(Vertex &vertex, int x, int y, CGrid &grid);
+void MoveLine(Line &line, int x, int y, int referenceX, int referenceY, int &initialX, int &initialY, CGrid &grid);
+void MoveSector(Sector &sector, int x, int y, int referenceX, int referenceY, int &initialX, int &initialY, CGrid &grid);
+void MoveVertices(vector<Vertex *> &vertices, int x, int y, int referenceX, int referenceY, int &initialX, int &initialY, CGrid &grid);
+void RecalculateSectorsAABB(CMap &map, CNode<Vertex> &vertex);
+void RecalculateSectorsAABB(CMap &map, CNode<Line> &line);
+void RecalculateSectorsAABB(CMap &map, CNode<Sector> &sector);
+void RecalculateSectorsAABB(CMap &map, const vector<Vertex *> &vertices);
+
+CEditor::CEditor(int width, int height) : m_grid(width, height, 8, 0, 0, 0.25f), m_mode(MODE_DRAW), m_drawing(false), m_moving(false), m_scrolling(false), m_x(0), m_y(0), m_selectedSector(nullptr), m_selectedLine(nullptr), m_selectedVertex(nullptr), m_selection(SELECTION_NONE), m_referenceX(0), m_referenceY(0), m_initialX(0), m_initialY(0), m_scale(0.25f), m_running(true), m_textureCount(0), m_validator(nullptr), m_validated(false), m_pager(nullptr), m_chunkVersion(0), m_chunkLinePicked(false), m_operandSector(nullptr), m_boxSelecting(false), m_boxX1(0), m_boxY1(0), m_boxX2(0), m_boxY2(0), m_autosave(nullptr), m_savedRevision(0)
+{
+	m_grid.SetMinX(0);
+	m_grid.SetMinY(0);
+	m_grid.SetMaxX(256);
+	m_grid.SetMaxY(256);
+
+	m_grid.SetXDisplacement(-int(m_grid.GetCellSize() * m_grid.GetMaxX() / 2 * m_grid.GetScale()));
+	m_grid.SetYDisplacement(-int(m_grid.GetCellSize() * m_grid.GetMaxY() / 2 * m_grid.GetScale()));
+
+	InitializeSector(m_sector);
+
+	m_line.sectors[0] = nullptr;
+	m_line.sectors[1] = nullptr;
+}
+
+void CEditor::Run(CCommandQueue<Command> &commands)
+{
+	while (IsRunning())
+	{
+		Command command;
+		bool changed = false;
+
+		while (commands.Pop(command))
+		{
+			ProcessCommand(command);
+			changed = true;
+		}
+
+		if (m_pager != nullptr && m_pager->GetVersion() != m_chunkVersion)
+			changed = true;
+
+		if (changed)
+			PublishSnapshot();
+		else
+			this_thread::sleep_for(chrono::milliseconds(1));
+
+		Autosave();
+	}
+}
+
+void CEditor::SetAutosave(CAutosave *autosave, const string &filename)
+{
+	m_autosave = autosave;
+	m_autosaveFilename = filename;
+	m_savedRevision = m_map.GetRevision();
+	m_autosaveTime = chrono::steady_clock::now();
+}
+
+void CEditor::Autosave()
+{
+	if (m_autosave == nullptr || m_map.GetRevision() == m_savedRevision)
+		return;
+
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+	if (now - m_autosaveTime < chrono::milliseconds(AUTOSAVE_INTERVAL))
+		return;
+
+	// Capturing copies the map into its flat on-disk form, and the slow
+	// part, writing it out, happens on the autosave thread.
+	shared_ptr<MapImage> image = make_shared<MapImage>();
+	m_map.Capture(*image);
+
+	m_autosave->Save(image, m_autosaveFilename);
+	m_savedRevision = m_map.GetRevision();
+	m_autosaveTime = now;
+}
+
+void CEditor::ProcessCommand(const Command &command)
+{
+	switch (command.type)
+	{
+	case COMMAND_QUIT:
+		Stop();
+		break;
+	case COMMAND_KEY_DOWN:
+		ProcessKeyDown(command);
+		break;
+	case COMMAND_BUTTON_DOWN:
+		ProcessButtonDown(command);
+		break;
+	case COMMAND_BUTTON_UP:
+		ProcessButtonUp(command);
+		break;
+	case COMMAND_MOTION:
+		ProcessMotion(command);
+		break;
+	case COMMAND_WHEEL:
+		ProcessWheel(command);
+		break;
+	case COMMAND_RESIZE:
+		m_grid.Resize(command.x, command.y);
+		break;
+	case COMMAND_COPY:
+		if (m_mode == MODE_MOVE && !m_moving)
+			CopySelectedSectors();
+
+		break;
+	case COMMAND_TEXTURE_COUNT:
+		m_textureCount = (unsigned int)command.key;
+		break;
+	case COMMAND_PASTE:
+		if (m_mode == MODE_MOVE && !m_moving && !m_clipboard.points.empty())
+		{
+			int32_t x = command.x, y = command.y;
+			m_grid.Snap(x, y);
+			PasteSectors(x, y);
+		}
+
+		break;
+	default:
+		break;
+	}
+}
+
+void CEditor::SetChunkPager(CChunkPager *pager, int originX, int originY)
+{
+	m_pager = pager;
+	m_pager->SetOrigin(originX, originY);
+
+	// The grid covers every chunk of the workspace. Grid bounds are in
+	// cells, relative to the origin chunk.
+	int minX, minY, maxX, maxY;
+	m_pager->GetBounds(minX, minY, maxX, maxY);
+
+	int chunkCells = CHUNK_SIZE / m_grid.GetCellSize();
+	m_grid.SetMinX((minX - originX) * chunkCells);
+	m_grid.SetMinY((minY - originY) * chunkCells);
+	m_grid.SetMaxX((maxX - originX + 1) * chunkCells);
+	m_grid.SetMaxY((maxY - originY + 1) * chunkCells);
+}
+
+void CEditor::PublishSnapshot()
+{
+	m_map.UpdateDirtyCells();
+
+	DirtyHandles dirtyHandles;
+	m_map.TakeDirtyHandles(dirtyHandles);
+
+	if (m_version == nullptr)
+		atomic_store(&m_version, shared_ptr<const CMapVersion>(make_shared<CMapVersion>(m_map)));
+	else if (m_version->GetRevision() != m_map.GetRevision())
+		atomic_store(&m_version, shared_ptr<const CMapVersion>(make_shared<CMapVersion>(*m_version, m_map, dirtyHandles)));
+
+	shared_ptr<CMapSnapshot> snapshot = make_shared<CMapSnapshot>(m_map, m_grid, m_mode, m_scale);
+
+	if (m_validator != nullptr)
+	{
+		// Things must lie inside the grid, whose bounds are in cells.
+		int cellSize = m_grid.GetCellSize();
+		int32_t minX = m_grid.GetMinX() * cellSize, minY = m_grid.GetMinY() * cellSize;
+		int32_t maxX = m_grid.GetMaxX() * cellSize, maxY = m_grid.GetMaxY() * cellSize;
+
+		if (!m_validated)
+			m_validator->Validate(m_map, minX, minY, maxX, maxY);
+		else
+			m_validator->ValidateDirty(m_map, dirtyHandles, minX, minY, maxX, maxY);
+
+		m_validated = true;
+		snapshot->SetIssueCount((unsigned int)m_validator->GetIssues().size());
+	}
+
+	if (m_drawing)
+	{
+		const Vertex *vertex = m_line.vertex1->GetData();
+		snapshot->SetDrawingLine(vertex->x, vertex->y, m_x, m_y);
+	}
+
+	if (m_mode == MODE_MOVE && m_selection != SELECTION_NONE)
+	{
+		vector<Vertex> points;
+
+		if (m_selection == SELECTION_VERTEX)
+			points.push_back(*m_selectedVertex->GetData());
+		else if (m_selection == SELECTION_LINE)
+		{
+			points.push_back(*m_selectedLine->GetData()->vertex1->GetData());
+			points.push_back(*m_selectedLine->GetData()->vertex2->GetData());
+		}
+		else if (m_selection == SELECTION_SECTOR)
+		{
+			CNode<Line> *currentLine = m_selectedSector->GetData()->firstLine;
+
+			for (unsigned int lineCount = m_selectedSector->GetData()->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+				points.push_back(*(currentLine->GetData()->sectors[0] == m_selectedSector->GetData() ? currentLine->GetData()->vertex1->GetData() : currentLine->GetData()->vertex2->GetData()));
+		}
+
+		snapshot->SetHighlight(points, m_selection == SELECTION_SECTOR);
+	}
+
+	if (!m_selectedSectors.IsEmpty())
+	{
+		vector<CNode<Sector> *> sectors;
+		vector<SnapshotLine> lines;
+
+		GetSelectedSectors(sectors);
+
+		for (CNode<Sector> *sector : sectors)
+		{
+			CNode<Line> *currentLine = sector->GetData()->firstLine;
+
+			for (unsigned int lineCount = sector->GetData()->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+			{
+				const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
+				const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
+				lines.push_back({ float(vertex1->x), float(vertex1->y), float(vertex2->x), float(vertex2->y), currentLine->GetRefCount() > 1 });
+			}
+		}
+
+		snapshot->SetSelectedLines(lines);
+	}
+
+	if (m_boxSelecting)
+		snapshot->SetSelectionBox(m_boxX1, m_boxY1, m_boxX2, m_boxY2);
+
+	if (m_pager != nullptr)
+	{
+		m_pager->SetView(m_grid.TranslateXToGridSpace(0), m_grid.TranslateYToGridSpace(0), m_grid.TranslateXToGridSpace(m_grid.GetViewWidth()), m_grid.TranslateYToGridSpace(m_grid.GetViewHeight()));
+		m_chunkVersion = m_pager->GetVersion();
+
+		vector<shared_ptr<const Chunk>> chunks;
+		m_pager->GetChunks(chunks);
+		snapshot->SetChunks(chunks);
+
+		if (m_mode == MODE_MOVE && m_selection == SELECTION_NONE && m_chunkLinePicked)
+			snapshot->SetSelectedLines({ m_chunkLine });
+	}
+
+	atomic_store(&m_snapshot, shared_ptr<const CMapSnapshot>(snapshot));
+}
+
+void CEditor::ProcessKeyDown(const Command &command)
+{
+	switch (command.key)
+	{
+	case SDLK_ESCAPE:
+		if (m_drawing)
+		{
+			CancelSector(m_map, m_sector);
+			InitializeSector(m_sector);
+			m_drawing = false;
+		}
+		else if (!m_moving)
+			m_selectedSectors.Clear();
+
+		break;
+	case SDLK_RETURN:
+		if (m_drawing && m_sector.vertexCount > 4)
+		{
+			CloseSector(m_map, m_sector, m_line);
+			InitializeSector(m_sector);
+			m_drawing = false;
+		}
+
+		break;
+	case SDLK_DELETE:
+		if (m_mode == MODE_MOVE && !m_moving && !m_selectedSectors.IsEmpty())
+			DeleteSelectedSectors();
+		else if (m_mode == MODE_MOVE && m_selection == SELECTION_SECTOR && !m_moving)
+		{
+			MarkSelectionDirty();
+
+			if (m_selectedSector == m_operandSector)
+				m_operandSector = nullptr;
+
+			m_selectedSectors.Erase(m_selectedSector->GetData()->handle);
+			DeleteSector(m_map, *m_selectedSector);
+			m_selection = SELECTION_NONE;
+		}
+
+		break;
+	case SDLK_f:
+	case SDLK_g:
+		if (m_mode == MODE_MOVE && m_selection == SELECTION_SECTOR && !m_moving)
+		{
+			// Textures cycle through those the game data has. Until it has
+			// loaded, they stop at the last one a sector can hold.
+			Sector *sector = m_selectedSector->GetData();
+			unsigned char &texture = (command.key == SDLK_f ? sector->floorTexture : sector->ceilingTexture);
+			unsigned int textureCount = min(m_textureCount, 256u);
+
+			if (textureCount != 0)
+				texture = (unsigned char)((texture + 1) % textureCount);
+			else if (texture < 255)
+				texture++;
+
+			m_map.MarkSectorDirty(*sector);
+			m_map.MarkCellsDirty(sector->minX, sector->minY, sector->maxX, sector->maxY);
+		}
+
+		break;
+	case SDLK_x:
+		if (!m_drawing && !m_moving)
+			SplitCrossingLines();
+
+		break;
+	case SDLK_b:
+		if (m_mode == MODE_MOVE && m_selection == SELECTION_SECTOR && !m_moving)
+			m_operandSector = m_selectedSector;
+
+		break;
+	case SDLK_u:
+	case SDLK_i:
+	case SDLK_s:
+		if (m_mode == MODE_MOVE && !m_moving)
+			ApplyBooleanOperation(command.key == SDLK_u ? CLIP_UNION : (command.key == SDLK_i ? CLIP_INTERSECTION : CLIP_DIFFERENCE));
+
+		break;
+	case SDLK_q:
+		Stop();
+		break;
+	case SDLK_d:
+		if (!m_moving)
+			m_mode = MODE_DRAW;
+
+		break;
+	case SDLK_m:
+		if (!m_drawing)
+		{
+			m_mode = MODE_MOVE;
+			m_selection = FindSelection(m_map.GetSectors(), m_grid.TranslateXToGridSpace(command.x), m_grid.TranslateYToGridSpace(command.y), &m_selectedSector, &m_selectedLine, &m_selectedVertex);
+		}
+
+		break;
+	case SDLK_v:
+		if (!m_drawing && !m_moving)
+			m_mode = MODE_VERTEX;
+
+		break;
+	case SDLK_c:
+		m_grid.CenterOrigin();
+		m_grid.SetXDisplacement(-int(m_grid.GetCellSize() * (m_grid.GetMinX() + m_grid.GetMaxX()) / 2 * m_grid.GetScale()));
+		m_grid.SetYDisplacement(-int(m_grid.GetCellSize() * (m_grid.GetMinY() + m_grid.GetMaxY()) / 2 * m_grid.GetScale()));
+		break;
+	case SDLK_LEFT:
+		m_grid.ScrollX(m_grid.GetScaledCellSize());
+		break;
+	case SDLK_RIGHT:
+		m_grid.ScrollX(-m_grid.GetScaledCellSize());
+		break;
+	case SDLK_UP:
+		m_grid.ScrollY(m_grid.GetScaledCellSize());
+		break;
+	case SDLK_DOWN:
+		m_grid.ScrollY(-m_grid.GetScaledCellSize());
+		break;
+	case SDLK_MINUS:
+	case SDLK_KP_MINUS:
+		Zoom(-1, m_grid.GetViewWidth() / 2, m_grid.GetViewHeight() / 2);
+		break;
+	case SDLK_EQUALS:
+	case SDLK_KP_PLUS:
+		Zoom(1, m_grid.GetViewWidth() / 2, m_grid.GetViewHeight() / 2);
+		break;
+	default:
+		break;
+	}
+}
+
+void CEditor::ProcessButtonDown(const Command &command)
+{
+	if (command.key == SDL_BUTTON_LEFT && !m_scrolling)
+	{
+		if (m_mode == MODE_DRAW)
+		{
+			Vertex vertex;
+
+			m_x = command.x;
+			m_y = command.y;
+
+			m_grid.Snap(m_x, m_y);
+
+			vertex.x = m_x;
+			vertex.y = m_y;
+
+			if (m_sector.vertexCount > 0 && vertex.x == m_map.GetVertices()->Tail()->GetData()->x && vertex.y == m_map.GetVertices()->Tail()->GetData()->y)
+				return;
+
+			AddDrawingVertex(vertex);
+		}
+		else if (m_mode == MODE_MOVE)
+		{
+			if (m_selection == SELECTION_NONE)
+			{
+				m_selectedSectors.Clear();
+				m_boxX1 = m_boxX2 = m_grid.TranslateXToGridSpace(command.x);
+				m_boxY1 = m_boxY2 = m_grid.TranslateYToGridSpace(command.y);
+				m_boxSelecting = true;
+				return;
+			}
+
+			// Dragging one of the selected sectors drags them all.
+			if (m_selection == SELECTION_SECTOR && m_selectedSectors.Contains(m_selectedSector->GetData()->handle))
+			{
+				vector<CNode<Sector> *> sectors;
+				GetSelectedSectors(sectors);
+				GetSectorVertices(sectors, m_movingVertices);
+			}
+			else
+				m_selectedSectors.Clear();
+
+			// The lines a drag changes stay the same until it ends, so they
+			// are found once rather than on every motion.
+			vector<const Vertex *> vertices(m_movingVertices.begin(), m_movingVertices.end());
+
+			if (vertices.empty())
+				GetSelectionVertices(vertices);
+
+			FindVertexLines(vertices, m_movingLines);
+
+			m_referenceX = command.x;
+			m_referenceY = command.y;
+			m_initialX = m_initialY = 0;
+			m_moving = true;
+		}
+		else if (m_mode == MODE_VERTEX)
+		{
+			m_x = command.x;
+			m_y = command.y;
+
+			m_grid.Snap(m_x, m_y);
+
+			m_selection = FindSelection(m_map.GetSectors(), m_grid.TranslateXToGridSpace(command.x), m_grid.TranslateYToGridSpace(command.y), nullptr, &m_selectedLine, nullptr);
+
+			if (m_selection == SELECTION_LINE)
+				SplitLine(m_map, m_selectedLine, m_x, m_y);
+		}
+	}
+	else if (command.key == SDL_BUTTON_RIGHT && !m_drawing && !m_moving)
+	{
+		m_referenceX = command.x;
+		m_referenceY = command.y;
+		m_initialX = m_initialY = 0;
+		m_scrolling = true;
+	}
+}
+
+void CEditor::ProcessButtonUp(const Command &command)
+{
+	if (command.key == SDL_BUTTON_LEFT && !m_scrolling)
+	{
+		if (m_drawing)
+		{
+			Vertex vertex;
+
+			m_x = command.x;
+			m_y = command.y;
+
+			m_grid.Snap(m_x, m_y);
+
+			vertex.x = m_x;
+			vertex.y = m_y;
+
+			if (vertex.x == m_map.GetVertices()->Tail()->GetData()->x && vertex.y == m_map.GetVertices()->Tail()->GetData()->y)
+				return;
+
+			AddDrawingVertex(vertex);
+		}
+		else if (m_boxSelecting)
+		{
+			SelectSectorsInBox();
+			m_boxSelecting = false;
+		}
+		else if (m_moving)
+		{
+			if (!m_movingVertices.empty())
+			{
+				RecalculateSectorsAABB(m_map, m_movingVertices);
+				m_movingVertices.clear();
+			}
+			else if (m_selection == SELECTION_VERTEX)
+				RecalculateSectorsAABB(m_map, *m_selectedVertex);
+			else if (m_selection == SELECTION_LINE)
+				RecalculateSectorsAABB(m_map, *m_selectedLine);
+			else if (m_selection == SELECTION_SECTOR)
+				RecalculateSectorsAABB(m_map, *m_selectedSector);
+
+			m_movingLines.clear();
+			m_moving = false;
+		}
+	}
+	else if (command.key == SDL_BUTTON_RIGHT && m_scrolling)
+		m_scrolling = false;
+}
+
+void CEditor::ProcessMotion(const Command &command)
+{
+	if (m_drawing)
+	{
+		m_x = command.x;
+		m_y = command.y;
+
+		m_grid.Snap(m_x, m_y);
+	}
+	else if (m_moving && !m_movingVertices.empty())
+	{
+		MarkLinesDirty(m_movingLines);
+		MoveVertices(m_movingVertices, command.x, command.y, m_referenceX, m_referenceY, m_initialX, m_initialY, m_grid);
+		MarkLinesDirty(m_movingLines);
+	}
+	else if (m_moving)
+	{
+		MarkLinesDirty(m_movingLines);
+
+		if (m_selection == SELECTION_VERTEX)
+			MoveVertex(*m_selectedVertex->GetData(), command.x, command.y, m_grid);
+		else if (m_selection == SELECTION_LINE)
+			MoveLine(*m_selectedLine->GetData(), command.x, command.y, m_referenceX, m_referenceY, m_initialX, m_initialY, m_grid);
+		else if (m_selection == SELECTION_SECTOR)
+			MoveSector(*m_selectedSector->GetData(), command.x, command.y, m_referenceX, m_referenceY, m_initialX, m_initialY, m_grid);
+
+		MarkLinesDirty(m_movingLines);
+	}
+	else if (m_scrolling)
+	{
+		int finalX = command.x - m_referenceX, finalY = command.y - m_referenceY;
+		m_grid.Scroll(finalX - m_initialX, finalY - m_initialY);
+		m_initialX = finalX;
+		m_initialY = finalY;
+	}
+	else if (m_boxSelecting)
+	{
+		m_boxX2 = m_grid.TranslateXToGridSpace(command.x);
+		m_boxY2 = m_grid.TranslateYToGridSpace(command.y);
+	}
+	else if (m_mode == MODE_MOVE)
+	{
+		int32_t x = m_grid.TranslateXToGridSpace(command.x), y = m_grid.TranslateYToGridSpace(command.y);
+		m_selection = FindSelection(m_map.GetSectors(), x, y, &m_selectedSector, &m_selectedLine, &m_selectedVertex);
+
+		// Lines of the chunks around the map are picked when nothing in the
+		// map is, so that they can be inspected across chunk boundaries.
+		m_chunkLinePicked = (m_selection == SELECTION_NONE && m_pager != nullptr && m_pager->Pick(x, y, m_grid.ScaleToGridSpace(4), m_chunkLine));
+	}
+}
+
+void CEditor::ProcessWheel(const Command &command)
+{
+	Zoom(command.key, command.x, command.y);
+}
+
+void CEditor::Zoom(int steps, int x, int y)
+{
+	float scale = m_scale * powf(ZOOM_FACTOR, float(steps));
+
+	if (scale < MIN_SCALE)
+		scale = MIN_SCALE;
+	else if (scale > MAX_SCALE)
+		scale = MAX_SCALE;
+
+	m_grid.Zoom(scale, x, y);
+	m_scale = m_grid.GetScale();
+}
+
+void CEditor::MarkSelectionDirty()
+{
+	vector<const Vertex *> vertices;
+
+	GetSelectionVertices(vertices);
+	MarkVerticesDirty(vertices);
+}
+
+void CEditor::GetSelectionVertices(vector<const Vertex *> &vertices)
+{
+	if (m_selection == SELECTION_VERTEX)
+		vertices.push_back(m_selectedVertex->GetData());
+	else if (m_selection == SELECTION_LINE)
+	{
+		vertices.push_back(m_selectedLine->GetData()->vertex1->GetData());
+		vertices.push_back(m_selectedLine->GetData()->vertex2->GetData());
+	}
+	else if (m_selection == SELECTION_SECTOR)
+	{
+		CNode<Vertex> *currentVertex = m_selectedSector->GetData()->firstVertex;
+
+		for (unsigned int vertexCount = m_selectedSector->GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+			vertices.push_back(currentVertex->GetData());
+	}
+}
+
+// Vertices are shared with neighbouring sectors, so lines outside the
+// selection can touch them too.
+void CEditor::FindVertexLines(vector<const Vertex *> vertices, vector<const Line *> &lines)
+{
+	lines.clear();
+
+	if (vertices.empty() || m_map.GetLines()->IsEmpty())
+		return;
+
+	sort(vertices.begin(), vertices.end());
+
+	for (CNode<Line> *currentLine = m_map.GetLines()->Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+	{
+		if (binary_search(vertices.begin(), vertices.end(), currentLine->GetData()->vertex1->GetData()) || binary_search(vertices.begin(), vertices.end(), currentLine->GetData()->vertex2->GetData()))
+			lines.push_back(currentLine->GetData());
+	}
+}
+
+void CEditor::MarkVerticesDirty(const vector<const Vertex *> &vertices)
+{
+	vector<const Line *> lines;
+
+	FindVertexLines(vertices, lines);
+	MarkLinesDirty(lines);
+}
+
+void CEditor::MarkLinesDirty(const vector<const Line *> &lines)
+{
+	// Every line touching a moved vertex changes, so its whole extent is
+	// rasterized again.
+	int32_t minX = INT32_MAX, minY = INT32_MAX, maxX = INT32_MIN, maxY = INT32_MIN;
+
+	for (const Line *line : lines)
+	{
+		const Vertex *vertex1 = line->vertex1->GetData();
+		const Vertex *vertex2 = line->vertex2->GetData();
+
+		m_map.MarkLineDirty(*line);
+
+		for (Sector *sector : line->sectors)
+		{
+			if (sector != nullptr)
+				m_map.MarkSectorDirty(*sector);
+		}
+
+		minX = min(minX, min(vertex1->x, vertex2->x));
+		minY = min(minY, min(vertex1->y, vertex2->y));
+		maxX = max(maxX, max(vertex1->x, vertex2->x));
+		maxY = max(maxY, max(vertex1->y, vertex2->y));
+	}
+
+	if (minX <= maxX)
+		m_map.MarkCellsDirty(minX, minY, maxX, maxY);
+}
+
+void CEditor::AddDrawingVertex(Vertex &vertex)
+{
+	vector<Vertex> crossings;
+
+	if (m_sector.vertexCount > 2 && AABBContainsPoint(vertex.x, vertex.y, m_sector.firstVertex->GetData()->x - 2, m_sector.firstVertex->GetData()->y - 2, m_sector.firstVertex->GetData()->x + 2, m_sector.firstVertex->GetData()->y + 2))
+	{
+		FindCrossings(*m_line.vertex1->GetData(), *m_sector.firstVertex->GetData(), crossings);
+
+		for (Vertex &crossing : crossings)
+			AppendDrawingVertex(crossing);
+
+		CloseSector(m_map, m_sector, m_line);
+		InitializeSector(m_sector);
+		m_drawing = false;
+	}
+	else
+	{
+		if (m_sector.vertexCount > 0)
+			FindCrossings(*m_line.vertex1->GetData(), vertex, crossings);
+
+		for (Vertex &crossing : crossings)
+			AppendDrawingVertex(crossing);
+
+		AppendDrawingVertex(vertex);
+	}
+}
+
+void CEditor::AppendDrawingVertex(Vertex &vertex)
+{
+	AppendSectorVertex(m_map, m_sector, m_line, vertex);
+	m_drawing = true;
+}
+
+// Points where the new line from vertex1 to vertex2 crosses lines of
+// closed sectors, ordered from vertex1. Inserting a drawing vertex at one
+// of them splits the crossed line there.
+void CEditor::FindCrossings(const Vertex &vertex1, const Vertex &vertex2, vector<Vertex> &crossings)
+{
+	vector<SegmentIntersection> intersections;
+
+	crossings.clear();
+
+	// The grid is only rebuilt after line geometry has changed.
+	if (m_segmentGrid.GetVersion() != m_map.GetLineVersion())
+	{
+		m_segmentGrid.Clear();
+
+		if (!m_map.GetLines()->IsEmpty())
+		{
+			for (CNode<Line> *currentLine = m_map.GetLines()->Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+			{
+				if (currentLine->VisitNode() != 0 || currentLine->GetData()->sectors[0] == nullptr)
+					continue;
+
+				const Vertex *lineVertex1 = currentLine->GetData()->vertex1->GetData();
+				const Vertex *lineVertex2 = currentLine->GetData()->vertex2->GetData();
+				m_segmentGrid.Insert({ lineVertex1->x, lineVertex1->y, lineVertex2->x, lineVertex2->y, 0 });
+			}
+		}
+
+		m_segmentGrid.SetVersion(m_map.GetLineVersion());
+	}
+
+	m_segmentGrid.Query({ vertex1.x, vertex1.y, vertex2.x, vertex2.y, 0 }, intersections);
+
+	// Crossings are rounded to whole units, so ones that land on an end of
+	// the new line or on the previous crossing are dropped.
+	for (const SegmentIntersection &intersection : intersections)
+	{
+		Vertex crossing;
+		GetIntersectionPoint(intersection, crossing.x, crossing.y);
+
+		const Vertex &previous = (crossings.empty() ? vertex1 : crossings.back());
+
+		if ((crossing.x == previous.x && crossing.y == previous.y) || (crossing.x == vertex2.x && crossing.y == vertex2.y))
+			continue;
+
+		crossings.push_back(crossing);
+	}
+}
+
+// Splits every pair of crossing lines in the map at their crossing point.
+// The two lines get separate vertices at the point, the same as lines
+// that were drawn on top of each other.
+void CEditor::SplitCrossingLines()
+{
+	vector<CNode<Line> *> lineNodes;
+	vector<Segment> segments;
+	vector<SegmentIntersection> intersections;
+
+	if (m_map.GetLines()->IsEmpty())
+		return;
+
+	for (CNode<Line> *currentLine = m_map.GetLines()->Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+	{
+		if (currentLine->VisitNode() != 0 || currentLine->GetData()->sectors[0] == nullptr)
+			continue;
+
+		const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
+		const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
+		segments.push_back({ vertex1->x, vertex1->y, vertex2->x, vertex2->y, (unsigned int)lineNodes.size() });
+		lineNodes.push_back(currentLine);
+	}
+
+	FindIntersections(segments, intersections);
+
+	// Each crossing splits both lines, so it is recorded once per line with
+	// t measured along that line.
+	vector<SegmentIntersection> splits;
+
+	for (const SegmentIntersection &intersection : intersections)
+	{
+		SegmentIntersection split;
+
+		splits.push_back(intersection);
+
+		if (SegmentsCross(segments[intersection.segment2], segments[intersection.segment1], &split))
+			splits.push_back(split);
+	}
+
+	// Splitting a line keeps the original node as the part nearest its
+	// second vertex, so the points are applied from the first vertex on.
+	sort(splits.begin(), splits.end(), [](const SegmentIntersection &split1, const SegmentIntersection &split2)
+	{
+		if (split1.segment1 != split2.segment1)
+			return split1.segment1 < split2.segment1;
+
+		return IsCloserAlongSegment(split1, split2);
+	});
+
+	for (const SegmentIntersection &split : splits)
+	{
+		Line *line = lineNodes[split.segment1]->GetData();
+		int32_t x, y;
+
+		GetIntersectionPoint(split, x, y);
+		m_map.MarkCellsDirty(min(line->vertex1->GetData()->x, line->vertex2->GetData()->x), min(line->vertex1->GetData()->y, line->vertex2->GetData()->y), max(line->vertex1->GetData()->x, line->vertex2->GetData()->x), max(line->vertex1->GetData()->y, line->vertex2->GetData()->y));
+		SplitLine(m_map, lineNodes[split.segment1], x, y);
+	}
+}
+
+void CEditor::GetSelectedSectors(vector<CNode<Sector> *> &sectors)
+{
+	sectors.clear();
+
+	for (CNode<Sector> *currentSector = m_map.GetSectors()->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+	{
+		if (m_selectedSectors.Contains(currentSector->GetData()->handle))
+			sectors.push_back(currentSector);
+	}
+}
+
+// Vertices are shared between neighbouring sectors, so the list is sorted
+// and each vertex appears once.
+void CEditor::GetSectorVertices(const vector<CNode<Sector> *> &sectors, vector<Vertex *> &vertices)
+{
+	vertices.clear();
+
+	for (CNode<Sector> *sector : sectors)
+	{
+		CNode<Vertex> *currentVertex = sector->GetData()->firstVertex;
+
+		for (unsigned int vertexCount = sector->GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+			vertices.push_back(currentVertex->GetData());
+	}
+
+	sort(vertices.begin(), vertices.end());
+	vertices.erase(unique(vertices.begin(), vertices.end()), vertices.end());
+}
+
+void CEditor::SelectSectorsInBox()
+{
+	vector<CNode<Sector> *> sectors;
+
+	// The grid is only rebuilt after geometry has changed.
+	if (m_sectorGrid.GetVersion() != m_map.GetLineVersion())
+	{
+		m_sectorGrid.Clear();
+
+		for (CNode<Sector> *currentSector = m_map.GetSectors()->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+			m_sectorGrid.Insert(currentSector);
+
+		m_sectorGrid.SetVersion(m_map.GetLineVersion());
+	}
+
+	m_sectorGrid.Query(min(m_boxX1, m_boxX2), min(m_boxY1, m_boxY2), max(m_boxX1, m_boxX2), max(m_boxY1, m_boxY2), sectors);
+
+	for (CNode<Sector> *sector : sectors)
+		m_selectedSectors.Insert(sector->GetData()->handle);
+}
+
+void CEditor::DeleteSelectedSectors()
+{
+	vector<CNode<Sector> *> sectors;
+	vector<Vertex *> vertices;
+
+	GetSelectedSectors(sectors);
+	GetSectorVertices(sectors, vertices);
+	MarkVerticesDirty(vector<const Vertex *>(vertices.begin(), vertices.end()));
+
+	for (CNode<Sector> *sector : sectors)
+	{
+		if (sector == m_operandSector)
+			m_operandSector = nullptr;
+
+		DeleteSector(m_map, *sector);
+	}
+
+	m_selectedSectors.Clear();
+	m_selection = SELECTION_NONE;
+}
+
+void CEditor::CopySelectedSectors()
+{
+	vector<CNode<Sector> *> sectors;
+	size_t pointCount = 0;
+
+	GetSelectedSectors(sectors);
+
+	if (sectors.empty())
+		return;
+
+	for (CNode<Sector> *sector : sectors)
+		pointCount += sector->GetData()->lineCount;
+
+	m_clipboard.points.clear();
+	m_clipboard.lineTextures.clear();
+	m_clipboard.lineFlags.clear();
+	m_clipboard.sectorStarts.clear();
+	m_clipboard.floorTextures.clear();
+	m_clipboard.ceilingTextures.clear();
+	m_clipboard.points.reserve(pointCount);
+	m_clipboard.lineTextures.reserve(pointCount);
+	m_clipboard.lineFlags.reserve(pointCount);
+	m_clipboard.minX = m_clipboard.minY = INT32_MAX;
+
+	for (CNode<Sector> *sector : sectors)
+	{
+		CNode<Line> *currentLine = sector->GetData()->firstLine;
+
+		m_clipboard.sectorStarts.push_back((unsigned int)m_clipboard.points.size());
+		m_clipboard.floorTextures.push_back(sector->GetData()->floorTexture);
+		m_clipboard.ceilingTextures.push_back(sector->GetData()->ceilingTexture);
+		m_clipboard.minX = min(m_clipboard.minX, sector->GetData()->minX);
+		m_clipboard.minY = min(m_clipboard.minY, sector->GetData()->minY);
+
+		for (unsigned int lineCount = sector->GetData()->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+		{
+			const Line *line = currentLine->GetData();
+
+			m_clipboard.points.push_back(*(line->sectors[0] == sector->GetData() ? line->vertex1->GetData() : line->vertex2->GetData()));
+			m_clipboard.lineTextures.push_back(m_map.GetLineTexture(line->handle));
+			m_clipboard.lineFlags.push_back(m_map.GetLineFlags(line->handle));
+		}
+	}
+}
+
+// Pastes the clipboard with its top left corner at x, y. Pasted sectors
+// that touched each other when copied share their lines again, and the
+// pasted sectors become the selection.
+void CEditor::PasteSectors(int32_t x, int32_t y)
+{
+	int32_t xOffset = x - m_clipboard.minX, yOffset = y - m_clipboard.minY;
+
+	m_selectedSectors.Clear();
+
+	for (size_t i = 0; i < m_clipboard.sectorStarts.size(); i++)
+	{
+		unsigned int start = m_clipboard.sectorStarts[i];
+		unsigned int end = (i + 1 < m_clipboard.sectorStarts.size() ? m_clipboard.sectorStarts[i + 1] : (unsigned int)m_clipboard.points.size());
+		Sector sector;
+		Line line;
+
+		InitializeSector(sector);
+		line.sectors[0] = line.sectors[1] = nullptr;
+
+		for (unsigned int j = start; j < end; j++)
+		{
+			Vertex vertex;
+			vertex.x = m_clipboard.points[j].x + xOffset;
+			vertex.y = m_clipboard.points[j].y + yOffset;
+			AppendSectorVertex(m_map, sector, line, vertex);
+		}
+
+		CNode<Sector> *newSector = CloseSector(m_map, sector, line);
+		newSector->GetData()->floorTexture = m_clipboard.floorTextures[i];
+		newSector->GetData()->ceilingTexture = m_clipboard.ceilingTextures[i];
+		m_selectedSectors.Insert(newSector->GetData()->handle);
+
+		if (newSector->GetData()->lineCount != end - start)
+			continue;
+
+		CNode<Line> *currentLine = newSector->GetData()->firstLine;
+
+		for (unsigned int j = start; j < end; j++, currentLine = currentLine->Next())
+		{
+			if (currentLine->GetRefCount() == 1)
+			{
+				m_map.SetLineTexture(currentLine->GetData()->handle, m_clipboard.lineTextures[j]);
+				m_map.SetLineFlags(currentLine->GetData()->handle, m_clipboard.lineFlags[j]);
+			}
+		}
+	}
+}
+
+// Replaces the marked sector and the selected sector with the result of
+// combining them. Union and intersection consume both. Difference removes
+// the selected sector's area from the marked one and consumes both too,
+// so subtracting a pillar leaves walls facing into the room.
+void CEditor::ApplyBooleanOperation(ClipOperation operation)
+{
+	if (m_operandSector == nullptr || m_selection != SELECTION_SECTOR || m_selectedSector == m_operandSector)
+		return;
+
+	const Sector *sectors[2] = { m_operandSector->GetData(), m_selectedSector->GetData() };
+	vector<ClipLoop> loops[2];
+	vector<uint16_t> textures[2], flags[2];
+	vector<ClipLoop> result;
+	CPolygonClipper clipper;
+
+	for (int polygon = 0; polygon < 2; polygon++)
+	{
+		loops[polygon].resize(1);
+		GetSectorLoop(*sectors[polygon], polygon, loops[polygon][0]);
+
+		CNode<Line> *currentLine = sectors[polygon]->firstLine;
+
+		for (unsigned int lineCount = sectors[polygon]->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+		{
+			textures[polygon].push_back(m_map.GetLineTexture(currentLine->GetData()->handle));
+			flags[polygon].push_back(m_map.GetLineFlags(currentLine->GetData()->handle));
+		}
+	}
+
+	clipper.Clip(loops[0], loops[1], operation, result);
+	clipper.SplitHoles(result);
+
+	if (result.empty())
+		return;
+
+	unsigned char floorTexture = sectors[0]->floorTexture;
+	unsigned char ceilingTexture = sectors[0]->ceilingTexture;
+	vector<const Vertex *> vertices;
+
+	for (const Sector *sector : sectors)
+	{
+		CNode<Vertex> *currentVertex = sector->firstVertex;
+
+		for (unsigned int vertexCount = sector->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+			vertices.push_back(currentVertex->GetData());
+	}
+
+	MarkVerticesDirty(vertices);
+
+	m_selectedSectors.Erase(sectors[0]->handle);
+	m_selectedSectors.Erase(sectors[1]->handle);
+	DeleteSector(m_map, *m_operandSector);
+	DeleteSector(m_map, *m_selectedSector);
+	m_operandSector = nullptr;
+	m_selection = SELECTION_NONE;
+
+	for (const ClipLoop &loop : result)
+	{
+		Sector sector;
+		Line line;
+
+		InitializeSector(sector);
+		line.sectors[0] = line.sectors[1] = nullptr;
+
+		// Points are rounded to whole units. A point that lands on the one
+		// before it is merged into it and keeps the tag of the edge that
+		// still has length. Loops that collapse are dropped.
+		vector<Vertex> points;
+		vector<const ClipVertex *> tags;
+
+		for (const ClipVertex &clipVertex : loop)
+		{
+			Vertex point = { int32_t(lround(clipVertex.x)), int32_t(lround(clipVertex.y)) };
+
+			if (!points.empty() && point.x == points.back().x && point.y == points.back().y)
+			{
+				tags.back() = &clipVertex;
+				continue;
+			}
+
+			points.push_back(point);
+			tags.push_back(&clipVertex);
+		}
+
+		if (points.size() > 1 && points.back().x == points.front().x && points.back().y == points.front().y)
+		{
+			points.pop_back();
+			tags.pop_back();
+		}
+
+		if (points.size() < 3)
+			continue;
+
+		for (Vertex &vertex : points)
+			AppendSectorVertex(m_map, sector, line, vertex);
+
+		CNode<Sector> *newSector = CloseSector(m_map, sector, line);
+		newSector->GetData()->floorTexture = floorTexture;
+		newSector->GetData()->ceilingTexture = ceilingTexture;
+
+		if (newSector->GetData()->lineCount != tags.size())
+			continue;
+
+		// Lines shared with a neighbour keep the neighbour's attributes.
+		CNode<Line> *currentLine = newSector->GetData()->firstLine;
+
+		for (const ClipVertex *clipVertex : tags)
+		{
+			if (currentLine->GetRefCount() == 1 && clipVertex->polygon >= 0)
+			{
+				uint16_t lineFlags = flags[clipVertex->polygon][clipVertex->edge];
+
+				// Walls of the subtracted sector now face the other way.
+				if (operation == CLIP_DIFFERENCE && clipVertex->polygon == 1)
+					lineFlags &= ~(LF_NORTH_FACING_WALL | LF_SOUTH_FACING_WALL | LF_EAST_FACING_WALL | LF_WEST_FACING_WALL);
+
+				m_map.SetLineTexture(currentLine->GetData()->handle, textures[clipVertex->polygon][clipVertex->edge]);
+				m_map.SetLineFlags(currentLine->GetData()->handle, lineFlags);
+			}
+
+			currentLine = currentLine->Next();
+		}
+	}
+}
+
+bool SectorIsClockwise(const Sector &sector)
+{
+	int64_t sum = 0;
+	CNode<Vertex> *currentVertex = sector.firstVertex;
+
+	for (unsigned int vertexCount = sector.vertexCount - 1; vertexCount-- != 0; currentVertex = currentVertex->Next())
+	{
+		const Vertex *vertex1 = currentVertex->GetData();
+		const Vertex *vertex2 = currentVertex->Next()->GetData();
+		sum += (int64_t(vertex2->x) - vertex1->x) * (int64_t(vertex2->y) + vertex1->y);
+	}
+
+	const Vertex *vertex1 = currentVertex->GetData();
+	const Vertex *vertex2 = sector.firstVertex->GetData();
+	sum += (int64_t(vertex2->x) - vertex1->x) * (int64_t(vertex2->y) + vertex1->y);
+
+	return (sum < 0);
+}
+
+bool AABBContainsPoint(int32_t x, int32_t y, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY)
+{
+	return (x >= minX && y >= minY && x <= maxX && y <= maxY);
+}
+
+bool AABBContainsSegment(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY)
+{
+	if ((x1 < minX && x2 < minX) || (y1 < minY && y2 < minY) || (x1 > maxX && x2 > maxX) || (y1 > maxY && y2 > maxY))
+		return false;
+
+	// The bounds overlap, so the segment misses the box only if every corner
+	// lies strictly on the same side of it.
+	Vertex vertex1 = { x1, y1 }, vertex2 = { x2, y2 };
+	int64_t sides[4] = { Orientation(vertex1, vertex2, minX, minY), Orientation(vertex1, vertex2, maxX, minY), Orientation(vertex1, vertex2, maxX, maxY), Orientation(vertex1, vertex2, minX, maxY) };
+	bool left = false, right = false;
+
+	for (int64_t side : sides)
+	{
+		left |= (side >= 0);
+		right |= (side <= 0);
+	}
+
+	return (left && right);
+}
+
+Selection FindSelection(CList<Sector> *sectors, int32_t x, int32_t y, CNode<Sector> **selectedSector, CNode<Line> **selectedLine, CNode<Vertex> **selectedVertex)
+{
+	if (selectedSector == nullptr && selectedLine == nullptr && selectedVertex == nullptr)
+		return SELECTION_NONE;
+
+	for (CNode<Sector> *currentSector = sectors->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+	{
+		if (!AABBContainsPoint(x, y, currentSector->GetData()->minX - 3, currentSector->GetData()->minY - 3, currentSector->GetData()->maxX + 3, currentSector->GetData()->maxY + 3))
+			continue;
+
+		CNode<Line> *currentLine = currentSector->GetData()->firstLine;
+
+		for (unsigned int lineCount = currentSector->GetData()->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+		{
+			const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
+			const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
+
+			if (selectedVertex != nullptr && AABBContainsPoint(x, y, vertex1->x - 2, vertex1->y - 2, vertex1->x + 2, vertex1->y + 2))
+			{
+				*selectedVertex = currentLine->GetData()->vertex1;
+				return SELECTION_VERTEX;
+			}
+
+			if (selectedVertex != nullptr && AABBContainsPoint(x, y, vertex2->x - 2, vertex2->y - 2, vertex2->x + 2, vertex2->y + 2))
+			{
+				*selectedVertex = currentLine->GetData()->vertex2;
+				return SELECTION_VERTEX;
+			}
+
+			if (selectedLine != nullptr && AABBContainsSegment(vertex1->x, vertex1->y, vertex2->x, vertex2->y, x - 2, y - 2, x + 2, y + 2))
+			{
+				*selectedLine = currentLine;
+				return SELECTION_LINE;
+			}
+		}
+
+		if (selectedSector != nullptr && SectorContainsPoint(*currentSector->GetData(), x, y))
+		{
+			*selectedSector = currentSector;
+			return SELECTION_SECTOR;
+		}
+	}
+
+	return SELECTION_NONE;
+}
+
+CNode<Line> *FindLine(const CList<Line> *lines, const Vertex *vertex1, const Vertex *vertex2)
+{
+	for (CNode<Line> *currentLine = lines->Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+	{
+		const Line *line = currentLine->GetData();
+
+		if ((line->vertex1->GetData() == vertex1 && line->vertex2->GetData() == vertex2) || (line->vertex1->GetData() == vertex2 && line->vertex2->GetData() == vertex1))
+			return currentLine;
+	}
+
+	return nullptr;
+}
+
+void ProjectPointOnSegment(const Vertex &vertex1, const Vertex &vertex2, int32_t x, int32_t y, Vertex &vertexOut)
+{
+	int64_t dx = int64_t(vertex2.x) - vertex1.x, dy = int64_t(vertex2.y) - vertex1.y;
+	double t = double(dx * (x - vertex1.x) + dy * (y - vertex1.y)) / double(dx * dx + dy * dy);
+	vertexOut.x = vertex1.x + int32_t(lround(dx * t));
+	vertexOut.y = vertex1.y + int32_t(lround(dy * t));
+}
+
+void CalculateSectorAABB(Sector &sector)
+{
+	sector.minX = sector.minY = INT32_MAX;
+	sector.maxX = sector.maxY = INT32_MIN;
+	CNode<Vertex> *currentVertex = sector.firstVertex;
+
+	for (unsigned int vertexCount = sector.vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+	{
+		if (currentVertex->GetData()->x < sector.minX)
+			sector.minX = currentVertex->GetData()->x;
+
+		if (currentVertex->GetData()->y < sector.minY)
+			sector.minY = currentVertex->GetData()->y;
+
+		if (currentVertex->GetData()->x > sector.maxX)
+			sector.maxX = currentVertex->GetData()->x;
+
+		if (currentVertex->GetData()->y > sector.maxY)
+			sector.maxY = currentVertex->GetData()->y;
+	}
+}
+
+// The sector's outline in line order, with each edge tagged with its line
+// index so that the clipper can report where result edges came from.
+void GetSectorLoop(const Sector &sector, int polygon, ClipLoop &loop)
+{
+	CNode<Line> *currentLine = sector.firstLine;
+
+	loop.clear();
+
+	for (unsigned int i = 0; i < sector.lineCount; i++, currentLine = currentLine->Next())
+	{
+		const Line *line = currentLine->GetData();
+		const Vertex *vertex = (line->sectors[0] == &sector ? line->vertex1->GetData() : line->vertex2->GetData());
+		loop.push_back({ double(vertex->x), double(vertex->y), polygon, i });
+	}
+}
+
+void InitializeSector(Sector &sector)
+{
+	sector = Sector();
+	sector.vertexCount = 0;
+	sector.lineCount = 0;
+	sector.minX = sector.minY = INT32_MAX;
+	sector.maxX = sector.maxY = INT32_MIN;
+}
+
+void ReleaseLineHandles(CMap &map, CNode<Line> *start, CNode<Line> *end)
+{
+	// Shared lines stay alive in the neighbouring sector.
+	for (CNode<Line> *currentLine = start; currentLine != end; currentLine = currentLine->Next())
+	{
+		if (currentLine->GetRefCount() == 1)
+			map.ReleaseLineHandle(currentLine->GetData()->handle);
+	}
+}
+
+void CancelSector(CMap &map, Sector &sector)
+{
+	if (sector.lineCount > 0)
+	{
+		ReleaseLineHandles(map, sector.firstLine, sector.lastLine->Next());
+		map.GetVertices()->Delete(sector.firstVertex, sector.lastVertex->Next());
+		map.GetLines()->Delete(sector.firstLine, sector.lastLine->Next());
+	}
+	else
+		map.GetVertices()->Delete(sector.firstVertex);
+}
+
+void DeleteSector(CMap &map, CNode<Sector> &sector)
+{
+	CNode<Line> *currentLine = sector.GetData()->firstLine;
+
+	for (unsigned int lineCount = sector.GetData()->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+	{
+		if (currentLine->GetRefCount() == 2)
+		{
+			if (currentLine->GetData()->sectors[0] == sector.GetData())
+			{
+				CNode<Vertex> *currentVertex = currentLine->GetData()->sectors[1]->firstVertex;
+
+				for (unsigned int vertexCount = currentLine->GetData()->sectors[1]->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+				{
+					if (currentVertex->GetData() == currentLine->GetData()->vertex2->GetData())
+					{
+						currentLine->GetData()->vertex1 = currentVertex;
+						currentLine->GetData()->vertex2 = (vertexCount != 0 ? currentVertex->Next() : currentLine->GetData()->sectors[1]->firstVertex);
+
+						break;
+					}
+				}
+
+				currentLine->GetData()->sectors[0] = currentLine->GetData()->sectors[1];
+				currentLine->GetData()->sectors[1] = nullptr;
+			}
+			else
+				currentLine->GetData()->sectors[1] = nullptr;
+
+			map.MarkLineDirty(*currentLine->GetData());
+		}
+	}
+
+	map.ClearSectorFill(*sector.GetData());
+	map.ReleaseSectorHandle(sector.GetData()->handle);
+	ReleaseLineHandles(map, sector.GetData()->firstLine, sector.GetData()->lastLine->Next());
+	map.GetVertices()->Delete(sector.GetData()->firstVertex, sector.GetData()->lastVertex->Next());
+	map.GetLines()->Delete(sector.GetData()->firstLine, sector.GetData()->lastLine->Next());
+	map.GetSectors()->Delete(&sector);
+}
+
+CNode<Vertex> *SplitLine(CMap &map, CNode<Line> *lineNode, int32_t x, int32_t y)
+{
+	Line *line = lineNode->GetData();
+	Vertex *newVertex = new Vertex;
+	ProjectPointOnSegment(*line->vertex1->GetData(), *line->vertex2->GetData(), x, y, *newVertex);
+	CNode<Vertex> *newVertexNode = map.GetVertices()->Insert(newVertex, true, line->vertex1);
+	CNode<Vertex> *splitVertexNode = newVertexNode;
+	Line *newLine = new Line;
+	newLine->vertex1 = line->vertex1;
+	newLine->vertex2 = newVertexNode;
+	newLine->sectors[0] = line->sectors[0];
+	newLine->sectors[1] = line->sectors[1];
+	newLine->handle = map.CreateLineHandle(map.GetLineTexture(line->handle), map.GetLineFlags(line->handle), map.GetLineSource(line->handle));
+	line->vertex1 = newVertexNode;
+	map.MarkLineDirty(*line);
+	map.MarkLineDirty(*newLine);
+	CNode<Line> *newLineNode = map.GetLines()->Insert(newLine, true, lineNode->Prev());
+
+	line->sectors[0]->vertexCount++;
+	line->sectors[0]->lineCount++;
+	map.MarkSectorDirty(*line->sectors[0]);
+
+	if (lineNode == line->sectors[0]->firstLine)
+		line->sectors[0]->firstLine = newLineNode;
+	else if (lineNode == line->sectors[0]->lastLine)
+		line->sectors[0]->lastVertex = newVertexNode;
+
+	if (line->sectors[1] != nullptr)
+	{
+		CNode<Vertex> *currentVertex = line->sectors[1]->firstVertex;
+
+		for (unsigned int vertexCount = line->sectors[1]->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+		{
+			if (currentVertex->GetData() == line->vertex2->GetData())
+			{
+				newVertexNode = map.GetVertices()->Insert(newVertexNode, currentVertex);
+
+				break;
+			}
+		}
+
+		CNode<Line> *currentLine = line->sectors[1]->firstLine;
+
+		for (unsigned int lineCount = line->sectors[1]->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+		{
+			if (currentLine->GetData() == line)
+			{
+				newLineNode = map.GetLines()->Insert(newLineNode, currentLine);
+
+				if (currentLine == line->sectors[1]->lastLine)
+				{
+					line->sectors[1]->lastLine = newLineNode;
+					line->sectors[1]->lastVertex = newVertexNode;
+				}
+
+				break;
+			}
+		}
+
+		line->sectors[1]->vertexCount++;
+		line->sectors[1]->lineCount++;
+		map.MarkSectorDirty(*line->sectors[1]);
+	}
+
+	return splitVertexNode;
+}
+
+CNode<Vertex> *InsertVertex(CMap &map, Vertex &vertex)
+{
+	CNode<Vertex> *selectedVertex = nullptr;
+	CNode<Line> *selectedLine = nullptr;
+	Selection selection = FindSelection(map.GetSectors(), vertex.x, vertex.y, nullptr, &selectedLine, &selectedVertex);
+
+	if (selection == SELECTION_VERTEX)
+		return map.GetVertices()->Insert(selectedVertex);
+	else if (selection == SELECTION_LINE)
+		return map.GetVertices()->Insert(SplitLine(map, selectedLine, vertex.x, vertex.y));
+	else
+		return map.GetVertices()->Insert(new Vertex(vertex));
+}
+
+void AppendSectorVertex(CMap &map, Sector &sector, Line &line, Vertex &vertex)
+{
+	line.vertex2 = InsertVertex(map, vertex);
+
+	if (line.vertex2->GetData()->x < sector.minX)
+		sector.minX = line.vertex2->GetData()->x;
+
+	if (line.vertex2->GetData()->y < sector.minY)
+		sector.minY = line.vertex2->GetData()->y;
+
+	if (line.vertex2->GetData()->x > sector.maxX)
+		sector.maxX = line.vertex2->GetData()->x;
+
+	if (line.vertex2->GetData()->y > sector.maxY)
+		sector.maxY = line.vertex2->GetData()->y;
+
+	if ((++sector.vertexCount % 2) == 0)
+	{
+		CNode<Line> *newLineNode = InsertLine(map, line);
+
+		if (sector.lineCount++ == 0)
+			sector.firstLine = sector.lastLine = newLineNode;
+		else
+			sector.lastLine = newLineNode;
+
+		sector.vertexCount++;
+	}
+
+	line.vertex1 = line.vertex2;
+
+	if (sector.vertexCount == 1)
+		sector.firstVertex = sector.lastVertex = line.vertex1;
+	else
+		sector.lastVertex = line.vertex1;
+}
+
+CNode<Line> *InsertLine(CMap &map, Line &line)
+{
+	if (line.vertex1->GetRefCount() > 1 && line.vertex2->GetRefCount() > 1)
+	{
+		CNode<Line> *refLineNode = FindLine(map.GetLines(), line.vertex1->GetData(), line.vertex2->GetData());
+
+		if (refLineNode != nullptr)
+			return map.GetLines()->Insert(refLineNode);
+	}
+
+	line.handle = map.CreateLineHandle();
+
+	return map.GetLines()->Insert(new Line(line));
+}
+
+CNode<Sector> *InsertSector(CMap &map, Sector &sector)
+{
+	if (!SectorIsClockwise(sector))
+	{
+		CNode<Vertex> *tempVertexNode = sector.firstVertex->Next();
+
+		map.GetVertices()->Reverse(sector.firstVertex->Next(), sector.lastVertex->Next());
+		map.GetLines()->Reverse(sector.firstLine, sector.lastLine->Next());
+
+		sector.lastVertex = tempVertexNode;
+
+		CNode<Line> *tempLineNode = sector.firstLine;
+		sector.firstLine = sector.lastLine;
+		sector.lastLine = tempLineNode;
+
+		CNode<Line> *currentLine = sector.firstLine;
+
+		for (unsigned int lineCount = sector.lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+		{
+			if (currentLine->GetRefCount() == 1)
+			{
+				tempVertexNode = currentLine->GetData()->vertex1;
+				currentLine->GetData()->vertex1 = currentLine->GetData()->vertex2;
+				currentLine->GetData()->vertex2 = tempVertexNode;
+			}
+		}
+	}
+
+	sector.handle = map.CreateSectorHandle();
+
+	Sector *newSector = new Sector(sector);
+	map.MarkSectorDirty(*newSector);
+
+	CNode<Line> *currentLine = sector.firstLine;
+
+	for (unsigned int lineCount = sector.lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+	{
+		map.MarkLineDirty(*currentLine->GetData());
+
+		if (currentLine->GetRefCount() == 1)
+			currentLine->GetData()->sectors[0] = newSector;
+		else
+			currentLine->GetData()->sectors[1] = newSector;
+	}
+
+	return map.GetSectors()->Insert(newSector);
+}
+
+CNode<Sector> *CloseSector(CMap &map, Sector &sector, Line &line)
+{
+	line.vertex2 = sector.firstVertex;
+
+	sector.floorTexture = map.GetHeader().floorTexture;
+	sector.ceilingTexture = map.GetHeader().ceilingTexture;
+	sector.vertexCount = (sector.vertexCount + 1) / 2;
+	sector.lineCount++;
+	sector.lastLine = InsertLine(map, line);
+
+	CNode<Sector> *newSector = InsertSector(map, sector);
+	map.MarkCellsDirty(newSector->GetData()->minX, newSector->GetData()->minY, newSector->GetData()->maxX, newSector->GetData()->maxY);
+
+	return newSector;
+}
+
+void MoveVertex(Vertex &vertex, int x, int y, CGrid &grid)
+{
+	vertex.x = x;
+	vertex.y = y;
+
+	grid.Snap(vertex.x, vertex.y);
+}
+
+void MoveLine(Line &line, int x, int y, int referenceX, int referenceY, int &initialX, int &initialY, CGrid &grid)
+{
+	int finalX = grid.ScaleToGridSpace(x - referenceX) / grid.GetCellSize();
+	int finalY = grid.ScaleToGridSpace(y - referenceY) / grid.GetCellSize();
+
+	int32_t xDisplacement = (finalX - initialX) * grid.GetCellSize(), yDisplacement = (finalY - initialY) * grid.GetCellSize();
+
+	line.vertex1->GetData()->x += xDisplacement;
+	line.vertex1->GetData()->y += yDisplacement;
+	line.vertex2->GetData()->x += xDisplacement;
+	line.vertex2->GetData()->y += yDisplacement;
+
+	initialX = finalX;
+	initialY = finalY;
+}
+
+void MoveSector(Sector &sector, int x, int y, int referenceX, int referenceY, int &initialX, int &initialY, CGrid &grid)
+{
+	int finalX = grid.ScaleToGridSpace(x - referenceX) / grid.GetCellSize();
+	int finalY = grid.ScaleToGridSpace(y - referenceY) / grid.GetCellSize();
+
+	int32_t xDisplacement = (finalX - initialX) * grid.GetCellSize(), yDisplacement = (finalY - initialY) * grid.GetCellSize();
+
+	CNode<Line> *currentLine = sector.firstLine;
+
+	for (unsigned int lineCount = sector.lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+	{
+		Vertex *vertex = (currentLine->GetData()->sectors[0] == &sector ? currentLine->GetData()->vertex1->GetData() : currentLine->GetData()->vertex2->GetData());
+		vertex->x += xDisplacement;
+		vertex->y += yDisplacement;
+	}
+
+	sector.minX += xDisplacement;
+	sector.minY += yDisplacement;
+	sector.maxX += xDisplacement;
+	sector.maxY += yDisplacement;
+
+	initialX = finalX;
+	initialY = finalY;
+}
+
+void MoveVertices(vector<Vertex *> &vertices, int x, int y, int referenceX, int referenceY, int &initialX, int &initialY, CGrid &grid)
+{
+	int finalX = grid.ScaleToGridSpace(x - referenceX) / grid.GetCellSize();
+	int finalY = grid.ScaleToGridSpace(y - referenceY) / grid.GetCellSize();
+
+	int32_t xDisplacement = (finalX - initialX) * grid.GetCellSize(), yDisplacement = (finalY - initialY) * grid.GetCellSize();
+
+	for (Vertex *vertex : vertices)
+	{
+		vertex->x += xDisplacement;
+		vertex->y += yDisplacement;
+	}
+
+	initialX = finalX;
+	initialY = finalY;
+}
+
+void RecalculateSectorsAABB(CMap &map, CNode<Vertex> &vertex)
+{
+	unsigned int refCount = vertex.GetRefCount();
+	bool allReferencesFound = false;
+
+	for (CNode<Sector> *currentSector = map.GetSectors()->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+	{
+		CNode<Vertex> *currentVertex = currentSector->GetData()->firstVertex;
+
+		for (unsigned int vertexCount = currentSector->GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+		{
+			if (currentVertex->GetData() == vertex.GetData())
+			{
+				allReferencesFound = (--refCount == 0);
+
+				CalculateSectorAABB(*currentSector->GetData());
+
+				break;
+			}
+		}
+
+		if (allReferencesFound)
+			break;
+	}
+}
+
+void RecalculateSectorsAABB(CMap &map, CNode<Line> &line)
+{
+	unsigned int refCount = line.GetData()->vertex1->GetRefCount() + line.GetData()->vertex2->GetRefCount();
+	bool allReferencesFound = false;
+
+	for (CNode<Sector> *currentSector = map.GetSectors()->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+	{
+		CNode<Vertex> *currentVertex = currentSector->GetData()->firstVertex;
+
+		for (unsigned int vertexCount = currentSector->GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+		{
+			if (currentVertex->GetData() == line.GetData()->vertex1->GetData())
+			{
+				allReferencesFound = (--refCount == 0);
+
+				if ((currentVertex != currentSector->GetData()->lastVertex && currentVertex->Next()->GetData() == line.GetData()->vertex2->GetData()) ||
+					(currentSector->GetData()->firstVertex->GetData() == line.GetData()->vertex2->GetData()) ||
+					(currentVertex != currentSector->GetData()->firstVertex && currentVertex->Prev()->GetData() == line.GetData()->vertex2->GetData()) ||
+					(currentSector->GetData()->lastVertex->GetData() == line.GetData()->vertex2->GetData()))
+					allReferencesFound = (--refCount == 0);
+
+				CalculateSectorAABB(*currentSector->GetData());
+
+				break;
+			}
+			else if (currentVertex->GetData() == line.GetData()->vertex2->GetData())
+			{
+				allReferencesFound = (--refCount == 0);
+
+				if ((currentVertex != currentSector->GetData()->lastVertex && currentVertex->Next()->GetData() == line.GetData()->vertex1->GetData()) ||
+					(currentSector->GetData()->firstVertex->GetData() == line.GetData()->vertex1->GetData()) ||
+					(currentVertex != currentSector->GetData()->firstVertex && currentVertex->Prev()->GetData() == line.GetData()->vertex1->GetData()) ||
+					(currentSector->GetData()->lastVertex->GetData() == line.GetData()->vertex1->GetData()))
+					allReferencesFound = (--refCount == 0);
+
+				CalculateSectorAABB(*currentSector->GetData());
+
+				break;
+			}
+		}
+
+		if (allReferencesFound)
+			break;
+	}
+}
+
+void RecalculateSectorsAABB(CMap &map, CNode<Sector> &sector)
+{
+	unsigned int refCount = 0;
+	bool allReferencesFound = false;
+	bool sectorReferencesVertices = false;
+	CNode<Vertex> *currentVertex = sector.GetData()->firstVertex;
+
+	for (unsigned int vertexCount = sector.GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+		refCount += currentVertex->GetRefCount() - 1;
+
+	if (refCount > 0)
+	{
+		for (CNode<Sector> *currentSector = map.GetSectors()->Head(); sector.GetData() != nullptr; currentSector = currentSector->Next())
+		{
+			if (currentSector == &sector)
+				continue;
+
+			CNode<Vertex> *currentVertex = currentSector->GetData()->firstVertex;
+
+			for (unsigned int vertexCount = currentSector->GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+			{
+				CNode<Vertex> *currentSelectedVertex = sector.GetData()->firstVertex;
+
+				for (unsigned int selectedVertexCount = sector.GetData()->vertexCount; selectedVertexCount-- != 0; currentSelectedVertex = currentSelectedVertex->Next())
+				{
+					if (currentVertex->GetData() == currentSelectedVertex->GetData())
+					{
+						allReferencesFound = (--refCount == 0);
+						sectorReferencesVertices = true;
+
+						if (allReferencesFound)
+							break;
+					}
+				}
+
+				if (allReferencesFound)
+					break;
+			}
+
+			if (sectorReferencesVertices)
+			{
+				CalculateSectorAABB(*currentSector->GetData());
+				sectorReferencesVertices = false;
+			}
+
+			if (allReferencesFound)
+				break;
+		}
+	}
+}
+
+// One pass over the sectors for a whole group of moved vertices, which
+// must be sorted.
+void RecalculateSectorsAABB(CMap &map, const vector<Vertex *> &vertices)
+{
+	for (CNode<Sector> *currentSector = map.GetSectors()->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+	{
+		CNode<Vertex> *currentVertex = currentSector->GetData()->firstVertex;
+
+		for (unsigned int vertexCount = currentSector->GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+		{
+			if (binary_search(vertices.begin(), vertices.end(), currentVertex->GetData()))
+			{
+				CalculateSectorAABB(*currentSector->GetData());
+				break;
+			}
+		}
+	}
+}
\ No newline at end of file
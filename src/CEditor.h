@@ -0,0 +1,209 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CEDITOR_H__
+#define __CEDITOR_H__
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CAutosave.h"
+#include "CChunkPager.h"
+#include "CCommandQueue.h"
+#include "CGrid.h"
+#include "CHandleSet.h"
+#include "CList.h"
+#include "CMap.h"
+#include "CMapSnapshot.h"
+#include "CMapVersion.h"
+#include "CPolygonClipper.h"
+#include "CSectorGrid.h"
+#include "CSegmentGrid.h"
+#include "CValidator.h"
+
+// Zoom is continuous between MIN_SCALE and MAX_SCALE, and each wheel notch
+// or zoom key multiplies or divides the scale by ZOOM_FACTOR.
+#define MIN_SCALE	(1.0f / 64.0f)
+#define MAX_SCALE	8.0f
+#define ZOOM_FACTOR	1.25f
+
+enum Mode
+{
+	MODE_DRAW,
+	MODE_MOVE,
+	MODE_VERTEX,
+	MODE_NONE
+};
+
+enum Selection
+{
+	SELECTION_VERTEX,
+	SELECTION_LINE,
+	SELECTION_SECTOR,
+	SELECTION_NONE
+};
+
+enum CommandType
+{
+	COMMAND_QUIT,
+	COMMAND_KEY_DOWN,
+	COMMAND_BUTTON_DOWN,
+	COMMAND_BUTTON_UP,
+	COMMAND_MOTION,
+	COMMAND_WHEEL,
+	COMMAND_RESIZE,
+	COMMAND_COPY,
+	COMMAND_PASTE,
+	COMMAND_TEXTURE_COUNT,
+	COMMAND_COUNT
+};
+
+// An input event as seen by the editor. key holds the key symbol, mouse
+// button, wheel delta or texture count, x and y hold the mouse position or
+// window size.
+struct Command
+{
+	CommandType type;
+	int key;
+	int x;
+	int y;
+};
+
+// Copied sectors. The outlines of all sectors are stored back to back in
+// points, and sectorStarts holds the index of each sector's first point.
+// Line attributes are those of the line leaving each point.
+struct Clipboard
+{
+	std::vector<Vertex> points;
+	std::vector<uint16_t> lineTextures;
+	std::vector<uint16_t> lineFlags;
+	std::vector<unsigned int> sectorStarts;
+	std::vector<unsigned char> floorTextures;
+	std::vector<unsigned char> ceilingTextures;
+	int32_t minX;
+	int32_t minY;
+};
+
+// Owns the map and all editing state. Commands are applied on the thread
+// that calls Run, which publishes a new snapshot after every batch.
+class CEditor
+{
+public:
+	CEditor(int width, int height);
+
+	void Run(CCommandQueue<Command> &commands);
+	void ProcessCommand(const Command &command);
+	void PublishSnapshot();
+
+	std::shared_ptr<const CMapSnapshot> GetSnapshot() const { return std::atomic_load(&m_snapshot); }
+
+	// Published along with each snapshot for readers that need the whole
+	// map rather than what is on screen.
+	std::shared_ptr<const CMapVersion> GetVersion() const { return std::atomic_load(&m_version); }
+
+	// Must be set before Run is called. Snapshots then carry the number of
+	// validation issues, which are updated incrementally after each edit.
+	void SetValidator(CValidator *validator) { m_validator = validator; m_validated = false; }
+
+	// Must be set before Run is called. The map being edited is the chunk at
+	// (originX, originY), and the chunks around it are drawn and can be
+	// picked.
+	void SetChunkPager(CChunkPager *pager, int originX, int originY);
+
+	// Must be set before Run is called, once the map has been read. Every
+	// AUTOSAVE_INTERVAL milliseconds, a changed map is captured and handed
+	// to autosave to be written to filename.
+	void SetAutosave(CAutosave *autosave, const std::string &filename);
+
+	CMap &GetMap() { return m_map; }
+	CGrid &GetGrid() { return m_grid; }
+
+	bool IsRunning() const { return m_running.load(); }
+	void Stop() { m_running.store(false); }
+
+private:
+	void ProcessKeyDown(const Command &command);
+	void ProcessButtonDown(const Command &command);
+	void ProcessButtonUp(const Command &command);
+	void ProcessMotion(const Command &command);
+	void ProcessWheel(const Command &command);
+	void Zoom(int steps, int x, int y);
+	void Autosave();
+	void MarkSelectionDirty();
+	void GetSelectionVertices(std::vector<const Vertex *> &vertices);
+	void FindVertexLines(std::vector<const Vertex *> vertices, std::vector<const Line *> &lines);
+	void MarkVerticesDirty(const std::vector<const Vertex *> &vertices);
+	void MarkLinesDirty(const std::vector<const Line *> &lines);
+	void AddDrawingVertex(Vertex &vertex);
+	void AppendDrawingVertex(Vertex &vertex);
+	void FindCrossings(const Vertex &vertex1, const Vertex &vertex2, std::vector<Vertex> &crossings);
+	void SplitCrossingLines();
+	void ApplyBooleanOperation(ClipOperation operation);
+	void GetSelectedSectors(std::vector<CNode<Sector> *> &sectors);
+	void GetSectorVertices(const std::vector<CNode<Sector> *> &sectors, std::vector<Vertex *> &vertices);
+	void SelectSectorsInBox();
+	void DeleteSelectedSectors();
+	void CopySelectedSectors();
+	void PasteSectors(int32_t x, int32_t y);
+
+	CMap m_map;
+	CGrid m_grid;
+	Mode m_mode;
+	bool m_drawing;
+	bool m_moving;
+	bool m_scrolling;
+	int32_t m_x;
+	int32_t m_y;
+	Sector m_sector;
+	Line m_line;
+	CNode<Sector> *m_selectedSector;
+	CNode<Line> *m_selectedLine;
+	CNode<Vertex> *m_selectedVertex;
+	Selection m_selection;
+	int m_referenceX;
+	int m_referenceY;
+	int m_initialX;
+	int m_initialY;
+	float m_scale;
+	std::atomic<bool> m_running;
+	unsigned int m_textureCount;
+	std::shared_ptr<const CMapSnapshot> m_snapshot;
+	std::shared_ptr<const CMapVersion> m_version;
+	CValidator *m_validator;
+	bool m_validated;
+	CChunkPager *m_pager;
+	unsigned int m_chunkVersion;
+	bool m_chunkLinePicked;
+	SnapshotLine m_chunkLine;
+	CSegmentGrid m_segmentGrid;
+	CNode<Sector> *m_operandSector;
+	CHandleSet m_selectedSectors;
+	CSectorGrid m_sectorGrid;
+	std::vector<Vertex *> m_movingVertices;
+	std::vector<const Line *> m_movingLines;
+	bool m_boxSelecting;
+	int32_t m_boxX1;
+	int32_t m_boxY1;
+	int32_t m_boxX2;
+	int32_t m_boxY2;
+	Clipboard m_clipboard;
+	CAutosave *m_autosave;
+	std::string m_autosaveFilename;
+	unsigned int m_savedRevision;
+	std::chrono::steady_clock::time_point m_autosaveTime;
+};
+
+#endif
\ No newline at end of file
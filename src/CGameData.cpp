@@ -0,0 +1,341 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#include <chrono>
+#include <cstring>
+
+#include "CGameData.h"
+
+using namespace std;
+
+CGameData::~CGameData()
+{
+	// Files still loading are waited for, so that they can be freed.
+	if (m_loader)
+	{
+		m_mappings.wait();
+		m_texels.wait();
+		m_palettes.wait();
+		m_bitShapes.wait();
+		m_spriteTexels.wait();
+		m_entities.wait();
+		m_strings.wait();
+		m_loader.reset();
+	}
+
+	m_spriteAtlas.reset();
+	m_spriteDecoder.reset();
+	m_textureCache.reset();
+
+	FreeStrings(GetReady(m_strings));
+	FreeEntitiesEx(GetReady(m_entities));
+
+	// Sections used in place belong to the pack's mapping, and texels
+	// always belong to their stores.
+	if (!m_pack)
+	{
+		FreeBitShapes(GetReady(m_bitShapes));
+		FreePalettes(GetReady(m_palettes));
+	}
+
+	FreeMappings(GetReady(m_mappings));
+	m_pack.reset();
+}
+
+void CGameData::Load(const string &directory, size_t textureBudget)
+{
+	m_loader.reset(new CThreadPool(ASSET_LOADER_THREADS));
+	m_textureBudget = textureBudget;
+
+	m_mappings = LoadFile<mappings_t>(ASSET_MAPPINGS, directory + "mappings.bin", LoadMappings);
+	m_texels = LoadFile<uint8_t>(ASSET_TEXELS, directory + "wtexels.bin", [this](const char *filename) { return OpenTexels(m_textureTexelStore, filename); });
+	m_palettes = LoadFile<uint16_t>(ASSET_PALETTES, directory + "palettes.bin", [this](const char *filename)
+	{
+		uint32_t length;
+		uint16_t *palettes = LoadPalettesEx(filename, &length);
+		m_paletteSize = length;
+
+		return palettes;
+	});
+	m_bitShapes = LoadFile<uint8_t>(ASSET_BITSHAPES, directory + "bitshapes.bin", [this](const char *filename)
+	{
+		uint32_t length;
+		uint8_t *bitShapes = LoadBitShapesEx(filename, &length);
+		m_bitShapeSize = length;
+
+		return bitShapes;
+	});
+	m_spriteTexels = LoadFile<uint8_t>(ASSET_SPRITE_TEXELS, directory + "stexels.bin", [this](const char *filename) { return OpenTexels(m_spriteTexelStore, filename); });
+	m_entities = LoadFile<entitiesex_t>(ASSET_ENTITIES, directory + "entities.db", LoadEntitiesEx);
+	m_strings = LoadFile<strings_t>(ASSET_STRINGS, directory + "strings.bin", LoadStrings);
+}
+
+bool CGameData::LoadPack(const string &filename, size_t textureBudget)
+{
+	unique_ptr<CAssetPack> pack(new CAssetPack());
+
+	if (!pack->Open(filename.c_str()))
+		return false;
+
+	m_pack = move(pack);
+	m_loader.reset(new CThreadPool(ASSET_LOADER_THREADS));
+	m_textureBudget = textureBudget;
+
+	// The mapping is read-only, so nothing may write through the pointers
+	// handed out for the sections used in place.
+	auto section = [this](const char *name, size_t &size)
+	{
+		return const_cast<uint8_t *>(GetPackData(name, size, true));
+	};
+
+	m_mappings = LoadFile<mappings_t>(ASSET_MAPPINGS, "mappings.bin", [this](const char *name) { return ReadPackFile(name, ReadMappings); });
+	m_texels = LoadFile<uint8_t>(ASSET_TEXELS, "wtexels.bin", [this](const char *name) { return AttachTexels(m_textureTexelStore, name); });
+	m_palettes = LoadFile<uint16_t>(ASSET_PALETTES, "palettes.bin", [this, section](const char *name) { return (uint16_t *)section(name, m_paletteSize); });
+	m_bitShapes = LoadFile<uint8_t>(ASSET_BITSHAPES, "bitshapes.bin", [this, section](const char *name) { return section(name, m_bitShapeSize); });
+	m_spriteTexels = LoadFile<uint8_t>(ASSET_SPRITE_TEXELS, "stexels.bin", [this](const char *name) { return AttachTexels(m_spriteTexelStore, name); });
+	m_entities = LoadFile<entitiesex_t>(ASSET_ENTITIES, "entities.db", [this](const char *name) { return ReadPackFile(name, ReadEntitiesEx); });
+	m_strings = LoadFile<strings_t>(ASSET_STRINGS, "strings.bin", [this](const char *name) { return ReadPackFile(name, ReadStrings); });
+
+	return true;
+}
+
+bool CGameData::ReadMap(const char *filename, CMap &map) const
+{
+	if (filename == nullptr)
+		return false;
+
+	if (m_pack)
+	{
+		const char *name = filename;
+
+		for (const char *c = filename; *c != '\0'; c++)
+		{
+			if (*c == '/' || *c == '\\')
+				name = c + 1;
+		}
+
+		size_t size;
+		const uint8_t *data = GetPackData(name, size);
+
+		if (data != nullptr)
+		{
+			if (m_mapCache)
+				return m_mapCache->Read(data, size, map);
+
+			bspmapex_t *bspMap = ReadBspMapEx(data, size);
+
+			if (bspMap == nullptr)
+				return false;
+
+			map.Read(bspMap);
+			FreeBspMapEx(bspMap);
+
+			return true;
+		}
+	}
+
+	if (m_mapCache)
+		return m_mapCache->Read(filename, map);
+
+	map.Read(filename);
+
+	return true;
+}
+
+bool CGameData::Update()
+{
+	if (!m_loader)
+		return false;
+
+	bool changed = false;
+
+	if (!m_textureCache)
+	{
+		mappings_t *mappings = GetReady(m_mappings);
+		uint8_t *texels = GetReady(m_texels);
+		uint16_t *palettes = GetReady(m_palettes);
+
+		if (mappings != nullptr && texels != nullptr && palettes != nullptr)
+		{
+			m_textureTexelStore.BuildTextureIndex(mappings);
+			m_textureCache.reset(new CTextureCache(mappings, m_textureTexelStore, palettes, m_paletteSize, m_textureBudget));
+			changed = true;
+		}
+	}
+
+	if (m_textureCache && !m_spriteAtlas)
+	{
+		uint8_t *bitShapes = GetReady(m_bitShapes);
+		uint8_t *spriteTexels = GetReady(m_spriteTexels);
+
+		if (bitShapes != nullptr && spriteTexels != nullptr)
+		{
+			m_spriteTexelStore.BuildSpriteIndex(GetReady(m_mappings), bitShapes, m_bitShapeSize);
+			m_spriteDecoder.reset(new CSpriteDecoder(*m_textureCache, bitShapes, m_bitShapeSize, m_spriteTexelStore));
+			m_spriteAtlas.reset(new CSpriteAtlas(*m_spriteDecoder));
+			changed = true;
+		}
+	}
+
+	// What the maps use could not be resolved before the mappings arrived.
+	if (changed)
+		UpdateReferenced();
+
+	// Nothing more can arrive, so the loader threads are let go.
+	if (IsLoaded())
+		m_loader.reset();
+
+	return changed;
+}
+
+void CGameData::SetReferenced(const vector<unsigned int> &wallTextures, const vector<unsigned int> &textures, const vector<unsigned int> &things)
+{
+	if (wallTextures == m_referencedWallTextures && textures == m_referencedTextures && things == m_referencedThings)
+		return;
+
+	m_referencedWallTextures = wallTextures;
+	m_referencedTextures = textures;
+	m_referencedThings = things;
+
+	UpdateReferenced();
+}
+
+bool CGameData::IsLoaded() const
+{
+	return (IsReady(m_mappings) && IsReady(m_texels) && IsReady(m_palettes) && IsReady(m_bitShapes) && IsReady(m_spriteTexels) && IsReady(m_entities) && IsReady(m_strings));
+}
+
+uint8_t *CGameData::OpenTexels(CTexelStore &store, const char *filename)
+{
+	// The mapping is read-only, so nothing may write through the pointer.
+	return (store.Open(filename) ? const_cast<uint8_t *>(store.GetData()) : nullptr);
+}
+
+uint8_t *CGameData::AttachTexels(CTexelStore &store, const char *name) const
+{
+	size_t size;
+	const uint8_t *data = GetPackData(name, size, true);
+
+	if (data == nullptr)
+		return nullptr;
+
+	store.Attach(data, size);
+
+	return const_cast<uint8_t *>(data);
+}
+
+void CGameData::UpdateReferenced()
+{
+	if (!m_textureCache)
+		return;
+
+	vector<unsigned int> textures(m_referencedTextures);
+
+	for (unsigned int wallTexture : m_referencedWallTextures)
+	{
+		unsigned int texture;
+
+		if (m_textureCache->ResolveWallTexture(wallTexture, texture))
+			textures.push_back(texture);
+	}
+
+	m_textureTexelStore.SetReferenced(textures);
+
+	if (m_spriteAtlas)
+	{
+		const mappings_t *mappings = m_textureCache->GetMappings();
+		vector<unsigned int> sprites;
+
+		for (unsigned int thing : m_referencedThings)
+		{
+			if (thing < mappings->thingMappingCount)
+				sprites.push_back(mappings->thingMappings[thing]);
+		}
+
+		m_spriteTexelStore.SetReferenced(sprites);
+	}
+}
+
+const uint8_t *CGameData::GetPackData(const char *name, size_t &size, bool lengthPrefixed) const
+{
+	int id = m_pack->Find(name);
+
+	if (id < 0)
+		return nullptr;
+
+	const uint8_t *data = m_pack->GetData(id);
+	size = size_t(m_pack->GetSize(id));
+
+	if (lengthPrefixed)
+	{
+		uint32_t length;
+
+		if (size < sizeof(length))
+			return nullptr;
+
+		memcpy(&length, data, sizeof(length));
+
+		if (length > size - sizeof(length))
+			return nullptr;
+
+		data += sizeof(length);
+		size = length;
+	}
+
+	return data;
+}
+
+template <class T>
+T *CGameData::ReadPackFile(const char *name, T *(*read)(const uint8_t *, size_t)) const
+{
+	size_t size;
+	const uint8_t *data = GetPackData(name, size);
+
+	return (data != nullptr ? read(data, size) : nullptr);
+}
+
+template <class T, class Function>
+shared_future<T *> CGameData::LoadFile(AssetFile file, const string &filename, Function load)
+{
+	AssetTiming *timing = &m_timings[file];
+	timing->filename = filename;
+	timing->milliseconds = 0.0;
+	timing->loaded = false;
+
+	return m_loader->Submit([timing, load]()
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		T *data = load(timing->filename.c_str());
+
+		timing->milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		timing->loaded = (data != nullptr);
+
+		return data;
+	}).share();
+}
+
+template <class T>
+T *CGameData::GetReady(const shared_future<T *> &future)
+{
+	if (!future.valid() || !IsReady(future))
+		return nullptr;
+
+	return future.get();
+}
+
+template <class T>
+bool CGameData::IsReady(const shared_future<T *> &future)
+{
+	return (!future.valid() || future.wait_for(chrono::seconds(0)) == future_status::ready);
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#ifndef __CGAMEDATA_H__
+#define __CGAMEDATA_H__
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CAssetPack.h"
+#include "CMap.h"
+#include "CMapCache.h"
+#include "CSpriteAtlas.h"
+#include "CSpriteDecoder.h"
+#include "CTexelStore.h"
+#include "CTextureCache.h"
+#include "CThreadPool.h"
+#include "doomrpg_data.h"
+
+#define ASSET_LOADER_THREADS	4
+
+enum AssetFile
+{
+	ASSET_MAPPINGS,
+	ASSET_TEXELS,
+	ASSET_PALETTES,
+	ASSET_BITSHAPES,
+	ASSET_SPRITE_TEXELS,
+	ASSET_ENTITIES,
+	ASSET_STRINGS,
+	ASSET_COUNT
+};
+
+struct AssetTiming
+{
+	std::string filename;
+	double milliseconds;
+	bool loaded;
+};
+
+// Game data files and the caches built from them. Every open map shares
+// one instance through a shared_ptr, so textures and sprites are decoded
+// once however many maps use them.
+//
+// Load queues every file on a small pool of its own and returns at once.
+// Each file can be waited on through its future. Update builds the texture
+// cache and sprite atlas as soon as the files they need have arrived, and
+// until then they are null. Update and the sprite atlas must only be used
+// on the render thread.
+//
+// LoadPack reads the same files from an asset pack instead. The texel,
+// palette and bit shape sections are used in place from the mapping, and
+// maps in the pack can be read by file name. With a map cache, maps are
+// read through it wherever they come from.
+//
+// Texel files are mapped rather than read, and SetReferenced tells their
+// stores which textures and sprites the open maps use.
+class CGameData
+{
+public:
+	CGameData() : m_textureBudget(0), m_paletteSize(0), m_bitShapeSize(0) {}
+	~CGameData();
+
+	void Load(const std::string &directory, size_t textureBudget);
+	bool LoadPack(const std::string &filename, size_t textureBudget);
+
+	void SetMapCache(const std::string &directory) { m_mapCache.reset(new CMapCache(directory)); }
+	CMapCache *GetMapCache() const { return m_mapCache.get(); }
+
+	// Prefers a map of the same file name in the pack over the file.
+	bool ReadMap(const char *filename, CMap &map) const;
+
+	// Returns true when a cache became available.
+	bool Update();
+	bool IsLoaded() const;
+
+	// Wall textures are resolved to textures, and things to sprites, once
+	// the mappings have arrived. Must only be called on the render thread.
+	void SetReferenced(const std::vector<unsigned int> &wallTextures, const std::vector<unsigned int> &textures, const std::vector<unsigned int> &things);
+
+	const CTexelStore &GetTextureTexelStore() const { return m_textureTexelStore; }
+	const CTexelStore &GetSpriteTexelStore() const { return m_spriteTexelStore; }
+
+	// Only valid for files whose futures are ready.
+	const AssetTiming &GetTiming(AssetFile file) const { return m_timings[file]; }
+
+	const std::shared_future<mappings_t *> &GetMappings() const { return m_mappings; }
+	const std::shared_future<uint8_t *> &GetTexels() const { return m_texels; }
+	const std::shared_future<uint16_t *> &GetPalettes() const { return m_palettes; }
+	const std::shared_future<uint8_t *> &GetBitShapes() const { return m_bitShapes; }
+	const std::shared_future<uint8_t *> &GetSpriteTexels() const { return m_spriteTexels; }
+	const std::shared_future<entitiesex_t *> &GetEntities() const { return m_entities; }
+	const std::shared_future<strings_t *> &GetStrings() const { return m_strings; }
+
+	CTextureCache *GetTextureCache() const { return m_textureCache.get(); }
+	CSpriteAtlas *GetSpriteAtlas() const { return m_spriteAtlas.get(); }
+
+private:
+	CGameData(const CGameData &) = delete;
+	CGameData &operator=(const CGameData &) = delete;
+
+	template <class T, class Function>
+	std::shared_future<T *> LoadFile(AssetFile file, const std::string &filename, Function load);
+
+	// Sections that start with their length, as the texel, palette and bit
+	// shape files do, are returned past it.
+	const uint8_t *GetPackData(const char *name, size_t &size, bool lengthPrefixed = false) const;
+
+	static uint8_t *OpenTexels(CTexelStore &store, const char *filename);
+	uint8_t *AttachTexels(CTexelStore &store, const char *name) const;
+	void UpdateReferenced();
+
+	template <class T>
+	T *ReadPackFile(const char *name, T *(*read)(const uint8_t *, size_t)) const;
+
+	// Null until the future is ready, and when the file failed to load.
+	template <class T>
+	static T *GetReady(const std::shared_future<T *> &future);
+
+	// Files that were never queued count as ready.
+	template <class T>
+	static bool IsReady(const std::shared_future<T *> &future);
+
+	std::unique_ptr<CThreadPool> m_loader;
+	std::unique_ptr<CAssetPack> m_pack;
+	std::unique_ptr<CMapCache> m_mapCache;
+	AssetTiming m_timings[ASSET_COUNT];
+	size_t m_textureBudget;
+	size_t m_paletteSize;
+	size_t m_bitShapeSize;
+	std::shared_future<mappings_t *> m_mappings;
+	std::shared_future<uint8_t *> m_texels;
+	std::shared_future<uint16_t *> m_palettes;
+	std::shared_future<uint8_t *> m_bitShapes;
+	std::shared_future<uint8_t *> m_spriteTexels;
+	std::shared_future<entitiesex_t *> m_entities;
+	std::shared_future<strings_t *> m_strings;
+	std::unique_ptr<CTextureCache> m_textureCache;
+	std::unique_ptr<CSpriteDecoder> m_spriteDecoder;
+	std::unique_ptr<CSpriteAtlas> m_spriteAtlas;
+	CTexelStore m_textureTexelStore;
+	CTexelStore m_spriteTexelStore;
+	std::vector<unsigned int> m_referencedWallTextures;
+	std::vector<unsigned int> m_referencedTextures;
+	std::vector<unsigned int> m_referencedThings;
+};
+
+#endif
\ No newline at end of file
@@ -12,159 +12,240 @@
 // GNU General Public License for more details.
 
 #include <algorithm>
+#include <cmath>
 
 #include "CGrid.h"
 
-void CGrid::Resize(int width, int height)
+static int64_t FloorDivide(int64_t numerator, int64_t denominator)
 {
-	m_gridWidth = m_viewWidth = width;
-	m_gridHeight = m_viewHeight = height;
-	m_xSize = m_viewWidth / m_scaledCellSize - 1;
-	m_ySize = m_viewHeight / m_scaledCellSize - 1;
+	return numerator / denominator - (numerator % denominator != 0 && (numerator < 0) != (denominator < 0));
+}
 
-	if ((m_viewWidth % m_scaledCellSize) != 0)
-	{
-		m_xSize++;
-		m_gridWidth = m_xSize * m_scaledCellSize + m_scaledCellSize;
-	}
+// Right shifts of negative numbers round towards negative infinity on every
+// compiler we build with, the same as FloorDivide.
+struct ShiftDivider
+{
+	int shift;
+	int64_t operator()(int64_t numerator) const { return numerator >> shift; }
+};
 
-	if ((m_viewHeight % m_scaledCellSize) != 0)
-	{
-		m_ySize++;
-		m_gridHeight = m_ySize * m_scaledCellSize + m_scaledCellSize;
-	}
+struct FloorDivider
+{
+	int64_t denominator;
+	int64_t operator()(int64_t numerator) const { return FloorDivide(numerator, denominator); }
+};
+
+static int64_t CeilDivide(int64_t numerator, int64_t denominator)
+{
+	return -FloorDivide(-numerator, denominator);
+}
+
+static int GetShift(int64_t size)
+{
+	if (size <= 0 || (size & (size - 1)) != 0)
+		return -1;
+
+	int shift = 0;
+
+	while ((int64_t(1) << shift) != size)
+		shift++;
+
+	return shift;
 }
 
-void CGrid::Render(SDL_Renderer *renderer)
+void CGrid::Render(SDL_Renderer *renderer) const
 {
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
 	SDL_RenderClear(renderer);
 
 	SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
 
-	int minBounds[2];
-	int maxBounds[2];
+	int64_t minBounds[2];
+	int64_t maxBounds[2];
 
-	minBounds[0] = m_minX * m_scaledCellSize;
-	minBounds[1] = m_minY * m_scaledCellSize;
+	minBounds[0] = int64_t(m_minX) * m_cellSize;
+	minBounds[1] = int64_t(m_minY) * m_cellSize;
 
-	maxBounds[0] = m_maxX * m_scaledCellSize;
-	maxBounds[1] = m_maxY * m_scaledCellSize;
+	maxBounds[0] = int64_t(m_maxX) * m_cellSize;
+	maxBounds[1] = int64_t(m_maxY) * m_cellSize;
 
-	int xStart = std::max(minBounds[0] + m_originX + m_xDisplacement, 0);
-	int yStart = std::max(minBounds[1] + m_originY + m_yDisplacement, 0);
+	float xOffset = float(m_originX + m_xDisplacement);
+	float yOffset = float(m_originY + m_yDisplacement);
 
-	int xEnd = std::min(maxBounds[0] + m_originX + m_xDisplacement, m_gridWidth - 1);
-	int yEnd = std::min(maxBounds[1] + m_originY + m_yDisplacement, m_gridHeight - 1);
+	int xStart = std::max(int(std::max(minBounds[0] * m_scale + xOffset, -1.0f)), 0);
+	int yStart = std::max(int(std::max(minBounds[1] * m_scale + yOffset, -1.0f)), 0);
 
-	for (int x = 0; x <= m_xSize; x++)
-	{
-		int xCoord = x * m_scaledCellSize + m_scaledCellSize / 2 + m_xDisplacement;
-		
-		if (xCoord < 0)
-			xCoord = m_gridWidth + (xCoord % m_gridWidth);
-		else if (xCoord >= m_gridWidth)
-			xCoord %= m_gridWidth;
-
-		if (xCoord - m_originX - m_xDisplacement < minBounds[0])
-			continue;
-		else if (xCoord - m_originX - m_xDisplacement > maxBounds[0])
-			continue;
+	int xEnd = int(std::min(maxBounds[0] * m_scale + xOffset, float(m_viewWidth - 1)));
+	int yEnd = int(std::min(maxBounds[1] * m_scale + yOffset, float(m_viewHeight - 1)));
+
+	// Lines closer than GRID_MIN_SPACING pixels are thinned out to every
+	// step-th cell. step is a power of two and counted from the grid origin,
+	// so the lines that stay do not change while scrolling.
+	int64_t step = m_cellSize;
+
+	while (step * m_scale < GRID_MIN_SPACING)
+		step <<= 1;
+
+	// Only the lines inside the view are visited, however far out it is
+	// zoomed.
+	int64_t xFirst = CeilDivide(std::max(int64_t(TranslateXToGridSpace(0)), minBounds[0]), step) * step;
+	int64_t xLast = std::min(int64_t(TranslateXToGridSpace(m_viewWidth - 1)), maxBounds[0]);
 
+	for (int64_t x = xFirst; x <= xLast; x += step)
+	{
+		int xCoord = int(x * m_scale + xOffset);
 		SDL_RenderDrawLine(renderer, xCoord, yStart, xCoord, yEnd);
 	}
 
-	for (int y = 0; y <= m_ySize; y++)
+	int64_t yFirst = CeilDivide(std::max(int64_t(TranslateYToGridSpace(0)), minBounds[1]), step) * step;
+	int64_t yLast = std::min(int64_t(TranslateYToGridSpace(m_viewHeight - 1)), maxBounds[1]);
+
+	for (int64_t y = yFirst; y <= yLast; y += step)
 	{
-		int yCoord = y * m_scaledCellSize + m_scaledCellSize / 2 + m_yDisplacement;
+		int yCoord = int(y * m_scale + yOffset);
+		SDL_RenderDrawLine(renderer, xStart, yCoord, xEnd, yCoord);
+	}
+}
 
-		if (yCoord < 0)
-			yCoord = m_gridHeight + (yCoord % m_gridHeight);
-		else if (yCoord >= m_gridHeight)
-			yCoord %= m_gridHeight;
+void CGrid::Zoom(float scale, int x, int y)
+{
+	if (scale <= 0.0f)
+		return;
 
-		if (yCoord - m_originY - m_yDisplacement < minBounds[1])
-			continue;
-		else if (yCoord - m_originY - m_yDisplacement > maxBounds[1])
-			continue;
+	float gridX = (x - m_originX - m_xDisplacement) / m_scale;
+	float gridY = (y - m_originY - m_yDisplacement) / m_scale;
 
-		SDL_RenderDrawLine(renderer, xStart, yCoord, xEnd, yCoord);
-	}
+	UpdateScale(scale);
+
+	m_originX = int(lroundf(x - m_xDisplacement - gridX * m_scale));
+	m_originY = int(lroundf(y - m_yDisplacement - gridY * m_scale));
 }
 
-void CGrid::Snap(float &x, float &y)
+// Rounds to the nearest grid line, which is the line whose cell the pixel
+// falls in when grid lines are drawn through the middle of cells.
+template <class Divider>
+int32_t CGrid::SnapCoordinate(int32_t coordinate, Divider divide) const
 {
-	x -= m_xDisplacement;
+	return int32_t(divide(int64_t(coordinate) + m_cellSize / 2) * m_cellSize);
+}
 
-	if (x < 0)
-		x = float(int(x) / m_scaledCellSize * m_scaledCellSize - m_scaledCellSize / 2 - m_originX);
-	else
-		x = float(int(x) / m_scaledCellSize * m_scaledCellSize + m_scaledCellSize / 2 - m_originX);
+template <class Divider>
+void CGrid::SnapCoordinates(int32_t *coordinates, size_t count, Divider divide) const
+{
+	for (size_t i = 0; i < count; i++)
+		coordinates[i] = SnapCoordinate(coordinates[i], divide);
+}
 
-	x = x * m_scaleInverse;
+template <class Divider>
+int32_t CGrid::TranslateToGridSpace(int32_t coordinate, int origin, int displacement, Divider divide) const
+{
+	return int32_t(divide((int64_t(coordinate) - origin - displacement) * GRID_SCALE_ONE));
+}
 
-	y -= m_yDisplacement;
+template <class Divider>
+void CGrid::TranslateToGridSpace(int32_t *coordinates, size_t count, int origin, int displacement, Divider divide) const
+{
+	for (size_t i = 0; i < count; i++)
+		coordinates[i] = TranslateToGridSpace(coordinates[i], origin, displacement, divide);
+}
 
-	if (y < 0)
-		y = float(int(y) / m_scaledCellSize * m_scaledCellSize - m_scaledCellSize / 2 - m_originY);
+void CGrid::Snap(int32_t &x, int32_t &y) const
+{
+	x = SnapX(x);
+	y = SnapY(y);
+}
+
+void CGrid::Snap(int32_t *x, int32_t *y, size_t count) const
+{
+	if (m_scaleShift >= 0)
+	{
+		TranslateToGridSpace(x, count, m_originX, m_xDisplacement, ShiftDivider({ m_scaleShift }));
+		TranslateToGridSpace(y, count, m_originY, m_yDisplacement, ShiftDivider({ m_scaleShift }));
+	}
 	else
-		y = float(int(y) / m_scaledCellSize * m_scaledCellSize + m_scaledCellSize / 2 - m_originY);
+	{
+		TranslateToGridSpace(x, count, m_originX, m_xDisplacement, FloorDivider({ m_scaleFixed }));
+		TranslateToGridSpace(y, count, m_originY, m_yDisplacement, FloorDivider({ m_scaleFixed }));
+	}
 
-	y = y * m_scaleInverse;
+	if (m_cellShift >= 0)
+	{
+		SnapCoordinates(x, count, ShiftDivider({ m_cellShift }));
+		SnapCoordinates(y, count, ShiftDivider({ m_cellShift }));
+	}
+	else
+	{
+		SnapCoordinates(x, count, FloorDivider({ m_cellSize }));
+		SnapCoordinates(y, count, FloorDivider({ m_cellSize }));
+	}
 }
 
-void CGrid::TranslateToGridSpace(float &x, float &y)
+void CGrid::TranslateToGridSpace(int32_t &x, int32_t &y) const
 {
-	x = (x - m_originX - m_xDisplacement) * m_scaleInverse;
-	y = (y - m_originY + m_yDisplacement) * m_scaleInverse;
+	x = TranslateXToGridSpace(x);
+	y = TranslateYToGridSpace(y);
 }
 
-void CGrid::TranslateToViewSpace(float &x, float &y)
+void CGrid::TranslateToViewSpace(float &x, float &y) const
 {
 	x = x * m_scale + m_originX + m_xDisplacement;
 	y = y * m_scale + m_originY + m_yDisplacement;
 }
 
-float CGrid::SnapX(float x)
+int32_t CGrid::SnapX(int32_t x) const
 {
-	x -= m_xDisplacement;
+	x = TranslateXToGridSpace(x);
 
-	if (x < 0)
-		x = float(int(x) / m_scaledCellSize * m_scaledCellSize - m_scaledCellSize / 2 - m_originX);
-	else
-		x = float(int(x) / m_scaledCellSize * m_scaledCellSize + m_scaledCellSize / 2 - m_originX);
+	if (m_cellShift >= 0)
+		return SnapCoordinate(x, ShiftDivider({ m_cellShift }));
 
-	return (x * m_scaleInverse);
+	return SnapCoordinate(x, FloorDivider({ m_cellSize }));
 }
 
-float CGrid::SnapY(float y)
+int32_t CGrid::SnapY(int32_t y) const
 {
-	y -= m_yDisplacement;
+	y = TranslateYToGridSpace(y);
 
-	if (y < 0)
-		y = float(int(y) / m_scaledCellSize * m_scaledCellSize - m_scaledCellSize / 2 - m_originY);
-	else
-		y = float(int(y) / m_scaledCellSize * m_scaledCellSize + m_scaledCellSize / 2 - m_originY);
+	if (m_cellShift >= 0)
+		return SnapCoordinate(y, ShiftDivider({ m_cellShift }));
 
-	return (y * m_scaleInverse);
+	return SnapCoordinate(y, FloorDivider({ m_cellSize }));
 }
 
-float CGrid::TranslateXToGridSpace(float x)
+int32_t CGrid::TranslateXToGridSpace(int32_t x) const
 {
-	return ((x - m_originX - m_xDisplacement) * m_scaleInverse);
+	if (m_scaleShift >= 0)
+		return TranslateToGridSpace(x, m_originX, m_xDisplacement, ShiftDivider({ m_scaleShift }));
+
+	return TranslateToGridSpace(x, m_originX, m_xDisplacement, FloorDivider({ m_scaleFixed }));
 }
 
-float CGrid::TranslateYToGridSpace(float y)
+int32_t CGrid::TranslateYToGridSpace(int32_t y) const
 {
-	return ((y - m_originY - m_yDisplacement) * m_scaleInverse);
+	if (m_scaleShift >= 0)
+		return TranslateToGridSpace(y, m_originY, m_yDisplacement, ShiftDivider({ m_scaleShift }));
+
+	return TranslateToGridSpace(y, m_originY, m_yDisplacement, FloorDivider({ m_scaleFixed }));
 }
 
-float CGrid::TranslateXToViewSpace(float x)
+float CGrid::TranslateXToViewSpace(float x) const
 {
 	return (x * m_scale + m_originX + m_xDisplacement);
 }
 
-float CGrid::TranslateYToViewSpace(float y)
+float CGrid::TranslateYToViewSpace(float y) const
 {
 	return (y * m_scale + m_originY + m_yDisplacement);
+}
+
+void CGrid::UpdateShifts()
+{
+	m_cellShift = GetShift(m_cellSize);
+}
+
+void CGrid::UpdateScale(float scale)
+{
+	m_scaleFixed = std::max(int64_t(llround(double(scale) * GRID_SCALE_ONE)), int64_t(1));
+	m_scaleShift = GetShift(m_scaleFixed);
+	m_scale = float(double(m_scaleFixed) / GRID_SCALE_ONE);
 }
\ No newline at end of file
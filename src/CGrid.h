@@ -15,37 +15,55 @@
 #define __CGRID_H__
 
 #include <climits>
+#include <cstddef>
+#include <cstdint>
 
 #include "SDL.h"
 
+#define GRID_MIN_SPACING	8
+
+// The scale is held in fixed point with GRID_SCALE_BITS fractional bits, so
+// that any zoom can be used while going to grid space stays integer only.
+#define GRID_SCALE_BITS	16
+#define GRID_SCALE_ONE	(int64_t(1) << GRID_SCALE_BITS)
+
 class CGrid
 {
 public:
-	CGrid(int width, int height, int cellSize = 16, int xDisplacement = 0, int yDisplacement = 0, float scale = 1.0f, int minX = SHRT_MIN, int minY = SHRT_MIN, int maxX = SHRT_MAX, int maxY = SHRT_MAX) : m_cellSize(cellSize), m_scaledCellSize(int(cellSize * scale)), m_xDisplacement(xDisplacement), m_yDisplacement(yDisplacement), m_scale(scale), m_scaleInverse(1.0f / scale), m_minX(minX), m_minY(minY), m_maxX(maxX), m_maxY(maxY) { Resize(width, height); m_originX = m_xSize / 2 * m_scaledCellSize + m_scaledCellSize / 2; m_originY = m_ySize / 2 * m_scaledCellSize + m_scaledCellSize / 2; }
-
-	void Resize(int width, int height);
-
-	void Render(SDL_Renderer *renderer);
-
-	void Snap(float &x, float &y);
-	void TranslateToGridSpace(float &x, float &y);
-	void TranslateToViewSpace(float &x, float &y);
-	float SnapX(float x);
-	float SnapY(float y);
-	float TranslateXToGridSpace(float x);
-	float TranslateYToGridSpace(float y);
-	float TranslateXToViewSpace(float x);
-	float TranslateYToViewSpace(float y);
-
-	void CenterOrigin() { m_originX = m_xSize / 2 * m_scaledCellSize + m_scaledCellSize / 2; m_originY = m_ySize / 2 * m_scaledCellSize + m_scaledCellSize / 2; m_xDisplacement = 0; m_yDisplacement = 0; }
+	CGrid(int width, int height, int cellSize = 16, int xDisplacement = 0, int yDisplacement = 0, float scale = 1.0f, int minX = SHRT_MIN, int minY = SHRT_MIN, int maxX = SHRT_MAX, int maxY = SHRT_MAX) : m_cellSize(cellSize), m_xDisplacement(xDisplacement), m_yDisplacement(yDisplacement), m_minX(minX), m_minY(minY), m_maxX(maxX), m_maxY(maxY) { UpdateShifts(); UpdateScale(scale); Resize(width, height); m_originX = m_viewWidth / 2; m_originY = m_viewHeight / 2; }
+
+	void Resize(int width, int height) { m_viewWidth = width; m_viewHeight = height; }
+
+	void Render(SDL_Renderer *renderer) const;
+
+	// View space is in pixels and grid space in whole map units. Going to
+	// grid space uses integer arithmetic only, so picking and snapping give
+	// the same result for the same pixel at any scale.
+	void Snap(int32_t &x, int32_t &y) const;
+	void Snap(int32_t *x, int32_t *y, size_t count) const;
+	void TranslateToGridSpace(int32_t &x, int32_t &y) const;
+	void TranslateToViewSpace(float &x, float &y) const;
+	int32_t SnapX(int32_t x) const;
+	int32_t SnapY(int32_t y) const;
+	int32_t TranslateXToGridSpace(int32_t x) const;
+	int32_t TranslateYToGridSpace(int32_t y) const;
+	int32_t ScaleToGridSpace(int32_t distance) const { return int32_t(distance * GRID_SCALE_ONE / m_scaleFixed); }
+	float TranslateXToViewSpace(float x) const;
+	float TranslateYToViewSpace(float y) const;
+
+	void CenterOrigin() { m_originX = m_viewWidth / 2; m_originY = m_viewHeight / 2; m_xDisplacement = 0; m_yDisplacement = 0; }
 	void Scroll(int xDisplacement, int yDisplacement) { m_xDisplacement += xDisplacement; m_yDisplacement += yDisplacement; }
 	void ScrollX(int xDisplacement) { m_xDisplacement += xDisplacement; }
 	void ScrollY(int yDisplacement) { m_yDisplacement += yDisplacement; }
 
 	int GetCellSize() const { return m_cellSize; }
-	void SetCellSize(int cellSize) { m_cellSize = cellSize; }
+	void SetCellSize(int cellSize) { m_cellSize = cellSize; UpdateShifts(); }
+
+	// At least one pixel, so that it can be used as a scroll step.
+	int GetScaledCellSize() const { int scaledCellSize = int(m_cellSize * m_scale); return (scaledCellSize > 0 ? scaledCellSize : 1); }
 
-	int GetScaledCellSize() const { return m_scaledCellSize; }
+	int GetViewWidth() const { return m_viewWidth; }
+	int GetViewHeight() const { return m_viewHeight; }
 
 	int GetXDisplacement() const { return m_xDisplacement; }
 	void SetXDisplacement(int xDisplacement) { m_xDisplacement = xDisplacement; }
@@ -66,15 +84,33 @@ public:
 	void SetMaxY(int maxY) { m_maxY = maxY; }
 
 	float GetScale() const { return m_scale; }
-	void SetScale(float scale) { if (scale == 0.0f) return; m_scaledCellSize = int(m_cellSize * scale); m_scale = scale; m_scaleInverse = 1.0f / scale; Resize(m_viewWidth, m_viewHeight); m_originX = m_xSize / 2 * m_scaledCellSize + m_scaledCellSize / 2; m_originY = m_ySize / 2 * m_scaledCellSize + m_scaledCellSize / 2; }
+	void SetScale(float scale) { Zoom(scale, m_viewWidth / 2, m_viewHeight / 2); }
+
+	// Changes the scale while keeping the grid point under the view point
+	// (x, y) where it is.
+	void Zoom(float scale, int x, int y);
 
 private:
-	int m_xSize;
-	int m_ySize;
+	// Cell sizes and scales are usually powers of two, so the divisions by
+	// them are done by shifts when they can be. A shift of -1 means the
+	// value is not a power of two.
+	template <class Divider>
+	int32_t SnapCoordinate(int32_t coordinate, Divider divide) const;
+
+	template <class Divider>
+	void SnapCoordinates(int32_t *coordinates, size_t count, Divider divide) const;
+
+	template <class Divider>
+	int32_t TranslateToGridSpace(int32_t coordinate, int origin, int displacement, Divider divide) const;
+
+	template <class Divider>
+	void TranslateToGridSpace(int32_t *coordinates, size_t count, int origin, int displacement, Divider divide) const;
+
+	void UpdateShifts();
+	void UpdateScale(float scale);
+
 	int m_cellSize;
-	int m_scaledCellSize;
-	int m_gridWidth;
-	int m_gridHeight;
+	int m_cellShift;
 	int m_viewWidth;
 	int m_viewHeight;
 	int m_originX;
@@ -85,8 +121,9 @@ private:
 	int m_minY;
 	int m_maxX;
 	int m_maxY;
+	int64_t m_scaleFixed;
+	int m_scaleShift;
 	float m_scale;
-	float m_scaleInverse;
 };
 
 #endif
\ No newline at end of file
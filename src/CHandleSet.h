@@ -0,0 +1,60 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#ifndef __CHANDLESET_H__
+#define __CHANDLESET_H__
+
+#include <cstdint>
+#include <vector>
+
+// Set of element handles stored as one bit per handle. Handles are small
+// and dense, so this stays a few words even for large maps.
+class CHandleSet
+{
+public:
+	CHandleSet() : m_count(0) {}
+
+	void Insert(unsigned int handle)
+	{
+		if (handle / 32 >= m_words.size())
+			m_words.resize(handle / 32 + 1, 0);
+
+		if ((m_words[handle / 32] & (1u << (handle % 32))) == 0)
+		{
+			m_words[handle / 32] |= 1u << (handle % 32);
+			m_count++;
+		}
+	}
+
+	void Erase(unsigned int handle)
+	{
+		if (Contains(handle))
+		{
+			m_words[handle / 32] &= ~(1u << (handle % 32));
+			m_count--;
+		}
+	}
+
+	bool Contains(unsigned int handle) const { return (handle / 32 < m_words.size() && (m_words[handle / 32] & (1u << (handle % 32))) != 0); }
+	void Clear() { m_words.clear(); m_count = 0; }
+
+	unsigned int GetCount() const { return m_count; }
+	bool IsEmpty() const { return (m_count == 0); }
+
+private:
+	std::vector<uint32_t> m_words;
+	unsigned int m_count;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CHASH_H__
+#define __CHASH_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a. Data can be added a piece at a time, so structures can be
+// hashed field by field to leave out their padding.
+class CHash
+{
+public:
+	CHash() : m_value(14695981039346656037ull) {}
+
+	void Add(const void *data, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			m_value ^= ((const uint8_t *)data)[i];
+			m_value *= 1099511628211ull;
+		}
+	}
+
+	template <class T>
+	void AddValue(const T &value) { Add(&value, sizeof(value)); }
+
+	uint64_t GetValue() const { return m_value; }
+
+private:
+	uint64_t m_value;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#include <algorithm>
+#include <cstring>
+
+#include "CInputLog.h"
+
+using namespace std;
+
+bool CInputRecorder::Open(const char *filename, uint64_t mapHash, int width, int height)
+{
+	Close();
+
+	m_file = fopen(filename, "wb");
+
+	if (m_file == nullptr)
+		return false;
+
+	inputlogheader_t header;
+	memcpy(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic));
+	header.version = INPUT_LOG_VERSION;
+	header.mapHash = mapHash;
+	header.width = width;
+	header.height = height;
+
+	if (fwrite(&header, sizeof(header), 1, m_file) != 1)
+	{
+		Close();
+
+		return false;
+	}
+
+	m_startTime = chrono::steady_clock::now();
+
+	return true;
+}
+
+void CInputRecorder::Close()
+{
+	if (m_file != nullptr)
+	{
+		fclose(m_file);
+		m_file = nullptr;
+	}
+}
+
+static int16_t ClampInt16(int value)
+{
+	return int16_t(min(max(value, int(INT16_MIN)), int(INT16_MAX)));
+}
+
+void CInputRecorder::Record(const Command &command)
+{
+	if (m_file == nullptr)
+		return;
+
+	inputlogrecord_t record;
+	memset(&record, 0, sizeof(record));
+	record.time = uint32_t(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - m_startTime).count());
+	record.key = command.key;
+	record.x = ClampInt16(command.x);
+	record.y = ClampInt16(command.y);
+	record.type = uint8_t(command.type);
+
+	fwrite(&record, sizeof(record), 1, m_file);
+}
+
+bool CInputLog::Read(const char *filename)
+{
+	FILE *file = fopen(filename, "rb");
+
+	if (file == nullptr)
+		return false;
+
+	inputlogheader_t header;
+
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic)) != 0 || header.version != INPUT_LOG_VERSION)
+	{
+		fclose(file);
+
+		return false;
+	}
+
+	m_mapHash = header.mapHash;
+	m_width = header.width;
+	m_height = header.height;
+	m_commands.clear();
+
+	// A log cut short by a crash ends at its last whole record.
+	inputlogrecord_t record;
+
+	while (fread(&record, sizeof(record), 1, file) == 1)
+	{
+		if (record.type >= COMMAND_COUNT)
+			continue;
+
+		m_commands.push_back({ record.time, { CommandType(record.type), record.key, record.x, record.y } });
+	}
+
+	fclose(file);
+
+	return true;
+}
\ No newline at end of file
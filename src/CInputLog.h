@@ -0,0 +1,98 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#ifndef __CINPUTLOG_H__
+#define __CINPUTLOG_H__
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "CEditor.h"
+
+#define INPUT_LOG_MAGIC		"DRIL"
+#define INPUT_LOG_VERSION	1
+
+// An input log is an inputlogheader_t followed by one inputlogrecord_t for
+// each command, up to the end of the file. mapHash is the CMapVersion hash
+// of the map the commands were first applied to.
+struct inputlogheader_t
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t mapHash;
+	int32_t width;
+	int32_t height;
+};
+
+// time is in milliseconds since recording started.
+struct inputlogrecord_t
+{
+	uint32_t time;
+	int32_t key;
+	int16_t x;
+	int16_t y;
+	uint8_t type;
+	uint8_t reserved[3];
+};
+
+struct RecordedCommand
+{
+	uint32_t time;
+	Command command;
+};
+
+// Writes the commands sent to an editor to an input log as they happen.
+class CInputRecorder
+{
+public:
+	CInputRecorder() : m_file(nullptr) {}
+	~CInputRecorder() { Close(); }
+
+	bool Open(const char *filename, uint64_t mapHash, int width, int height);
+	void Close();
+	bool IsOpen() const { return (m_file != nullptr); }
+
+	void Record(const Command &command);
+
+private:
+	CInputRecorder(const CInputRecorder &) = delete;
+	CInputRecorder &operator=(const CInputRecorder &) = delete;
+
+	FILE *m_file;
+	std::chrono::steady_clock::time_point m_startTime;
+};
+
+class CInputLog
+{
+public:
+	CInputLog() : m_mapHash(0), m_width(0), m_height(0) {}
+
+	// Returns false when the file is missing or is not an input log.
+	bool Read(const char *filename);
+
+	uint64_t GetMapHash() const { return m_mapHash; }
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	const std::vector<RecordedCommand> &GetCommands() const { return m_commands; }
+
+private:
+	uint64_t m_mapHash;
+	int m_width;
+	int m_height;
+	std::vector<RecordedCommand> m_commands;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#include <cmath>
+
+#include "CLayerCache.h"
+
+using namespace std;
+
+void CLayerCache::Render(SDL_Renderer *renderer, const shared_ptr<const CMapSnapshot> &snapshot, CSpriteAtlas *spriteAtlas)
+{
+	Uint32 ticks = SDL_GetTicks();
+	ViewTransform transform = GetTransform(snapshot->GetGrid());
+
+	if (m_snapshot && transform.scale != m_zoomEnd.scale)
+	{
+		// A zoom that starts while another is running starts from where the
+		// view is now, so the view never jumps.
+		m_zoomStart = (m_zooming ? GetZoomTransform(ticks) : m_zoomEnd);
+		m_zooming = true;
+		m_zoomTicks = ticks;
+	}
+
+	m_zoomEnd = transform;
+
+	if (m_zooming && ticks - m_zoomTicks < ZOOM_DURATION && m_texture != nullptr)
+	{
+		ViewTransform zoom = GetZoomTransform(ticks);
+		float factor = zoom.scale / m_cached.scale;
+		SDL_FRect rect = { zoom.xOffset - m_cached.xOffset * factor, zoom.yOffset - m_cached.yOffset * factor, m_width * factor, m_height * factor };
+
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		SDL_RenderClear(renderer);
+		SDL_RenderCopyF(renderer, m_texture, nullptr, &rect);
+
+		return;
+	}
+
+	m_zooming = false;
+
+	int width, height;
+	SDL_GetRendererOutputSize(renderer, &width, &height);
+
+	if (m_texture == nullptr || width != m_width || height != m_height)
+	{
+		Clear();
+
+		m_width = width;
+		m_height = height;
+
+		if (!CreateTexture(renderer))
+		{
+			snapshot->Render(renderer, spriteAtlas);
+			return;
+		}
+	}
+
+	if (snapshot != m_snapshot || transform.scale != m_cached.scale || transform.xOffset != m_cached.xOffset || transform.yOffset != m_cached.yOffset)
+	{
+		SDL_SetRenderTarget(renderer, m_texture);
+		snapshot->Render(renderer, spriteAtlas);
+		SDL_SetRenderTarget(renderer, nullptr);
+
+		m_snapshot = snapshot;
+		m_cached = transform;
+	}
+
+	SDL_RenderCopy(renderer, m_texture, nullptr, nullptr);
+}
+
+void CLayerCache::Clear()
+{
+	if (m_texture != nullptr)
+		SDL_DestroyTexture(m_texture);
+
+	m_texture = nullptr;
+	m_snapshot.reset();
+}
+
+// The scale is interpolated logarithmically so that the zoom speed looks
+// even, and eased out. The offsets follow from keeping fixed the one view
+// point that both transforms map the same grid point to, which is where
+// the cursor was for a wheel zoom.
+CLayerCache::ViewTransform CLayerCache::GetZoomTransform(Uint32 ticks) const
+{
+	float t = float(ticks - m_zoomTicks) / ZOOM_DURATION;
+
+	if (t >= 1.0f)
+		return m_zoomEnd;
+
+	t = 1.0f - (1.0f - t) * (1.0f - t);
+
+	ViewTransform transform;
+	transform.scale = m_zoomStart.scale * powf(m_zoomEnd.scale / m_zoomStart.scale, t);
+
+	float ratio = transform.scale / m_zoomStart.scale;
+	float difference = m_zoomStart.scale - m_zoomEnd.scale;
+
+	if (difference == 0.0f)
+	{
+		transform.xOffset = m_zoomEnd.xOffset;
+		transform.yOffset = m_zoomEnd.yOffset;
+
+		return transform;
+	}
+
+	float xFixed = (m_zoomEnd.xOffset * m_zoomStart.scale - m_zoomStart.xOffset * m_zoomEnd.scale) / difference;
+	float yFixed = (m_zoomEnd.yOffset * m_zoomStart.scale - m_zoomStart.yOffset * m_zoomEnd.scale) / difference;
+
+	transform.xOffset = xFixed - (xFixed - m_zoomStart.xOffset) * ratio;
+	transform.yOffset = yFixed - (yFixed - m_zoomStart.yOffset) * ratio;
+
+	return transform;
+}
+
+bool CLayerCache::CreateTexture(SDL_Renderer *renderer)
+{
+	m_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, m_width, m_height);
+
+	return (m_texture != nullptr);
+}
+
+CLayerCache::ViewTransform CLayerCache::GetTransform(const CGrid &grid)
+{
+	ViewTransform transform;
+	transform.scale = grid.GetScale();
+	transform.xOffset = grid.TranslateXToViewSpace(0.0f);
+	transform.yOffset = grid.TranslateYToViewSpace(0.0f);
+
+	return transform;
+}
\ No newline at end of file
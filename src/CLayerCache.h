@@ -0,0 +1,70 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#ifndef __CLAYERCACHE_H__
+#define __CLAYERCACHE_H__
+
+#include <memory>
+
+#include "SDL.h"
+
+#include "CMapSnapshot.h"
+#include "CSpriteAtlas.h"
+
+#define ZOOM_DURATION	150
+
+// Keeps the last full rendering of a snapshot in a target texture, so that
+// frames where nothing changed are a single copy. When the scale changes,
+// the view zooms to it over ZOOM_DURATION milliseconds by stretching the
+// cached texture around the point that stays fixed, and the snapshot is
+// only rendered again once the zoom has settled. Must only be used on the
+// render thread.
+class CLayerCache
+{
+public:
+	CLayerCache() : m_texture(nullptr), m_width(0), m_height(0), m_zooming(false), m_zoomTicks(0) {}
+	~CLayerCache() { Clear(); }
+
+	void Render(SDL_Renderer *renderer, const std::shared_ptr<const CMapSnapshot> &snapshot, CSpriteAtlas *spriteAtlas = nullptr);
+
+	// The snapshot is rendered again on the next frame.
+	void Invalidate() { m_snapshot.reset(); }
+	void Clear();
+
+private:
+	// Maps grid space to view space as view = grid * scale + offset.
+	struct ViewTransform
+	{
+		float scale;
+		float xOffset;
+		float yOffset;
+	};
+
+	ViewTransform GetZoomTransform(Uint32 ticks) const;
+	bool CreateTexture(SDL_Renderer *renderer);
+
+	static ViewTransform GetTransform(const CGrid &grid);
+
+	SDL_Texture *m_texture;
+	int m_width;
+	int m_height;
+	std::shared_ptr<const CMapSnapshot> m_snapshot;
+	ViewTransform m_cached;
+	ViewTransform m_zoomStart;
+	ViewTransform m_zoomEnd;
+	bool m_zooming;
+	Uint32 m_zoomTicks;
+};
+
+#endif
\ No newline at end of file
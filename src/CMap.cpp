@@ -11,26 +11,60 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU General Public License for more details.
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_set>
 #include <vector>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
 #include "CMap.h"
 #include "doomrpg_data.h"
 
 using namespace std;
 
+CMap::CMap() : m_nextSectorHandle(0), m_nextThingOrder(0), m_lineVersion(0), m_revision(0)
+{
+	memset(&m_header, 0, sizeof(m_header));
+	memset(m_blockMap, 0, sizeof(m_blockMap));
+	memset(m_dirtyBlocks, 0, sizeof(m_dirtyBlocks));
+	memset(m_baseBlocks, 0, sizeof(m_baseBlocks));
+	memset(m_floorMap, 0, sizeof(m_floorMap));
+	memset(m_ceilingMap, 0, sizeof(m_ceilingMap));
+}
+
 void CMap::Read(const char *filename)
 {
 	bspmapex_t *map = LoadBspMapEx(filename);
+
+	if (map == nullptr)
+		return;
+
+	Read(map);
+	FreeBspMapEx(map);
+}
+
+void CMap::Read(const bspmapex_t *map)
+{
+	m_header = map->header;
 	CList<Vertex> vertices;
 	CList<Line> lines;
 
 	for (uint32_t i = 0; i < map->lineCount; i++)
 	{
-		linesegmentex_t *line = &map->lines[i];
+		const linesegmentex_t *line = &map->lines[i];
 
-		CNode<Vertex> *vertex1 = m_vertices.Insert(new Vertex({ float(line->start.x * 8), float(line->start.y * 8) }));
-		CNode<Vertex> *vertex2 = m_vertices.Insert(new Vertex({ float(line->end.x * 8), float(line->end.y * 8) }));
-		m_lines.Insert(new Line({ vertex1, vertex2 }));
+		CNode<Vertex> *vertex1 = m_vertices.Insert(new Vertex({ line->start.x * 8, line->start.y * 8 }));
+		CNode<Vertex> *vertex2 = m_vertices.Insert(new Vertex({ line->end.x * 8, line->end.y * 8 }));
+		m_lines.Insert(new Line({ vertex1, vertex2, { nullptr, nullptr }, CreateLineHandle(line->texture, line->flags) }));
 	}
 
 	/*CNode<Line> *currentLine = lines.Head();
@@ -85,38 +119,40 @@ void CMap::Read(const char *filename)
 
 	for (uint32_t i = 0; i < map->thingCount; i++)
 	{
-		thing_t *thing = &map->things[i];
+		const thing_t *thing = &map->things[i];
 
-		if ((thing->flags & 0x802) == 0x802)
+		// A door or fence without a direction has no line to become, so it
+		// is kept as a thing.
+		if ((thing->flags & 0x802) == 0x802 && (thing->flags & 0x78) != 0)
 		{
 			CNode<Vertex> *vertex1 = nullptr;
 			CNode<Vertex> *vertex2 = nullptr;
 
 			if (thing->flags & 0x8)
 			{
-				vertex1 = m_vertices.Insert(new Vertex({ float(thing->position.x * 8 + 32), float(thing->position.y * 8) }));
-				vertex2 = m_vertices.Insert(new Vertex({ float(thing->position.x * 8 - 32), float(thing->position.y * 8) }));
+				vertex1 = m_vertices.Insert(new Vertex({ thing->position.x * 8 + 32, thing->position.y * 8 }));
+				vertex2 = m_vertices.Insert(new Vertex({ thing->position.x * 8 - 32, thing->position.y * 8 }));
 			}
 			else if (thing->flags & 0x10)
 			{
-				vertex1 = m_vertices.Insert(new Vertex({ float(thing->position.x * 8 - 32), float(thing->position.y * 8) }));
-				vertex2 = m_vertices.Insert(new Vertex({ float(thing->position.x * 8 + 32), float(thing->position.y * 8) }));
+				vertex1 = m_vertices.Insert(new Vertex({ thing->position.x * 8 - 32, thing->position.y * 8 }));
+				vertex2 = m_vertices.Insert(new Vertex({ thing->position.x * 8 + 32, thing->position.y * 8 }));
 			}
 			else if (thing->flags & 0x20)
 			{
-				vertex1 = m_vertices.Insert(new Vertex({ float(thing->position.x * 8), float(thing->position.y * 8 + 32) }));
-				vertex2 = m_vertices.Insert(new Vertex({ float(thing->position.x * 8), float(thing->position.y * 8 - 32) }));
+				vertex1 = m_vertices.Insert(new Vertex({ thing->position.x * 8, thing->position.y * 8 + 32 }));
+				vertex2 = m_vertices.Insert(new Vertex({ thing->position.x * 8, thing->position.y * 8 - 32 }));
 			}
 			else if (thing->flags & 0x40)
 			{
-				vertex1 = m_vertices.Insert(new Vertex({ float(thing->position.x * 8), float(thing->position.y * 8 - 32) }));
-				vertex2 = m_vertices.Insert(new Vertex({ float(thing->position.x * 8), float(thing->position.y * 8 + 32) }));
+				vertex1 = m_vertices.Insert(new Vertex({ thing->position.x * 8, thing->position.y * 8 - 32 }));
+				vertex2 = m_vertices.Insert(new Vertex({ thing->position.x * 8, thing->position.y * 8 + 32 }));
 			}
 
-			m_lines.Insert(new Line({ vertex1, vertex2 }));
+			m_lines.Insert(new Line({ vertex1, vertex2, { nullptr, nullptr }, CreateLineHandle(thing->id, thing->flags, LINE_SOURCE_THING) }));
 		}
 		else
-			m_things.Insert(new Thing({ float(thing->position.x * 8), float(thing->position.y * 8) }));
+			m_things.Insert(new Thing({ thing->position.x * 8, thing->position.y * 8, CreateThingHandle(thing->id, thing->flags) }));
 	}
 
 	for (unsigned int y = 0; y < 32; y++)
@@ -127,88 +163,702 @@ void CMap::Read(const char *filename)
 		}
 	}
 
-	FreeBspMapEx(map);
+	m_nodes.assign(map->nodes, map->nodes + map->nodeCount);
+	m_events.assign(map->events, map->events + map->eventCount);
+	m_commands.assign(map->commands, map->commands + map->commandCount);
+
+	if (map->strings != nullptr)
+		m_strings.assign(map->strings->strings, map->strings->strings + map->strings->stringCount);
+
+	memcpy(m_floorMap, map->floorMap, sizeof(m_floorMap));
+	memcpy(m_ceilingMap, map->ceilingMap, sizeof(m_ceilingMap));
+	IndexElements();
+	FindBaseBlocks();
+	m_lineVersion++;
+}
+
+bool CMap::Write(const char *filename) const
+{
+	MapImage image;
+	Capture(image);
+
+	return WriteImage(image, filename);
 }
 
-void CMap::Write(const char *filename)
+// Map units are eight to each on-disk coordinate, which must fit in a byte.
+static coordinate_t ToCoordinate(int64_t x, int64_t y)
 {
+	return { uint8_t(min(max(x / 8, int64_t(0)), int64_t(255))), uint8_t(min(max(y / 8, int64_t(0)), int64_t(255))) };
 }
 
-void CMap::Render(SDL_Renderer *renderer, CGrid &grid)
+// Arrays are written as a 16-bit count followed by the elements.
+template <class T>
+static bool WriteArray(FILE *fp, const vector<T> &elements)
 {
-	/*for (unsigned int y = 0; y < 32; y++)
+	if (elements.size() > 0xFFFF)
+		return false;
+
+	uint16_t count = uint16_t(elements.size());
+
+	return (fwrite(&count, sizeof(uint16_t), 1, fp) == 1 && (count == 0 || fwrite(elements.data(), sizeof(T), count, fp) == count));
+}
+
+void CMap::Capture(MapImage &image) const
+{
+	image.header = m_header;
+	image.nodes = m_nodes;
+	image.events = m_events;
+	image.commands = m_commands;
+	image.strings = m_strings;
+	image.lines.clear();
+	image.things.clear();
+
+	PackBlockMap(image.blockMap);
+	memcpy(image.floorMap, m_floorMap, sizeof(image.floorMap));
+	memcpy(image.ceilingMap, m_ceilingMap, sizeof(image.ceilingMap));
+
+	// Lines shared by two sectors appear twice in the list, but are written
+	// once. Door and fence lines go back to being things at their middle.
+	unordered_set<const Line *> written;
+	vector<pair<uint32_t, thing_t>> things;
+
+	if (!m_lines.IsEmpty())
 	{
-		for (unsigned int x = 0; x < 32; x++)
+		for (CNode<Line> *currentLine = m_lines.Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
 		{
-			unsigned int color = 255 * m_blockMap[y][x] / 3;
+			const Line *line = currentLine->GetData();
 
-			SDL_SetRenderDrawColor(renderer, color, color, color, 255);
+			if (!written.insert(line).second)
+				continue;
 
-			SDL_Rect rect;
-			rect.x = int(grid.TranslateXToViewSpace(x * 64.0f));
-			rect.y = int(grid.TranslateYToViewSpace(y * 64.0f));
-			rect.w = int(64 * grid.GetScale());
-			rect.h = int(64 * grid.GetScale());
+			const Vertex *vertex1 = line->vertex1->GetData();
+			const Vertex *vertex2 = line->vertex2->GetData();
 
-			SDL_RenderFillRect(renderer, &rect);
+			if (m_lineAttributes.sources[line->handle] == LINE_SOURCE_THING)
+			{
+				thing_t thing;
+				thing.position = ToCoordinate((int64_t(vertex1->x) + vertex2->x) / 2, (int64_t(vertex1->y) + vertex2->y) / 2);
+				thing.id = uint8_t(m_lineAttributes.textures[line->handle]);
+				thing.flags = m_lineAttributes.flags[line->handle];
+				things.push_back({ m_lineAttributes.orders[line->handle], thing });
+			}
+			else
+			{
+				linesegmentex_t segment;
+				segment.start = ToCoordinate(vertex1->x, vertex1->y);
+				segment.end = ToCoordinate(vertex2->x, vertex2->y);
+				segment.texture = m_lineAttributes.textures[line->handle];
+				segment.flags = m_lineAttributes.flags[line->handle];
+				segment.unused = 0;
+				image.lines.push_back(segment);
+			}
 		}
-	}*/
+	}
+
+	if (!m_things.IsEmpty())
+	{
+		for (CNode<Thing> *currentThing = m_things.Head(); currentThing->GetData() != nullptr; currentThing = currentThing->Next())
+		{
+			const Thing *thing = currentThing->GetData();
+
+			thing_t entry;
+			entry.position = ToCoordinate(thing->x, thing->y);
+			entry.id = m_thingAttributes.ids[thing->handle];
+			entry.flags = m_thingAttributes.flags[thing->handle];
+			things.push_back({ m_thingAttributes.orders[thing->handle], entry });
+		}
+	}
+
+	sort(things.begin(), things.end(), [](const pair<uint32_t, thing_t> &a, const pair<uint32_t, thing_t> &b) { return a.first < b.first; });
+
+	for (const pair<uint32_t, thing_t> &thing : things)
+		image.things.push_back(thing.second);
+}
+
+bool CMap::WriteImage(const MapImage &image, const char *filename)
+{
+	string temporaryFilename = string(filename) + ".tmp";
+	FILE *fp = fopen(temporaryFilename.c_str(), "wb");
+
+	if (fp == nullptr)
+		return false;
+
+	bool success = WriteImage(image, fp);
+
+	if (fclose(fp) != 0)
+		success = false;
+
+#ifdef _WIN32
+	success = success && MoveFileExA(temporaryFilename.c_str(), filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+	success = success && rename(temporaryFilename.c_str(), filename) == 0;
+#endif
+
+	if (!success)
+		remove(temporaryFilename.c_str());
+
+	return success;
+}
+
+bool CMap::WriteImage(const MapImage &image, FILE *fp)
+{
+	// The layout read by LoadBspMapEx.
+	uint16_t count = uint16_t(image.strings.size());
+	bool success = (image.strings.size() <= 0xFFFF && fwrite(&image.header, sizeof(bspheaderex_t), 1, fp) == 1);
+
+	success = success && WriteArray(fp, image.nodes) && WriteArray(fp, image.lines) && WriteArray(fp, image.things) && WriteArray(fp, image.events) && WriteArray(fp, image.commands);
+	success = success && fwrite(&count, sizeof(uint16_t), 1, fp) == 1;
+
+	for (const string &text : image.strings)
+	{
+		uint16_t length = uint16_t(min(text.size(), size_t(0xFFFF)));
+		success = success && fwrite(&length, sizeof(uint16_t), 1, fp) == 1 && fwrite(text.data(), sizeof(char), length, fp) == length;
+	}
+
+	success = success && fwrite(image.blockMap, sizeof(uint8_t), sizeof(image.blockMap), fp) == sizeof(image.blockMap);
+	success = success && fwrite(image.floorMap, sizeof(uint8_t), sizeof(image.floorMap), fp) == sizeof(image.floorMap);
+	success = success && fwrite(image.ceilingMap, sizeof(uint8_t), sizeof(image.ceilingMap), fp) == sizeof(image.ceilingMap);
+
+	return success;
+}
+
+static int64_t FloorDivide(int64_t numerator, int64_t denominator)
+{
+	return numerator / denominator - (numerator % denominator != 0 && (numerator < 0) != (denominator < 0));
+}
+
+static int64_t CeilDivide(int64_t numerator, int64_t denominator)
+{
+	return -FloorDivide(-numerator, denominator);
+}
+
+// The point is (x / scale, y / scale), so that points between whole units
+// can be tested exactly.
+static bool SectorContainsScaledPoint(const Sector &sector, int64_t x, int64_t y, int64_t scale)
+{
+	bool oddNodes = false;
+	CNode<Line> *currentLine = sector.firstLine;
+
+	for (unsigned int lineCount = sector.lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+	{
+		const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
+		const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
+		int64_t x1 = vertex1->x * scale, y1 = vertex1->y * scale;
+		int64_t x2 = vertex2->x * scale, y2 = vertex2->y * scale;
+
+		if (x1 > x && x2 > x)
+			continue;
+
+		// The edge crosses left of the point when the point is on its right
+		// going up, or on its left going down.
+		int64_t side = (x2 - x1) * (y - y1) - (y2 - y1) * (x - x1);
+
+		if (y1 < y && y2 >= y)
+			oddNodes ^= (side < 0);
+		else if (y2 < y && y1 >= y)
+			oddNodes ^= (side > 0);
+	}
+
+	return oddNodes;
+}
+
+bool SectorContainsPoint(const Sector &sector, int32_t x, int32_t y)
+{
+	return SectorContainsScaledPoint(sector, x, y, 1);
+}
+
+void CalculateSectorCoverage(const Sector &sector, uint32_t *coverage)
+{
+	memset(coverage, 0, sizeof(uint32_t) * 32);
+
+	if (sector.lineCount == 0)
+		return;
+
+	int y1 = max(int(FloorDivide(sector.minY - 32, 64)), 0);
+	int y2 = min(int(CeilDivide(sector.maxY - 32, 64)), 31);
+	vector<int64_t> crossings;
+
+	// Scan the centre of each row. A cell is covered if its centre lies
+	// between a pair of edge crossings, so each span becomes one bit mask.
+	// Cell centres are whole units, so rounding the crossings up keeps the
+	// comparisons exact.
+	for (int y = y1; y <= y2; y++)
+	{
+		int64_t centerY = y * 64 + 32;
+		CNode<Line> *currentLine = sector.firstLine;
+
+		crossings.clear();
+
+		for (unsigned int lineCount = sector.lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+		{
+			const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
+			const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
+
+			if ((vertex1->y < centerY) != (vertex2->y < centerY))
+			{
+				int64_t dx = int64_t(vertex2->x) - vertex1->x, dy = int64_t(vertex2->y) - vertex1->y;
+				int64_t numerator = vertex1->x * dy + (centerY - vertex1->y) * dx;
+
+				if (dy < 0)
+					numerator = -numerator, dy = -dy;
+
+				crossings.push_back(CeilDivide(numerator, dy));
+			}
+		}
+
+		sort(crossings.begin(), crossings.end());
+
+		for (size_t i = 0; i + 1 < crossings.size(); i += 2)
+		{
+			int start = int(max(CeilDivide(crossings[i] - 32, 64), int64_t(0)));
+			int end = int(min(CeilDivide(crossings[i + 1] - 32, 64), int64_t(32)));
+
+			if (start >= end)
+				continue;
+
+			uint32_t mask = (end == 32 ? 0xFFFFFFFF : (1u << end) - 1);
+			coverage[y] |= mask & ~((1u << start) - 1);
+		}
+	}
+}
+
+void CMap::GetPlayerStart(float &x, float &y, float &angle) const
+{
+	// playerPosition is a block index and playerAngle uses 256 units per
+	// turn, counterclockwise from east.
+	x = float((m_header.playerPosition % 32) * 64 + 32);
+	y = float((m_header.playerPosition / 32) * 64 + 32);
+	angle = m_header.playerAngle * (6.28318531f / 256.0f);
+}
+
+void CMap::MarkCellsDirty(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY)
+{
+	// Walls on a cell boundary make the cell on their back side solid, so
+	// the neighbouring cells are included.
+	int x1 = max(int(FloorDivide(minX, 64)) - 1, 0);
+	int y1 = max(int(FloorDivide(minY, 64)) - 1, 0);
+	int x2 = min(int(FloorDivide(maxX, 64)) + 1, 31);
+	int y2 = min(int(FloorDivide(maxY, 64)) + 1, 31);
+
+	if (x1 > x2 || y1 > y2)
+		return;
+
+	m_revision++;
+
+	uint32_t mask = (x2 - x1 == 31 ? 0xFFFFFFFF : ((1u << (x2 - x1 + 1)) - 1) << x1);
+
+	for (int y = y1; y <= y2; y++)
+		m_dirtyBlocks[y] |= mask;
+}
+
+void CMap::UpdateDirtyCells()
+{
+	// Sector coverage is brought up to date first, since sectors open the
+	// base blocks they cover.
+	UpdateSectorFills();
+	UpdateBlockMap();
+
+	memset(m_dirtyBlocks, 0, sizeof(m_dirtyBlocks));
+}
+
+// Cells of the map as read that no wall or door accounts for, such as the
+// inside of solid regions around the map and of thick walls. Lines say
+// nothing about them, so they are kept to fall back on when their cells
+// are regenerated.
+void CMap::FindBaseBlocks()
+{
+	unsigned char blockMap[32][32];
+	uint32_t dirtyBlocks[32];
+
+	memcpy(blockMap, m_blockMap, sizeof(blockMap));
+	memcpy(dirtyBlocks, m_dirtyBlocks, sizeof(dirtyBlocks));
+	memset(m_blockMap, BLOCK_EMPTY, sizeof(m_blockMap));
+	memset(m_dirtyBlocks, 0xFF, sizeof(m_dirtyBlocks));
 
 	if (!m_lines.IsEmpty())
 	{
 		for (CNode<Line> *currentLine = m_lines.Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+			RasterizeLine(*currentLine->GetData());
+	}
+
+	for (int y = 0; y < 32; y++)
+	{
+		for (int x = 0; x < 32; x++)
+			m_baseBlocks[y][x] = (m_blockMap[y][x] == BLOCK_EMPTY ? blockMap[y][x] : (unsigned char)BLOCK_EMPTY);
+	}
+
+	memcpy(m_blockMap, blockMap, sizeof(m_blockMap));
+	memcpy(m_dirtyBlocks, dirtyBlocks, sizeof(m_dirtyBlocks));
+}
+
+void CMap::UpdateBlockMap()
+{
+	int minX = 32, minY = 32, maxX = -1, maxY = -1;
+	uint32_t covered[32];
+
+	memset(covered, 0, sizeof(covered));
+
+	if (!m_sectors.IsEmpty())
+	{
+		for (CNode<Sector> *currentSector = m_sectors.Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+		{
+			for (int y = 0; y < 32; y++)
+				covered[y] |= currentSector->GetData()->coverage[y];
+		}
+	}
+
+	// Dirty cells start from the base blocks that no sector covers.
+	for (int y = 0; y < 32; y++)
+	{
+		if (m_dirtyBlocks[y] == 0)
+			continue;
+
+		for (int x = 0; x < 32; x++)
 		{
-			if (currentLine->VisitNode() == 0)
+			if ((m_dirtyBlocks[y] >> x) & 1)
 			{
-				const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
-				const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
-				int x1 = int(grid.TranslateXToViewSpace(vertex1->x));
-				int y1 = int(grid.TranslateYToViewSpace(vertex1->y));
-				int x2 = int(grid.TranslateXToViewSpace(vertex2->x));
-				int y2 = int(grid.TranslateYToViewSpace(vertex2->y));
-
-				if (currentLine->GetRefCount() == 1)
-					SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-				else
-					SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
-
-				SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
+				m_blockMap[y][x] = ((covered[y] >> x) & 1 ? (unsigned char)BLOCK_EMPTY : m_baseBlocks[y][x]);
+				minX = min(minX, x);
+				maxX = max(maxX, x);
 			}
 		}
 
-		vector<SDL_Rect> rects;
+		minY = min(minY, y);
+		maxY = y;
+	}
+
+	if (maxY < 0)
+		return;
+
+	// Only lines that can reach a dirty cell are rasterized again.
+	int32_t dirtyMinX = minX * 64 - 64, dirtyMinY = minY * 64 - 64;
+	int32_t dirtyMaxX = (maxX + 1) * 64 + 64, dirtyMaxY = (maxY + 1) * 64 + 64;
+
+	if (!m_lines.IsEmpty())
+	{
+		for (CNode<Line> *currentLine = m_lines.Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+		{
+			if (currentLine->VisitNode() != 0)
+				continue;
+
+			const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
+			const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
+
+			if (max(vertex1->x, vertex2->x) < dirtyMinX || min(vertex1->x, vertex2->x) > dirtyMaxX || max(vertex1->y, vertex2->y) < dirtyMinY || min(vertex1->y, vertex2->y) > dirtyMaxY)
+				continue;
+
+			RasterizeLine(*currentLine->GetData());
+		}
+	}
+}
+
+void CMap::UpdateSectorFills()
+{
+	if (m_sectors.IsEmpty())
+		return;
+
+	uint32_t refill[32];
+	memcpy(refill, m_dirtyBlocks, sizeof(refill));
+
+	// Recalculate the coverage of every sector near a dirty cell and clear
+	// the cells it no longer covers.
+	for (CNode<Sector> *currentSector = m_sectors.Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+	{
+		Sector *sector = currentSector->GetData();
+		int x1 = max(int(FloorDivide(sector->minX, 64)), 0);
+		int y1 = max(int(FloorDivide(sector->minY, 64)), 0);
+		int x2 = min(int(FloorDivide(sector->maxX, 64)), 31);
+		int y2 = min(int(FloorDivide(sector->maxY, 64)), 31);
+		uint32_t columns = (x1 <= x2 ? (x2 - x1 == 31 ? 0xFFFFFFFF : ((1u << (x2 - x1 + 1)) - 1) << x1) : 0);
+		bool dirty = false;
+
+		for (int y = 0; y < 32 && !dirty; y++)
+			dirty = (m_dirtyBlocks[y] & (sector->coverage[y] | (y >= y1 && y <= y2 ? columns : 0))) != 0;
+
+		if (!dirty)
+			continue;
+
+		uint32_t coverage[32];
+		CalculateSectorCoverage(*sector, coverage);
 
-		for (CNode<Vertex> *currentVertex = m_vertices.Head(); currentVertex->GetData() != nullptr; currentVertex = currentVertex->Next())
+		for (int y = 0; y < 32; y++)
 		{
-			if (currentVertex->VisitNode() == 0)
+			uint32_t cleared = sector->coverage[y] & ~coverage[y];
+
+			for (int x = 0; cleared != 0; x++, cleared >>= 1)
 			{
-				const Vertex *vertex = currentVertex->GetData();
-				int x = int(grid.TranslateXToViewSpace(vertex->x));
-				int y = int(grid.TranslateYToViewSpace(vertex->y));
-				rects.push_back({ x - 2, y - 2, 5, 5 });
+				if (cleared & 1)
+					m_floorMap[y * 32 + x] = m_ceilingMap[y * 32 + x] = 0;
 			}
-		}
 
-		SDL_SetRenderDrawColor(renderer, 0, 128, 255, 255);
-		SDL_RenderFillRects(renderer, rects.data(), rects.size());
+			refill[y] |= sector->coverage[y] | coverage[y];
+			sector->coverage[y] = coverage[y];
+		}
 	}
 
-	if (!m_things.IsEmpty())
+	// Fill every sector that overlaps a changed cell, in list order so that
+	// later sectors win where they overlap.
+	for (CNode<Sector> *currentSector = m_sectors.Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
 	{
-		vector<SDL_Rect> rects;
+		const Sector *sector = currentSector->GetData();
 
-		for (CNode<Thing> *currentThing = m_things.Head(); currentThing->GetData() != nullptr; currentThing = currentThing->Next())
+		for (int y = 0; y < 32; y++)
 		{
-			if (currentThing->VisitNode() == 0)
+			uint32_t cells = sector->coverage[y] & refill[y];
+
+			for (int x = 0; cells != 0; x++, cells >>= 1)
 			{
-				const Thing *thing = currentThing->GetData();
-				int x = int(grid.TranslateXToViewSpace(thing->x));
-				int y = int(grid.TranslateYToViewSpace(thing->y));
-				rects.push_back({ x - grid.GetScaledCellSize() / 2, y - grid.GetScaledCellSize() / 2, grid.GetScaledCellSize() + 1, grid.GetScaledCellSize() + 1 });
+				if (cells & 1)
+				{
+					m_floorMap[y * 32 + x] = sector->floorTexture;
+					m_ceilingMap[y * 32 + x] = sector->ceilingTexture;
+				}
 			}
 		}
+	}
+}
+
+void CMap::ClearSectorFill(const Sector &sector)
+{
+	for (int y = 0; y < 32; y++)
+	{
+		uint32_t cells = sector.coverage[y];
+
+		for (int x = 0; cells != 0; x++, cells >>= 1)
+		{
+			if (cells & 1)
+				m_floorMap[y * 32 + x] = m_ceilingMap[y * 32 + x] = 0;
+		}
+	}
+}
+
+void CMap::PackBlockMap(uint8_t *blockMap) const
+{
+	memset(blockMap, 0, 256);
+
+	for (unsigned int y = 0; y < 32; y++)
+	{
+		for (unsigned int x = 0; x < 32; x++)
+			blockMap[y * 8 + (x / 4)] |= (m_blockMap[y][x] & 0x3) << ((x % 4) * 2);
+	}
+}
+
+void CMap::RasterizeLine(const Line &line)
+{
+	const Vertex *vertex1 = line.vertex1->GetData();
+	const Vertex *vertex2 = line.vertex2->GetData();
+
+	if (m_lineAttributes.sources[line.handle] == LINE_SOURCE_THING)
+	{
+		SetBlock(int(FloorDivide(int64_t(vertex1->x) + vertex2->x, 128)), int(FloorDivide(int64_t(vertex1->y) + vertex2->y, 128)), BLOCK_DOOR);
+		return;
+	}
+
+	int64_t dx = int64_t(vertex2->x) - vertex1->x;
+	int64_t dy = int64_t(vertex2->y) - vertex1->y;
+
+	if (dx == 0 && dy == 0)
+		return;
+
+	float length = sqrtf(float(dx * dx + dy * dy));
+
+	// Find the side of the wall that is solid. Walls read from a map say
+	// which way they face, otherwise the solid side is the one outside the
+	// line's only sector. Two-sided lines block nothing.
+	float normalX = -dy / length;
+	float normalY = dx / length;
+	uint16_t flags = m_lineAttributes.flags[line.handle];
+
+	if (flags & LF_NORTH_FACING_WALL)
+		normalX = 0.0f, normalY = 1.0f;
+	else if (flags & LF_SOUTH_FACING_WALL)
+		normalX = 0.0f, normalY = -1.0f;
+	else if (flags & LF_EAST_FACING_WALL)
+		normalX = -1.0f, normalY = 0.0f;
+	else if (flags & LF_WEST_FACING_WALL)
+		normalX = 1.0f, normalY = 0.0f;
+	else if (line.sectors[0] != nullptr && line.sectors[1] == nullptr)
+	{
+		// Probe half a unit from the midpoint along the axis closest to the
+		// normal, in half units so the test stays exact.
+		int64_t probeX = int64_t(vertex1->x) + vertex2->x, probeY = int64_t(vertex1->y) + vertex2->y;
+
+		if (llabs(dx) >= llabs(dy))
+			probeY += (dx > 0 ? 1 : -1);
+		else
+			probeX += (dy > 0 ? -1 : 1);
+
+		if (SectorContainsScaledPoint(*line.sectors[0], probeX, probeY, 2))
+			normalX = -normalX, normalY = -normalY;
+	}
+	else
+		return;
+
+	// Sample every half cell along the line and mark the cell half a cell
+	// away on the solid side.
+	int sampleCount = max(int(ceilf(length / 32.0f)), 1);
 
-		SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
-		SDL_RenderFillRects(renderer, rects.data(), rects.size());
+	for (int i = 0; i < sampleCount; i++)
+	{
+		float t = (i + 0.5f) / sampleCount;
+		float x = vertex1->x + dx * t + normalX * 32.0f;
+		float y = vertex1->y + dy * t + normalY * 32.0f;
+
+		SetBlock(int(floorf(x / 64.0f)), int(floorf(y / 64.0f)), BLOCK_SOLID);
+	}
+}
+
+void CMap::SetBlock(int x, int y, unsigned char block)
+{
+	if (x < 0 || y < 0 || x >= 32 || y >= 32 || ((m_dirtyBlocks[y] >> x) & 1) == 0)
+		return;
+
+	// Doors win over walls so a door between two solid cells stays open.
+	if (m_blockMap[y][x] != BLOCK_DOOR)
+		m_blockMap[y][x] = block;
+}
+
+unsigned int CMap::CreateLineHandle(uint16_t texture, uint16_t flags, LineSource source)
+{
+	unsigned int handle;
+	uint32_t order = (source == LINE_SOURCE_THING ? m_nextThingOrder++ : 0);
+
+	if (!m_freeLineHandles.empty())
+	{
+		handle = m_freeLineHandles.back();
+		m_freeLineHandles.pop_back();
+
+		m_lineAttributes.textures[handle] = texture;
+		m_lineAttributes.flags[handle] = flags;
+		m_lineAttributes.sources[handle] = source;
+		m_lineAttributes.orders[handle] = order;
+	}
+	else
+	{
+		handle = (unsigned int)m_lineAttributes.sources.size();
+
+		m_lineAttributes.textures.push_back(texture);
+		m_lineAttributes.flags.push_back(flags);
+		m_lineAttributes.sources.push_back(source);
+		m_lineAttributes.orders.push_back(order);
+	}
+
+	return handle;
+}
+
+void CMap::ReleaseLineHandle(unsigned int handle)
+{
+	if (handle >= m_lineAttributes.sources.size() || m_lineAttributes.sources[handle] == LINE_SOURCE_FREE)
+		return;
+
+	m_lineAttributes.textures[handle] = 0;
+	m_lineAttributes.flags[handle] = 0;
+	m_lineAttributes.sources[handle] = LINE_SOURCE_FREE;
+	m_lineAttributes.orders[handle] = 0;
+	m_freeLineHandles.push_back(handle);
+
+	if (handle < m_lineElements.size())
+		m_lineElements[handle] = nullptr;
+
+	m_dirtyHandles.lines.push_back(handle);
+	m_lineVersion++;
+	m_revision++;
+}
+
+unsigned int CMap::CreateThingHandle(uint8_t id, uint16_t flags)
+{
+	m_thingAttributes.ids.push_back(id);
+	m_thingAttributes.flags.push_back(flags);
+	m_thingAttributes.orders.push_back(m_nextThingOrder++);
+
+	return (unsigned int)(m_thingAttributes.ids.size() - 1);
+}
+
+void CMap::ReleaseSectorHandle(unsigned int handle)
+{
+	if (handle < m_sectorElements.size())
+		m_sectorElements[handle] = nullptr;
+
+	m_dirtyHandles.sectors.push_back(handle);
+	m_revision++;
+}
+
+template <class T>
+static void SetElement(vector<const T *> &elements, unsigned int handle, const T *element)
+{
+	if (handle >= elements.size())
+		elements.resize(handle + 1, nullptr);
+
+	elements[handle] = element;
+}
+
+void CMap::MarkLineDirty(const Line &line)
+{
+	SetElement(m_lineElements, line.handle, &line);
+	m_dirtyHandles.lines.push_back(line.handle);
+	m_lineVersion++;
+	m_revision++;
+}
+
+void CMap::MarkSectorDirty(const Sector &sector)
+{
+	SetElement(m_sectorElements, sector.handle, &sector);
+	m_dirtyHandles.sectors.push_back(sector.handle);
+	m_revision++;
+}
+
+void CMap::MarkThingDirty(const Thing &thing)
+{
+	SetElement(m_thingElements, thing.handle, &thing);
+	m_dirtyHandles.things.push_back(thing.handle);
+	m_revision++;
+}
+
+void CMap::IndexElements()
+{
+	m_lineElements.assign(m_lineAttributes.sources.size(), nullptr);
+	m_sectorElements.assign(m_nextSectorHandle, nullptr);
+	m_thingElements.assign(m_thingAttributes.ids.size(), nullptr);
+
+	for (CNode<Line> *currentLine = m_lines.Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+		SetElement(m_lineElements, currentLine->GetData()->handle, currentLine->GetData());
+
+	for (CNode<Sector> *currentSector = m_sectors.Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+		SetElement(m_sectorElements, currentSector->GetData()->handle, currentSector->GetData());
+
+	for (CNode<Thing> *currentThing = m_things.Head(); currentThing->GetData() != nullptr; currentThing = currentThing->Next())
+		SetElement(m_thingElements, currentThing->GetData()->handle, currentThing->GetData());
+}
+
+void CMap::TakeDirtyHandles(DirtyHandles &dirtyHandles)
+{
+	dirtyHandles = DirtyHandles();
+	swap(dirtyHandles, m_dirtyHandles);
+}
+
+void CMap::FindLinesWithFlags(uint16_t mask, uint16_t value, vector<unsigned int> &handles) const
+{
+	const uint16_t *flags = m_lineAttributes.flags.data();
+	const LineSource *sources = m_lineAttributes.sources.data();
+
+	handles.clear();
+
+	for (size_t i = 0, count = m_lineAttributes.flags.size(); i < count; i++)
+	{
+		if ((flags[i] & mask) == value && sources[i] == LINE_SOURCE_SEGMENT)
+			handles.push_back((unsigned int)i);
+	}
+}
+
+void CMap::FindThingsWithId(uint8_t id, vector<unsigned int> &handles) const
+{
+	const uint8_t *ids = m_thingAttributes.ids.data();
+
+	handles.clear();
+
+	for (size_t i = 0, count = m_thingAttributes.ids.size(); i < count; i++)
+	{
+		if (ids[i] == id)
+			handles.push_back((unsigned int)i);
 	}
 }
\ No newline at end of file
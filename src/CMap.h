@@ -14,15 +14,23 @@
 #ifndef __CMAP_H__
 #define __CMAP_H__
 
-#include "SDL.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
 
-#include "CGrid.h"
 #include "CList.h"
+#include "doomrpg_data.h"
 
+#define INVALID_HANDLE	0xFFFFFFFF
+
+// Coordinates are whole map units, eight to each unit of the on-disk
+// coordinate_t, so every predicate on them can be evaluated exactly in
+// integer arithmetic.
 struct Vertex
 {
-	float x;
-	float y;
+	int32_t x;
+	int32_t y;
 };
 
 struct Sector;
@@ -32,49 +40,217 @@ struct Line
 	CNode<Vertex> *vertex1;
 	CNode<Vertex> *vertex2;
 	Sector *sectors[2];
+	unsigned int handle;
 };
 
 
 struct Sector
 {
-	float minX;
-	float minY;
-	float maxX;
-	float maxY;
+	int32_t minX;
+	int32_t minY;
+	int32_t maxX;
+	int32_t maxY;
 	CNode<Vertex> *firstVertex;
 	CNode<Vertex> *lastVertex;
 	CNode<Line> *firstLine;
 	CNode<Line> *lastLine;
 	unsigned int vertexCount;
 	unsigned int lineCount;
+	unsigned char floorTexture;
+	unsigned char ceilingTexture;
+	uint32_t coverage[32];
+	unsigned int handle;
+};
+
+enum BlockType
+{
+	BLOCK_EMPTY,
+	BLOCK_SOLID,
+	BLOCK_DOOR,
+	BLOCK_OTHER
 };
 
 struct Thing
 {
-	float x;
-	float y;
+	int32_t x;
+	int32_t y;
+	unsigned int handle;
+};
+
+// Where a line's attributes came from. Door and fence things are edited as
+// lines, so their thing id and flags are kept in the line's texture and
+// flags slots for writing back out.
+enum LineSource : uint8_t
+{
+	LINE_SOURCE_FREE,
+	LINE_SOURCE_SEGMENT,
+	LINE_SOURCE_THING
+};
+
+// Handles of elements changed since the last call to TakeDirtyHandles.
+struct DirtyHandles
+{
+	std::vector<unsigned int> lines;
+	std::vector<unsigned int> sectors;
+	std::vector<unsigned int> things;
+};
+
+// Twice the signed area of the triangle vertex1, vertex2, (x, y). Positive
+// when the point lies to the left of the line from vertex1 to vertex2.
+inline int64_t Orientation(const Vertex &vertex1, const Vertex &vertex2, int64_t x, int64_t y)
+{
+	return (int64_t(vertex2.x) - vertex1.x) * (y - vertex1.y) - (int64_t(vertex2.y) - vertex1.y) * (x - vertex1.x);
+}
+
+bool SectorContainsPoint(const Sector &sector, int32_t x, int32_t y);
+void CalculateSectorCoverage(const Sector &sector, uint32_t *coverage);
+
+// Attributes are stored in parallel arrays indexed by the handle of the
+// element they belong to, so filters are linear scans over packed memory.
+// Things, and lines that came from things, keep an order so that they are
+// written back in the order they were read.
+struct LineAttributes
+{
+	std::vector<uint16_t> textures;
+	std::vector<uint16_t> flags;
+	std::vector<LineSource> sources;
+	std::vector<uint32_t> orders;
+};
+
+struct ThingAttributes
+{
+	std::vector<uint8_t> ids;
+	std::vector<uint16_t> flags;
+	std::vector<uint32_t> orders;
+};
+
+// The map in its on-disk form, flat and owning no nodes, so that it can be
+// written out on another thread while editing goes on.
+struct MapImage
+{
+	bspheaderex_t header;
+	std::vector<bspnode_t> nodes;
+	std::vector<linesegmentex_t> lines;
+	std::vector<thing_t> things;
+	std::vector<uint32_t> events;
+	std::vector<command_t> commands;
+	std::vector<std::string> strings;
+	uint8_t blockMap[256];
+	uint8_t floorMap[1024];
+	uint8_t ceilingMap[1024];
 };
 
 class CMap
 {
+	friend class CMapCache;
+
 public:
-	CMap() {}
+	CMap();
 
 	void Read(const char *filename);
-	void Write(const char *filename);
-	void Render(SDL_Renderer *renderer, CGrid &grid);
+	void Read(const bspmapex_t *map);
+	bool Write(const char *filename) const;
+
+	void Capture(MapImage &image) const;
+
+	// Writes to a temporary file that replaces filename once complete, so
+	// that a crash never leaves a partly written map behind.
+	static bool WriteImage(const MapImage &image, const char *filename);
+	static bool WriteImage(const MapImage &image, FILE *fp);
+
+	// Changes whenever the map is edited.
+	unsigned int GetRevision() const { return m_revision; }
 
 	CList<Vertex> *GetVertices() { return &m_vertices; }
 	CList<Line> *GetLines() { return &m_lines; }
 	CList<Sector> *GetSectors() { return &m_sectors; }
 	CList<Thing> *GetThings() { return &m_things; }
 
+	const bspheaderex_t &GetHeader() const { return m_header; }
+	const unsigned char *GetBlockMap() const { return &m_blockMap[0][0]; }
+	unsigned char GetBlock(int x, int y) const { return ((x >= 0 && y >= 0 && x < 32 && y < 32) ? m_blockMap[y][x] : (unsigned char)BLOCK_SOLID); }
+
+	void GetPlayerStart(float &x, float &y, float &angle) const;
+
+	void MarkCellsDirty(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY);
+	void UpdateDirtyCells();
+	void PackBlockMap(uint8_t *blockMap) const;
+	void ClearSectorFill(const Sector &sector);
+
+	unsigned int CreateLineHandle(uint16_t texture = 0, uint16_t flags = 0, LineSource source = LINE_SOURCE_SEGMENT);
+	void ReleaseLineHandle(unsigned int handle);
+	unsigned int CreateThingHandle(uint8_t id, uint16_t flags);
+	unsigned int CreateSectorHandle() { return m_nextSectorHandle++; }
+	void ReleaseSectorHandle(unsigned int handle);
+
+	// Marking an element dirty also records it as the element its handle
+	// belongs to, which GetLine, GetSector and GetThing return until the
+	// handle is released.
+	void MarkLineDirty(const Line &line);
+	void MarkSectorDirty(const Sector &sector);
+	void MarkThingDirty(const Thing &thing);
+	void TakeDirtyHandles(DirtyHandles &dirtyHandles);
+	unsigned int GetLineVersion() const { return m_lineVersion; }
+
+	const Line *GetLine(unsigned int handle) const { return (handle < m_lineElements.size() ? m_lineElements[handle] : nullptr); }
+	const Sector *GetSector(unsigned int handle) const { return (handle < m_sectorElements.size() ? m_sectorElements[handle] : nullptr); }
+	const Thing *GetThing(unsigned int handle) const { return (handle < m_thingElements.size() ? m_thingElements[handle] : nullptr); }
+
+	const LineAttributes &GetLineAttributes() const { return m_lineAttributes; }
+	const ThingAttributes &GetThingAttributes() const { return m_thingAttributes; }
+	uint16_t GetLineTexture(unsigned int handle) const { return m_lineAttributes.textures[handle]; }
+	uint16_t GetLineFlags(unsigned int handle) const { return m_lineAttributes.flags[handle]; }
+	LineSource GetLineSource(unsigned int handle) const { return m_lineAttributes.sources[handle]; }
+	uint8_t GetThingId(unsigned int handle) const { return m_thingAttributes.ids[handle]; }
+	uint16_t GetThingFlags(unsigned int handle) const { return m_thingAttributes.flags[handle]; }
+	void SetLineTexture(unsigned int handle, uint16_t texture) { m_lineAttributes.textures[handle] = texture; m_dirtyHandles.lines.push_back(handle); m_revision++; }
+	void SetLineFlags(unsigned int handle, uint16_t flags) { m_lineAttributes.flags[handle] = flags; m_dirtyHandles.lines.push_back(handle); m_revision++; }
+	void SetThingId(unsigned int handle, uint8_t id) { m_thingAttributes.ids[handle] = id; m_dirtyHandles.things.push_back(handle); m_revision++; }
+	void SetThingFlags(unsigned int handle, uint16_t flags) { m_thingAttributes.flags[handle] = flags; m_dirtyHandles.things.push_back(handle); m_revision++; }
+
+	void FindLinesWithFlags(uint16_t mask, uint16_t value, std::vector<unsigned int> &handles) const;
+	void FindThingsWithId(uint8_t id, std::vector<unsigned int> &handles) const;
+
+	const std::vector<bspnode_t> &GetNodes() const { return m_nodes; }
+	const std::vector<uint32_t> &GetEvents() const { return m_events; }
+	const std::vector<command_t> &GetCommands() const { return m_commands; }
+	const std::vector<std::string> &GetStrings() const { return m_strings; }
+	const unsigned char *GetFloorMap() const { return m_floorMap; }
+	const unsigned char *GetCeilingMap() const { return m_ceilingMap; }
+
 private:
+	void IndexElements();
+	void FindBaseBlocks();
+	void UpdateBlockMap();
+	void UpdateSectorFills();
+	void RasterizeLine(const Line &line);
+	void SetBlock(int x, int y, unsigned char block);
+
 	CList<Vertex> m_vertices;
 	CList<Line> m_lines;
 	CList<Sector> m_sectors;
 	CList<Thing> m_things;
+	LineAttributes m_lineAttributes;
+	ThingAttributes m_thingAttributes;
+	std::vector<unsigned int> m_freeLineHandles;
+	std::vector<const Line *> m_lineElements;
+	std::vector<const Sector *> m_sectorElements;
+	std::vector<const Thing *> m_thingElements;
+	unsigned int m_nextSectorHandle;
+	uint32_t m_nextThingOrder;
+	DirtyHandles m_dirtyHandles;
+	unsigned int m_lineVersion;
+	unsigned int m_revision;
+	bspheaderex_t m_header;
 	unsigned char m_blockMap[32][32];
+	uint32_t m_dirtyBlocks[32];
+	unsigned char m_baseBlocks[32][32];
+	std::vector<bspnode_t> m_nodes;
+	std::vector<uint32_t> m_events;
+	std::vector<command_t> m_commands;
+	std::vector<std::string> m_strings;
+	unsigned char m_floorMap[1024];
+	unsigned char m_ceilingMap[1024];
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,570 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "CHash.h"
+#include "CMapCache.h"
+#include "CMappedFile.h"
+
+using namespace std;
+
+static const size_t sectionElementSizes[MAP_CACHE_SECTION_COUNT] =
+{
+	sizeof(mapcachefixed_t),
+	sizeof(cachedvertex_t),
+	sizeof(cachedline_t),
+	sizeof(cachedsector_t),
+	sizeof(cachedthing_t),
+	sizeof(uint16_t),
+	sizeof(uint16_t),
+	sizeof(uint8_t),
+	sizeof(uint32_t),
+	sizeof(uint8_t),
+	sizeof(uint16_t),
+	sizeof(uint32_t),
+	sizeof(uint32_t),
+	sizeof(bspnode_t),
+	sizeof(uint32_t),
+	sizeof(command_t),
+	sizeof(uint32_t),
+	sizeof(char)
+};
+
+static_assert(sizeof(LineSource) == sizeof(uint8_t), "line sources are cached as bytes");
+
+template <class T>
+static void AppendSection(vector<uint8_t> &buffer, MapCacheSection section, const T *data, size_t count)
+{
+	// Sections start on 8 byte boundaries, so they can be read in place.
+	buffer.resize((buffer.size() + 7) & ~size_t(7));
+
+	mapcachesection_t *entry = &((mapcacheheader_t *)buffer.data())->sections[section];
+	entry->offset = buffer.size();
+	entry->count = count;
+
+	buffer.insert(buffer.end(), (const uint8_t *)data, (const uint8_t *)(data + count));
+}
+
+// Numbers the nodes of a list in order, and records for each node the
+// first node that holds the same data, or INVALID_HANDLE when it is that
+// node.
+template <class T>
+static void IndexNodes(const CList<T> &list, unordered_map<const CNode<T> *, uint32_t> &nodes, unordered_map<const T *, uint32_t> &data, vector<uint32_t> &references)
+{
+	if (list.IsEmpty())
+		return;
+
+	for (CNode<T> *currentNode = list.Head(); currentNode->GetData() != nullptr; currentNode = currentNode->Next())
+	{
+		uint32_t index = uint32_t(references.size());
+		auto first = data.find(currentNode->GetData());
+
+		nodes[currentNode] = index;
+
+		if (first != data.end())
+			references.push_back(first->second);
+		else
+		{
+			data[currentNode->GetData()] = index;
+			references.push_back(INVALID_HANDLE);
+		}
+	}
+}
+
+template <class T>
+static uint32_t FindIndex(const unordered_map<const T *, uint32_t> &indices, const T *key)
+{
+	if (key == nullptr)
+		return INVALID_HANDLE;
+
+	auto index = indices.find(key);
+
+	return (index != indices.end() ? index->second : INVALID_HANDLE);
+}
+
+// A reference must name an earlier node that owns its data.
+static bool IsValidReference(uint32_t reference, uint32_t index, const uint32_t *references)
+{
+	return (reference == INVALID_HANDLE || (reference < index && references[reference] == INVALID_HANDLE));
+}
+
+static bool IsValidIndex(uint32_t index, uint64_t count)
+{
+	return (index == INVALID_HANDLE || index < count);
+}
+
+CMapCache::CMapCache(const string &directory) : m_directory(directory), m_hitCount(0), m_missCount(0), m_storeCount(0)
+{
+	if (!m_directory.empty() && m_directory.back() != '/' && m_directory.back() != '\\')
+		m_directory += '/';
+
+#ifdef _WIN32
+	_mkdir(m_directory.c_str());
+#else
+	mkdir(m_directory.c_str(), 0755);
+#endif
+}
+
+bool CMapCache::Read(const char *filename, CMap &map)
+{
+	FILE *file = fopen(filename, "rb");
+
+	if (file == nullptr)
+		return false;
+
+	vector<uint8_t> data;
+	uint8_t buffer[65536];
+	size_t count;
+
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		data.insert(data.end(), buffer, buffer + count);
+
+	fclose(file);
+
+	return Read(data.data(), data.size(), map);
+}
+
+bool CMapCache::Read(const uint8_t *data, size_t size, CMap &map)
+{
+	CHash dataHash;
+	dataHash.Add(data, size);
+
+	uint64_t hash = dataHash.GetValue();
+	string filename = GetEntryFilename(hash);
+
+	if (Load(filename, hash, size, map))
+	{
+		m_hitCount++;
+		return true;
+	}
+
+	bspmapex_t *bspMap = ReadBspMapEx(data, size);
+
+	if (bspMap == nullptr)
+		return false;
+
+	map.Read(bspMap);
+	FreeBspMapEx(bspMap);
+
+	m_missCount++;
+	Store(filename, hash, size, map);
+
+	return true;
+}
+
+string CMapCache::GetEntryFilename(uint64_t hash) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.dmc", (unsigned long long)hash);
+
+	return m_directory + name;
+}
+
+bool CMapCache::Load(const string &filename, uint64_t hash, uint64_t size, CMap &map) const
+{
+	CMappedFile file;
+
+	if (!file.Open(filename.c_str()) || file.GetSize() < sizeof(mapcacheheader_t))
+		return false;
+
+	const uint8_t *data = file.GetData();
+	const mapcacheheader_t *header = (const mapcacheheader_t *)data;
+
+	if (header->magic != MAP_CACHE_MAGIC || header->version != MAP_CACHE_VERSION || header->sourceHash != hash || header->sourceSize != size)
+		return false;
+
+	for (unsigned int i = 0; i < MAP_CACHE_SECTION_COUNT; i++)
+	{
+		const mapcachesection_t &section = header->sections[i];
+
+		if (section.offset % 8 != 0 || section.offset > file.GetSize() || section.count > (file.GetSize() - section.offset) / sectionElementSizes[i])
+			return false;
+	}
+
+	const mapcachesection_t *sections = header->sections;
+
+	if (sections[MAP_CACHE_FIXED].count != 1 || sections[MAP_CACHE_LINE_FLAGS].count != sections[MAP_CACHE_LINE_TEXTURES].count || sections[MAP_CACHE_LINE_SOURCES].count != sections[MAP_CACHE_LINE_TEXTURES].count ||
+		sections[MAP_CACHE_LINE_ORDERS].count != sections[MAP_CACHE_LINE_TEXTURES].count || sections[MAP_CACHE_THING_FLAGS].count != sections[MAP_CACHE_THING_IDS].count ||
+		sections[MAP_CACHE_THING_ORDERS].count != sections[MAP_CACHE_THING_IDS].count || sections[MAP_CACHE_STRING_OFFSETS].count == 0)
+		return false;
+
+	const mapcachefixed_t *fixed = (const mapcachefixed_t *)(data + sections[MAP_CACHE_FIXED].offset);
+	const cachedvertex_t *vertices = (const cachedvertex_t *)(data + sections[MAP_CACHE_VERTICES].offset);
+	const cachedline_t *lines = (const cachedline_t *)(data + sections[MAP_CACHE_LINES].offset);
+	const cachedsector_t *sectors = (const cachedsector_t *)(data + sections[MAP_CACHE_SECTORS].offset);
+	const cachedthing_t *things = (const cachedthing_t *)(data + sections[MAP_CACHE_THINGS].offset);
+	const uint16_t *lineTextures = (const uint16_t *)(data + sections[MAP_CACHE_LINE_TEXTURES].offset);
+	const uint16_t *lineFlags = (const uint16_t *)(data + sections[MAP_CACHE_LINE_FLAGS].offset);
+	const uint8_t *lineSources = data + sections[MAP_CACHE_LINE_SOURCES].offset;
+	const uint32_t *lineOrders = (const uint32_t *)(data + sections[MAP_CACHE_LINE_ORDERS].offset);
+	const uint8_t *thingIds = data + sections[MAP_CACHE_THING_IDS].offset;
+	const uint16_t *thingFlags = (const uint16_t *)(data + sections[MAP_CACHE_THING_FLAGS].offset);
+	const uint32_t *thingOrders = (const uint32_t *)(data + sections[MAP_CACHE_THING_ORDERS].offset);
+	const uint32_t *freeLineHandles = (const uint32_t *)(data + sections[MAP_CACHE_FREE_LINE_HANDLES].offset);
+	const bspnode_t *nodes = (const bspnode_t *)(data + sections[MAP_CACHE_NODES].offset);
+	const uint32_t *events = (const uint32_t *)(data + sections[MAP_CACHE_EVENTS].offset);
+	const command_t *commands = (const command_t *)(data + sections[MAP_CACHE_COMMANDS].offset);
+	const uint32_t *stringOffsets = (const uint32_t *)(data + sections[MAP_CACHE_STRING_OFFSETS].offset);
+	const char *stringData = (const char *)(data + sections[MAP_CACHE_STRING_DATA].offset);
+
+	uint32_t vertexCount = uint32_t(sections[MAP_CACHE_VERTICES].count);
+	uint32_t lineCount = uint32_t(sections[MAP_CACHE_LINES].count);
+	uint32_t sectorCount = uint32_t(sections[MAP_CACHE_SECTORS].count);
+	uint32_t thingCount = uint32_t(sections[MAP_CACHE_THINGS].count);
+	uint64_t lineHandleCount = sections[MAP_CACHE_LINE_TEXTURES].count;
+	uint64_t thingHandleCount = sections[MAP_CACHE_THING_IDS].count;
+	uint32_t stringCount = uint32_t(sections[MAP_CACHE_STRING_OFFSETS].count - 1);
+
+	// Everything is checked before the map is touched, so that a bad entry
+	// leaves it empty for a rebuild.
+	vector<uint32_t> references(max(max(vertexCount, lineCount), max(sectorCount, thingCount)));
+
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		if (!IsValidReference(vertices[i].reference, i, references.data()))
+			return false;
+
+		references[i] = vertices[i].reference;
+	}
+
+	for (uint32_t i = 0; i < sectorCount; i++)
+	{
+		const cachedsector_t &sector = sectors[i];
+
+		if (!IsValidReference(sector.reference, i, references.data()) || !IsValidIndex(sector.firstVertex, vertexCount) || !IsValidIndex(sector.lastVertex, vertexCount) ||
+			!IsValidIndex(sector.firstLine, lineCount) || !IsValidIndex(sector.lastLine, lineCount) || sector.handle >= fixed->nextSectorHandle)
+			return false;
+
+		references[i] = sector.reference;
+	}
+
+	for (uint32_t i = 0; i < lineCount; i++)
+	{
+		const cachedline_t &line = lines[i];
+
+		// Sectors name the node that owns their data.
+		for (uint32_t sector : line.sectors)
+		{
+			if (!IsValidIndex(sector, sectorCount) || (sector != INVALID_HANDLE && sectors[sector].reference != INVALID_HANDLE))
+				return false;
+		}
+
+		if (!IsValidReference(line.reference, i, references.data()) || line.vertex1 >= vertexCount || line.vertex2 >= vertexCount || line.handle >= lineHandleCount)
+			return false;
+
+		references[i] = line.reference;
+	}
+
+	for (uint32_t i = 0; i < thingCount; i++)
+	{
+		if (!IsValidReference(things[i].reference, i, references.data()) || things[i].handle >= thingHandleCount)
+			return false;
+
+		references[i] = things[i].reference;
+	}
+
+	for (uint64_t i = 0; i < lineHandleCount; i++)
+	{
+		if (lineSources[i] > LINE_SOURCE_THING)
+			return false;
+	}
+
+	for (uint64_t i = 0; i < sections[MAP_CACHE_FREE_LINE_HANDLES].count; i++)
+	{
+		if (freeLineHandles[i] >= lineHandleCount)
+			return false;
+	}
+
+	for (uint32_t i = 0; i < stringCount; i++)
+	{
+		if (stringOffsets[i] > stringOffsets[i + 1])
+			return false;
+	}
+
+	if (stringOffsets[0] != 0 || stringOffsets[stringCount] > sections[MAP_CACHE_STRING_DATA].count)
+		return false;
+
+	// Fixup: indices become node pointers again.
+	vector<CNode<Vertex> *> vertexNodes(vertexCount);
+	vector<CNode<Line> *> lineNodes(lineCount);
+	vector<CNode<Sector> *> sectorNodes(sectorCount);
+
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		if (vertices[i].reference == INVALID_HANDLE)
+			vertexNodes[i] = map.m_vertices.Insert(new Vertex({ vertices[i].x, vertices[i].y }));
+		else
+			vertexNodes[i] = map.m_vertices.Insert(vertexNodes[vertices[i].reference]);
+	}
+
+	// Lines and sectors point at each other, so sectors get their lines once
+	// the lines exist.
+	for (uint32_t i = 0; i < sectorCount; i++)
+	{
+		const cachedsector_t &cached = sectors[i];
+
+		if (cached.reference != INVALID_HANDLE)
+		{
+			sectorNodes[i] = map.m_sectors.Insert(sectorNodes[cached.reference]);
+			continue;
+		}
+
+		Sector *sector = new Sector;
+		sector->minX = cached.minX;
+		sector->minY = cached.minY;
+		sector->maxX = cached.maxX;
+		sector->maxY = cached.maxY;
+		sector->firstVertex = (cached.firstVertex != INVALID_HANDLE ? vertexNodes[cached.firstVertex] : nullptr);
+		sector->lastVertex = (cached.lastVertex != INVALID_HANDLE ? vertexNodes[cached.lastVertex] : nullptr);
+		sector->firstLine = nullptr;
+		sector->lastLine = nullptr;
+		sector->vertexCount = cached.vertexCount;
+		sector->lineCount = cached.lineCount;
+		sector->floorTexture = cached.floorTexture;
+		sector->ceilingTexture = cached.ceilingTexture;
+		memcpy(sector->coverage, cached.coverage, sizeof(sector->coverage));
+		sector->handle = cached.handle;
+
+		sectorNodes[i] = map.m_sectors.Insert(sector);
+	}
+
+	for (uint32_t i = 0; i < lineCount; i++)
+	{
+		const cachedline_t &cached = lines[i];
+
+		if (cached.reference != INVALID_HANDLE)
+		{
+			lineNodes[i] = map.m_lines.Insert(lineNodes[cached.reference]);
+			continue;
+		}
+
+		Sector *sector1 = (cached.sectors[0] != INVALID_HANDLE ? sectorNodes[cached.sectors[0]]->GetData() : nullptr);
+		Sector *sector2 = (cached.sectors[1] != INVALID_HANDLE ? sectorNodes[cached.sectors[1]]->GetData() : nullptr);
+
+		lineNodes[i] = map.m_lines.Insert(new Line({ vertexNodes[cached.vertex1], vertexNodes[cached.vertex2], { sector1, sector2 }, cached.handle }));
+	}
+
+	for (uint32_t i = 0; i < sectorCount; i++)
+	{
+		if (sectors[i].reference == INVALID_HANDLE)
+		{
+			Sector *sector = sectorNodes[i]->GetData();
+			sector->firstLine = (sectors[i].firstLine != INVALID_HANDLE ? lineNodes[sectors[i].firstLine] : nullptr);
+			sector->lastLine = (sectors[i].lastLine != INVALID_HANDLE ? lineNodes[sectors[i].lastLine] : nullptr);
+		}
+	}
+
+	vector<CNode<Thing> *> thingNodes(thingCount);
+
+	for (uint32_t i = 0; i < thingCount; i++)
+	{
+		if (things[i].reference == INVALID_HANDLE)
+			thingNodes[i] = map.m_things.Insert(new Thing({ things[i].x, things[i].y, things[i].handle }));
+		else
+			thingNodes[i] = map.m_things.Insert(thingNodes[things[i].reference]);
+	}
+
+	map.m_lineAttributes.textures.assign(lineTextures, lineTextures + lineHandleCount);
+	map.m_lineAttributes.flags.assign(lineFlags, lineFlags + lineHandleCount);
+	map.m_lineAttributes.sources.assign((const LineSource *)lineSources, (const LineSource *)lineSources + lineHandleCount);
+	map.m_lineAttributes.orders.assign(lineOrders, lineOrders + lineHandleCount);
+	map.m_thingAttributes.ids.assign(thingIds, thingIds + thingHandleCount);
+	map.m_thingAttributes.flags.assign(thingFlags, thingFlags + thingHandleCount);
+	map.m_thingAttributes.orders.assign(thingOrders, thingOrders + thingHandleCount);
+	map.m_nextThingOrder = 0;
+
+	for (uint32_t order : map.m_lineAttributes.orders)
+		map.m_nextThingOrder = max(map.m_nextThingOrder, order + 1);
+
+	for (uint32_t order : map.m_thingAttributes.orders)
+		map.m_nextThingOrder = max(map.m_nextThingOrder, order + 1);
+	map.m_freeLineHandles.assign(freeLineHandles, freeLineHandles + sections[MAP_CACHE_FREE_LINE_HANDLES].count);
+	map.m_nextSectorHandle = fixed->nextSectorHandle;
+
+	map.m_header = fixed->header;
+	memcpy(map.m_blockMap, fixed->blockMap, sizeof(map.m_blockMap));
+	memcpy(map.m_floorMap, fixed->floorMap, sizeof(map.m_floorMap));
+	memcpy(map.m_ceilingMap, fixed->ceilingMap, sizeof(map.m_ceilingMap));
+
+	map.m_nodes.assign(nodes, nodes + sections[MAP_CACHE_NODES].count);
+	map.m_events.assign(events, events + sections[MAP_CACHE_EVENTS].count);
+	map.m_commands.assign(commands, commands + sections[MAP_CACHE_COMMANDS].count);
+	map.m_strings.clear();
+
+	for (uint32_t i = 0; i < stringCount; i++)
+		map.m_strings.emplace_back(stringData + stringOffsets[i], stringOffsets[i + 1] - stringOffsets[i]);
+
+	map.IndexElements();
+	map.FindBaseBlocks();
+	map.m_lineVersion++;
+
+	return true;
+}
+
+bool CMapCache::Store(const string &filename, uint64_t hash, uint64_t size, const CMap &map)
+{
+	unordered_map<const CNode<Vertex> *, uint32_t> vertexNodes;
+	unordered_map<const CNode<Line> *, uint32_t> lineNodes;
+	unordered_map<const CNode<Sector> *, uint32_t> sectorNodes;
+	unordered_map<const CNode<Thing> *, uint32_t> thingNodes;
+	unordered_map<const Vertex *, uint32_t> vertexData;
+	unordered_map<const Line *, uint32_t> lineData;
+	unordered_map<const Sector *, uint32_t> sectorData;
+	unordered_map<const Thing *, uint32_t> thingData;
+	vector<uint32_t> vertexReferences, lineReferences, sectorReferences, thingReferences;
+
+	IndexNodes(map.m_vertices, vertexNodes, vertexData, vertexReferences);
+	IndexNodes(map.m_lines, lineNodes, lineData, lineReferences);
+	IndexNodes(map.m_sectors, sectorNodes, sectorData, sectorReferences);
+	IndexNodes(map.m_things, thingNodes, thingData, thingReferences);
+
+	vector<cachedvertex_t> vertices;
+	vector<cachedline_t> lines;
+	vector<cachedsector_t> sectors;
+	vector<cachedthing_t> things;
+
+	if (!map.m_vertices.IsEmpty())
+	{
+		for (CNode<Vertex> *currentVertex = map.m_vertices.Head(); currentVertex->GetData() != nullptr; currentVertex = currentVertex->Next())
+			vertices.push_back({ currentVertex->GetData()->x, currentVertex->GetData()->y, vertexReferences[vertices.size()] });
+	}
+
+	if (!map.m_lines.IsEmpty())
+	{
+		for (CNode<Line> *currentLine = map.m_lines.Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+		{
+			const Line *line = currentLine->GetData();
+			cachedline_t cached = { FindIndex(vertexNodes, (const CNode<Vertex> *)line->vertex1), FindIndex(vertexNodes, (const CNode<Vertex> *)line->vertex2),
+				{ FindIndex(sectorData, (const Sector *)line->sectors[0]), FindIndex(sectorData, (const Sector *)line->sectors[1]) }, line->handle, lineReferences[lines.size()] };
+
+			// A line whose vertex is not in the map cannot be linked back up.
+			if (cached.vertex1 == INVALID_HANDLE || cached.vertex2 == INVALID_HANDLE)
+				return false;
+
+			lines.push_back(cached);
+		}
+	}
+
+	if (!map.m_sectors.IsEmpty())
+	{
+		for (CNode<Sector> *currentSector = map.m_sectors.Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+		{
+			const Sector *sector = currentSector->GetData();
+			cachedsector_t cached;
+			memset(&cached, 0, sizeof(cached));
+			cached.minX = sector->minX;
+			cached.minY = sector->minY;
+			cached.maxX = sector->maxX;
+			cached.maxY = sector->maxY;
+			cached.firstVertex = FindIndex(vertexNodes, (const CNode<Vertex> *)sector->firstVertex);
+			cached.lastVertex = FindIndex(vertexNodes, (const CNode<Vertex> *)sector->lastVertex);
+			cached.firstLine = FindIndex(lineNodes, (const CNode<Line> *)sector->firstLine);
+			cached.lastLine = FindIndex(lineNodes, (const CNode<Line> *)sector->lastLine);
+			cached.vertexCount = sector->vertexCount;
+			cached.lineCount = sector->lineCount;
+			cached.floorTexture = sector->floorTexture;
+			cached.ceilingTexture = sector->ceilingTexture;
+			memcpy(cached.coverage, sector->coverage, sizeof(cached.coverage));
+			cached.handle = sector->handle;
+			cached.reference = sectorReferences[sectors.size()];
+
+			sectors.push_back(cached);
+		}
+	}
+
+	if (!map.m_things.IsEmpty())
+	{
+		for (CNode<Thing> *currentThing = map.m_things.Head(); currentThing->GetData() != nullptr; currentThing = currentThing->Next())
+			things.push_back({ currentThing->GetData()->x, currentThing->GetData()->y, currentThing->GetData()->handle, thingReferences[things.size()] });
+	}
+
+	mapcachefixed_t fixed;
+	memset(&fixed, 0, sizeof(fixed));
+	fixed.header = map.m_header;
+	memcpy(fixed.blockMap, map.m_blockMap, sizeof(fixed.blockMap));
+	memcpy(fixed.floorMap, map.m_floorMap, sizeof(fixed.floorMap));
+	memcpy(fixed.ceilingMap, map.m_ceilingMap, sizeof(fixed.ceilingMap));
+	fixed.nextSectorHandle = map.m_nextSectorHandle;
+
+	vector<uint32_t> stringOffsets(1, 0);
+	string stringData;
+
+	for (const string &text : map.m_strings)
+	{
+		stringData += text;
+		stringOffsets.push_back(uint32_t(stringData.size()));
+	}
+
+	vector<uint8_t> buffer(sizeof(mapcacheheader_t), 0);
+	mapcacheheader_t *header = (mapcacheheader_t *)buffer.data();
+	header->magic = MAP_CACHE_MAGIC;
+	header->version = MAP_CACHE_VERSION;
+	header->sourceHash = hash;
+	header->sourceSize = size;
+
+	AppendSection(buffer, MAP_CACHE_FIXED, &fixed, 1);
+	AppendSection(buffer, MAP_CACHE_VERTICES, vertices.data(), vertices.size());
+	AppendSection(buffer, MAP_CACHE_LINES, lines.data(), lines.size());
+	AppendSection(buffer, MAP_CACHE_SECTORS, sectors.data(), sectors.size());
+	AppendSection(buffer, MAP_CACHE_THINGS, things.data(), things.size());
+	AppendSection(buffer, MAP_CACHE_LINE_TEXTURES, map.m_lineAttributes.textures.data(), map.m_lineAttributes.textures.size());
+	AppendSection(buffer, MAP_CACHE_LINE_FLAGS, map.m_lineAttributes.flags.data(), map.m_lineAttributes.flags.size());
+	AppendSection(buffer, MAP_CACHE_LINE_SOURCES, map.m_lineAttributes.sources.data(), map.m_lineAttributes.sources.size());
+	AppendSection(buffer, MAP_CACHE_LINE_ORDERS, map.m_lineAttributes.orders.data(), map.m_lineAttributes.orders.size());
+	AppendSection(buffer, MAP_CACHE_THING_IDS, map.m_thingAttributes.ids.data(), map.m_thingAttributes.ids.size());
+	AppendSection(buffer, MAP_CACHE_THING_FLAGS, map.m_thingAttributes.flags.data(), map.m_thingAttributes.flags.size());
+	AppendSection(buffer, MAP_CACHE_THING_ORDERS, map.m_thingAttributes.orders.data(), map.m_thingAttributes.orders.size());
+	AppendSection(buffer, MAP_CACHE_FREE_LINE_HANDLES, map.m_freeLineHandles.data(), map.m_freeLineHandles.size());
+	AppendSection(buffer, MAP_CACHE_NODES, map.m_nodes.data(), map.m_nodes.size());
+	AppendSection(buffer, MAP_CACHE_EVENTS, map.m_events.data(), map.m_events.size());
+	AppendSection(buffer, MAP_CACHE_COMMANDS, map.m_commands.data(), map.m_commands.size());
+	AppendSection(buffer, MAP_CACHE_STRING_OFFSETS, stringOffsets.data(), stringOffsets.size());
+	AppendSection(buffer, MAP_CACHE_STRING_DATA, stringData.data(), stringData.size());
+
+	// Written under a name of its own and renamed into place, so that a
+	// reader never maps a half written entry.
+	string temporaryFilename = filename + ".tmp" + to_string(m_storeCount++);
+	FILE *file = fopen(temporaryFilename.c_str(), "wb");
+
+	if (file == nullptr)
+		return false;
+
+	bool success = (fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size());
+
+	if (fclose(file) != 0)
+		success = false;
+
+#ifdef _WIN32
+	// rename does not replace an existing file here.
+	if (success)
+		remove(filename.c_str());
+#endif
+
+	if (!success || rename(temporaryFilename.c_str(), filename.c_str()) != 0)
+	{
+		remove(temporaryFilename.c_str());
+		return false;
+	}
+
+	return true;
+}
\ No newline at end of file
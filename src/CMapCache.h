@@ -0,0 +1,150 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CMAPCACHE_H__
+#define __CMAPCACHE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CMap.h"
+
+#define MAP_CACHE_MAGIC		0x434D5044	// "DPMC"
+#define MAP_CACHE_VERSION	2
+
+enum MapCacheSection
+{
+	MAP_CACHE_FIXED,
+	MAP_CACHE_VERTICES,
+	MAP_CACHE_LINES,
+	MAP_CACHE_SECTORS,
+	MAP_CACHE_THINGS,
+	MAP_CACHE_LINE_TEXTURES,
+	MAP_CACHE_LINE_FLAGS,
+	MAP_CACHE_LINE_SOURCES,
+	MAP_CACHE_LINE_ORDERS,
+	MAP_CACHE_THING_IDS,
+	MAP_CACHE_THING_FLAGS,
+	MAP_CACHE_THING_ORDERS,
+	MAP_CACHE_FREE_LINE_HANDLES,
+	MAP_CACHE_NODES,
+	MAP_CACHE_EVENTS,
+	MAP_CACHE_COMMANDS,
+	MAP_CACHE_STRING_OFFSETS,
+	MAP_CACHE_STRING_DATA,
+	MAP_CACHE_SECTION_COUNT
+};
+
+// An entry holds no pointers. Sections are found by offset from the start
+// of the file, and list nodes refer to each other by their position in
+// their list, with INVALID_HANDLE for null. A node that shares its data
+// with an earlier node of the same list names that node in reference.
+struct mapcachesection_t
+{
+	uint64_t offset;
+	uint64_t count;
+};
+
+struct mapcacheheader_t
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	mapcachesection_t sections[MAP_CACHE_SECTION_COUNT];
+};
+
+struct mapcachefixed_t
+{
+	bspheaderex_t header;
+	uint8_t blockMap[32 * 32];
+	uint8_t floorMap[1024];
+	uint8_t ceilingMap[1024];
+	uint32_t nextSectorHandle;
+};
+
+struct cachedvertex_t
+{
+	int32_t x;
+	int32_t y;
+	uint32_t reference;
+};
+
+struct cachedline_t
+{
+	uint32_t vertex1;
+	uint32_t vertex2;
+	uint32_t sectors[2];
+	uint32_t handle;
+	uint32_t reference;
+};
+
+struct cachedsector_t
+{
+	int32_t minX;
+	int32_t minY;
+	int32_t maxX;
+	int32_t maxY;
+	uint32_t firstVertex;
+	uint32_t lastVertex;
+	uint32_t firstLine;
+	uint32_t lastLine;
+	uint32_t vertexCount;
+	uint32_t lineCount;
+	uint8_t floorTexture;
+	uint8_t ceilingTexture;
+	uint32_t coverage[32];
+	uint32_t handle;
+	uint32_t reference;
+};
+
+struct cachedthing_t
+{
+	int32_t x;
+	int32_t y;
+	uint32_t handle;
+	uint32_t reference;
+};
+
+// Built maps kept on disk, named after a hash of the map file's contents,
+// so that reopening an unchanged map maps the entry and relinks its nodes
+// instead of converting the file again. An entry whose recorded hash or
+// size does not match the source, or that fails validation, is rebuilt
+// and replaced. Safe to use from several threads.
+class CMapCache
+{
+public:
+	CMapCache(const std::string &directory);
+
+	// Returns false when the map could not be read. map must be empty.
+	bool Read(const char *filename, CMap &map);
+	bool Read(const uint8_t *data, size_t size, CMap &map);
+
+	unsigned int GetHitCount() const { return m_hitCount; }
+	unsigned int GetMissCount() const { return m_missCount; }
+
+private:
+	std::string GetEntryFilename(uint64_t hash) const;
+
+	bool Load(const std::string &filename, uint64_t hash, uint64_t size, CMap &map) const;
+	bool Store(const std::string &filename, uint64_t hash, uint64_t size, const CMap &map);
+
+	std::string m_directory;
+	std::atomic<unsigned int> m_hitCount;
+	std::atomic<unsigned int> m_missCount;
+	std::atomic<unsigned int> m_storeCount;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,442 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "CChunkPager.h"
+#include "CMapSnapshot.h"
+#include "CScreenCells.h"
+
+using namespace std;
+
+CMapSnapshot::CMapSnapshot(CMap &map, const CGrid &grid, int mode, float scale) : m_grid(grid), m_mode(mode), m_scale(scale), m_issueCount(0), m_header(map.GetHeader()), m_drawing(false), m_highlightClosed(false), m_boxSelecting(false)
+{
+	memcpy(m_blockMap, map.GetBlockMap(), sizeof(m_blockMap));
+	map.GetPlayerStart(m_playerX, m_playerY, m_playerAngle);
+
+	CList<Line> *lines = map.GetLines();
+	CList<Vertex> *vertices = map.GetVertices();
+	CList<Thing> *things = map.GetThings();
+
+	m_lines.reserve(lines->UniqueSize());
+	m_vertices.reserve(vertices->UniqueSize());
+	m_things.reserve(things->UniqueSize());
+
+	if (!lines->IsEmpty())
+	{
+		for (CNode<Line> *currentLine = lines->Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+		{
+			if (currentLine->VisitNode() == 0)
+			{
+				const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
+				const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
+				m_lines.push_back({ float(vertex1->x), float(vertex1->y), float(vertex2->x), float(vertex2->y), currentLine->GetRefCount() != 1 });
+
+				unsigned int handle = currentLine->GetData()->handle;
+
+				if (map.GetLineSource(handle) == LINE_SOURCE_SEGMENT)
+					m_wallTextures.push_back(map.GetLineTexture(handle));
+				else if (map.GetLineSource(handle) == LINE_SOURCE_THING)
+					m_thingIds.push_back(map.GetLineTexture(handle));
+			}
+		}
+
+		for (CNode<Vertex> *currentVertex = vertices->Head(); currentVertex->GetData() != nullptr; currentVertex = currentVertex->Next())
+		{
+			if (currentVertex->VisitNode() == 0)
+				m_vertices.push_back(*currentVertex->GetData());
+		}
+	}
+
+	if (!things->IsEmpty())
+	{
+		for (CNode<Thing> *currentThing = things->Head(); currentThing->GetData() != nullptr; currentThing = currentThing->Next())
+		{
+			if (currentThing->VisitNode() == 0)
+			{
+				const Thing *thing = currentThing->GetData();
+				m_things.push_back({ float(thing->x), float(thing->y), map.GetThingId(thing->handle) });
+				m_thingIds.push_back(map.GetThingId(thing->handle));
+			}
+		}
+	}
+
+	sort(m_wallTextures.begin(), m_wallTextures.end());
+	m_wallTextures.erase(unique(m_wallTextures.begin(), m_wallTextures.end()), m_wallTextures.end());
+	sort(m_thingIds.begin(), m_thingIds.end());
+	m_thingIds.erase(unique(m_thingIds.begin(), m_thingIds.end()), m_thingIds.end());
+}
+
+void CMapSnapshot::Render(SDL_Renderer *renderer, CSpriteAtlas *spriteAtlas) const
+{
+	m_grid.Render(renderer);
+
+	int width = m_grid.GetViewWidth(), height = m_grid.GetViewHeight();
+
+	RenderChunks(renderer);
+	RenderLines(renderer, m_lines, 255);
+
+	if (!m_vertices.empty())
+	{
+		// Markers closer together than VERTEX_MARKER_SPACING pixels are
+		// merged into the first one, so there are never more markers than
+		// cells in the view.
+		CScreenCells vertexCells(width, height, VERTEX_MARKER_SPACING);
+		vector<SDL_Rect> rects;
+
+		for (const Vertex &vertex : m_vertices)
+		{
+			int x = int(m_grid.TranslateXToViewSpace(float(vertex.x)));
+			int y = int(m_grid.TranslateYToViewSpace(float(vertex.y)));
+
+			if (vertexCells.Occupy(x, y))
+				rects.push_back({ x - 2, y - 2, 5, 5 });
+		}
+
+		SDL_SetRenderDrawColor(renderer, 0, 128, 255, 255);
+		SDL_RenderFillRects(renderer, rects.data(), int(rects.size()));
+	}
+
+	RenderThings(renderer, spriteAtlas);
+
+	if (m_drawing)
+	{
+		int x1 = int(m_grid.TranslateXToViewSpace(m_drawingLine.x1));
+		int y1 = int(m_grid.TranslateYToViewSpace(m_drawingLine.y1));
+		int x2 = int(m_grid.TranslateXToViewSpace(m_drawingLine.x2));
+		int y2 = int(m_grid.TranslateYToViewSpace(m_drawingLine.y2));
+		SDL_Rect rects[2] = { { x1 - 2, y1 - 2, 5, 5 }, { x2 - 2, y2 - 2, 5, 5 } };
+
+		SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+		SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
+
+		SDL_SetRenderDrawColor(renderer, 0, 128, 255, 255);
+		SDL_RenderFillRects(renderer, rects, 2);
+	}
+
+	if (m_highlightPoints.size() == 1)
+	{
+		SDL_Rect rect = { int(m_grid.TranslateXToViewSpace(m_highlightPoints[0].x)) - 2, int(m_grid.TranslateYToViewSpace(m_highlightPoints[0].y)) - 2, 5, 5 };
+
+		SDL_SetRenderDrawColor(renderer, 255, 128, 0, 255);
+		SDL_RenderFillRect(renderer, &rect);
+	}
+	else if (m_highlightPoints.size() > 1)
+	{
+		vector<SDL_Point> screenCoords;
+		vector<SDL_Rect> rects;
+
+		for (const Vertex &point : m_highlightPoints)
+		{
+			screenCoords.push_back({ int(m_grid.TranslateXToViewSpace(point.x)), int(m_grid.TranslateYToViewSpace(point.y)) });
+			rects.push_back({ screenCoords.back().x - 2, screenCoords.back().y - 2, 5, 5 });
+		}
+
+		SDL_SetRenderDrawColor(renderer, 255, 128, 0, 255);
+		SDL_RenderDrawLines(renderer, screenCoords.data(), screenCoords.size());
+
+		if (m_highlightClosed)
+			SDL_RenderDrawLine(renderer, screenCoords.front().x, screenCoords.front().y, screenCoords.back().x, screenCoords.back().y);
+
+		SDL_SetRenderDrawColor(renderer, 0, 128, 255, 255);
+		SDL_RenderFillRects(renderer, rects.data(), rects.size());
+	}
+
+	if (!m_selectedLines.empty())
+	{
+		SDL_SetRenderDrawColor(renderer, 255, 128, 0, 255);
+
+		for (const SnapshotLine &line : m_selectedLines)
+			SDL_RenderDrawLine(renderer, int(m_grid.TranslateXToViewSpace(line.x1)), int(m_grid.TranslateYToViewSpace(line.y1)), int(m_grid.TranslateXToViewSpace(line.x2)), int(m_grid.TranslateYToViewSpace(line.y2)));
+	}
+
+	if (m_boxSelecting)
+	{
+		int x1 = int(m_grid.TranslateXToViewSpace(m_selectionBox.x1));
+		int y1 = int(m_grid.TranslateYToViewSpace(m_selectionBox.y1));
+		int x2 = int(m_grid.TranslateXToViewSpace(m_selectionBox.x2));
+		int y2 = int(m_grid.TranslateYToViewSpace(m_selectionBox.y2));
+		SDL_Point points[5] = { { x1, y1 }, { x2, y1 }, { x2, y2 }, { x1, y2 }, { x1, y1 } };
+
+		SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+		SDL_RenderDrawLines(renderer, points, 5);
+	}
+}
+
+// Clips the segment to [0, width) x [0, height), false if nothing is left.
+static bool ClipToView(float &x1, float &y1, float &x2, float &y2, int width, int height)
+{
+	float dx = x2 - x1, dy = y2 - y1;
+	float p[4] = { -dx, dx, -dy, dy };
+	float q[4] = { x1, width - 1 - x1, y1, height - 1 - y1 };
+	float t1 = 0.0f, t2 = 1.0f;
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (p[i] == 0.0f)
+		{
+			if (q[i] < 0.0f)
+				return false;
+
+			continue;
+		}
+
+		float t = q[i] / p[i];
+
+		if (p[i] < 0.0f)
+			t1 = max(t1, t);
+		else
+			t2 = min(t2, t);
+	}
+
+	if (t1 > t2)
+		return false;
+
+	x2 = x1 + t2 * dx;
+	y2 = y1 + t2 * dy;
+	x1 += t1 * dx;
+	y1 += t1 * dy;
+
+	return true;
+}
+
+void CMapSnapshot::RenderLines(SDL_Renderer *renderer, const vector<SnapshotLine> &lines, Uint8 brightness) const
+{
+	int width = m_grid.GetViewWidth(), height = m_grid.GetViewHeight();
+	CScreenCells lineCells(width, height, VERTEX_MARKER_SPACING);
+	CScreenCells pixelCells(width, height, 1);
+	vector<SDL_Point> points[2];
+
+	for (const SnapshotLine &line : lines)
+	{
+		float x1 = m_grid.TranslateXToViewSpace(line.x1);
+		float y1 = m_grid.TranslateYToViewSpace(line.y1);
+		float x2 = m_grid.TranslateXToViewSpace(line.x2);
+		float y2 = m_grid.TranslateYToViewSpace(line.y2);
+
+		// Lines that fit in one cell of the view are drawn as a single point,
+		// and only once per cell.
+		if (fabs(x2 - x1) < VERTEX_MARKER_SPACING && fabs(y2 - y1) < VERTEX_MARKER_SPACING)
+		{
+			if (lineCells.Occupy(int(x1), int(y1)))
+				points[line.shared].push_back({ int(x1), int(y1) });
+
+			continue;
+		}
+
+		if (!ClipToView(x1, y1, x2, y2, width, height))
+			continue;
+
+		// Longer lines are stepped out pixel by pixel over their visible part,
+		// so each pixel of the view is drawn at most once however many lines
+		// cross it.
+		int steps = int(max(fabs(x2 - x1), fabs(y2 - y1))) + 1;
+		float stepX = (x2 - x1) / steps, stepY = (y2 - y1) / steps;
+
+		for (int i = 0; i <= steps; i++)
+		{
+			int x = int(x1 + stepX * i + 0.5f), y = int(y1 + stepY * i + 0.5f);
+
+			if (pixelCells.Occupy(x, y))
+				points[line.shared].push_back({ x, y });
+		}
+	}
+
+	for (int shared = 0; shared < 2; shared++)
+	{
+		if (points[shared].empty())
+			continue;
+
+		Uint8 color = (!shared ? brightness : brightness / 2);
+		SDL_SetRenderDrawColor(renderer, color, color, color, 255);
+		SDL_RenderDrawPoints(renderer, points[shared].data(), int(points[shared].size()));
+	}
+}
+
+// Neighbouring chunks are drawn dimmed, with their things as plain markers.
+void CMapSnapshot::RenderChunks(SDL_Renderer *renderer) const
+{
+	if (m_chunks.empty())
+		return;
+
+	int width = m_grid.GetViewWidth(), height = m_grid.GetViewHeight();
+	int32_t minX = m_grid.TranslateXToGridSpace(0), minY = m_grid.TranslateYToGridSpace(0);
+	int32_t maxX = m_grid.TranslateXToGridSpace(width), maxY = m_grid.TranslateYToGridSpace(height);
+	CScreenCells thingCells(width, height, VERTEX_MARKER_SPACING);
+	vector<SDL_Rect> rects;
+
+	for (const shared_ptr<const Chunk> &chunk : m_chunks)
+	{
+		if (chunk->maxX < minX || chunk->maxY < minY || chunk->minX > maxX || chunk->minY > maxY)
+			continue;
+
+		RenderLines(renderer, chunk->lines, 128);
+
+		for (const SnapshotThing &thing : chunk->things)
+		{
+			int x = int(m_grid.TranslateXToViewSpace(thing.x));
+			int y = int(m_grid.TranslateYToViewSpace(thing.y));
+
+			if (thingCells.Occupy(x, y))
+				rects.push_back({ x - 1, y - 1, 3, 3 });
+		}
+	}
+
+	SDL_SetRenderDrawColor(renderer, 0, 128, 0, 255);
+	SDL_RenderFillRects(renderer, rects.data(), int(rects.size()));
+}
+
+void CMapSnapshot::RenderThings(SDL_Renderer *renderer, CSpriteAtlas *spriteAtlas) const
+{
+	if (m_things.empty())
+		return;
+
+	vector<const SnapshotThing *> things;
+	vector<SDL_Rect> tiles[THING_DENSITY_LEVELS];
+	vector<SDL_Rect> rects;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	vector<SDL_Vertex> vertices;
+	vector<int> indices;
+#endif
+
+	// Zoomed out, things that share a tile of the view are drawn as the
+	// tile, shaded by how many there are.
+	if (SPRITE_SIZE * m_scale <= THING_TILE_SIZE)
+		AggregateThings(things, tiles);
+	else
+	{
+		things.reserve(m_things.size());
+
+		for (const SnapshotThing &thing : m_things)
+			things.push_back(&thing);
+	}
+
+	for (int level = 0; level < THING_DENSITY_LEVELS; level++)
+	{
+		if (tiles[level].empty())
+			continue;
+
+		SDL_SetRenderDrawColor(renderer, 0, Uint8(96 + level * 64), 0, 255);
+		SDL_RenderFillRects(renderer, tiles[level].data(), int(tiles[level].size()));
+	}
+
+	for (const SnapshotThing *thing : things)
+	{
+		int x = int(m_grid.TranslateXToViewSpace(thing->x));
+		int y = int(m_grid.TranslateYToViewSpace(thing->y));
+		AtlasRegion region = {};
+
+		// Sprites are batched with SDL_RenderGeometry, which older SDL
+		// does not have, so there things are drawn as plain markers.
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+		if (spriteAtlas != nullptr)
+			region = spriteAtlas->GetThingRegion(thing->id);
+#endif
+
+		if (!region.valid)
+		{
+			rects.push_back({ x - m_grid.GetScaledCellSize() / 2, y - m_grid.GetScaledCellSize() / 2, m_grid.GetScaledCellSize() + 1, m_grid.GetScaledCellSize() + 1 });
+			continue;
+		}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+		// Sprites are SPRITE_SIZE map units wide and centered on the thing.
+		float x1 = m_grid.TranslateXToViewSpace(thing->x - SPRITE_SIZE / 2 + region.xOffset);
+		float y1 = m_grid.TranslateYToViewSpace(thing->y - SPRITE_SIZE / 2 + region.yOffset);
+		float x2 = m_grid.TranslateXToViewSpace(thing->x - SPRITE_SIZE / 2 + region.xOffset + region.rect.w);
+		float y2 = m_grid.TranslateYToViewSpace(thing->y - SPRITE_SIZE / 2 + region.yOffset + region.rect.h);
+		float u1 = float(region.rect.x) / spriteAtlas->GetWidth();
+		float v1 = float(region.rect.y) / spriteAtlas->GetHeight();
+		float u2 = float(region.rect.x + region.rect.w) / spriteAtlas->GetWidth();
+		float v2 = float(region.rect.y + region.rect.h) / spriteAtlas->GetHeight();
+		int index = int(vertices.size());
+		SDL_Color color = { 255, 255, 255, 255 };
+
+		vertices.push_back({ { x1, y1 }, color, { u1, v1 } });
+		vertices.push_back({ { x2, y1 }, color, { u2, v1 } });
+		vertices.push_back({ { x2, y2 }, color, { u2, v2 } });
+		vertices.push_back({ { x1, y2 }, color, { u1, v2 } });
+
+		indices.insert(indices.end(), { index, index + 1, index + 2, index, index + 2, index + 3 });
+#endif
+	}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	if (!vertices.empty())
+		SDL_RenderGeometry(renderer, spriteAtlas->GetTexture(renderer), vertices.data(), int(vertices.size()), indices.data(), int(indices.size()));
+#endif
+
+	if (!rects.empty())
+	{
+		SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+		SDL_RenderFillRects(renderer, rects.data(), rects.size());
+	}
+}
+
+void CMapSnapshot::AggregateThings(vector<const SnapshotThing *> &things, vector<SDL_Rect> *tiles) const
+{
+	int columns = (m_grid.GetViewWidth() + THING_TILE_SIZE - 1) / THING_TILE_SIZE;
+	int rows = (m_grid.GetViewHeight() + THING_TILE_SIZE - 1) / THING_TILE_SIZE;
+	vector<unsigned int> counts(columns * rows, 0);
+	vector<const SnapshotThing *> firstThings(columns * rows, nullptr);
+
+	for (const SnapshotThing &thing : m_things)
+	{
+		int x = int(m_grid.TranslateXToViewSpace(thing.x));
+		int y = int(m_grid.TranslateYToViewSpace(thing.y));
+
+		if (x < 0 || y < 0 || x >= columns * THING_TILE_SIZE || y >= rows * THING_TILE_SIZE)
+			continue;
+
+		int tile = (y / THING_TILE_SIZE) * columns + x / THING_TILE_SIZE;
+
+		if (counts[tile]++ == 0)
+			firstThings[tile] = &thing;
+	}
+
+	// A thing alone in its tile is still drawn as itself.
+	for (int tile = 0; tile < columns * rows; tile++)
+	{
+		if (counts[tile] == 1)
+			things.push_back(firstThings[tile]);
+		else if (counts[tile] > 1)
+		{
+			int level = 0;
+
+			while (level + 1 < THING_DENSITY_LEVELS && counts[tile] >= (4u << level))
+				level++;
+
+			tiles[level].push_back({ (tile % columns) * THING_TILE_SIZE, (tile / columns) * THING_TILE_SIZE, THING_TILE_SIZE, THING_TILE_SIZE });
+		}
+	}
+}
+
+void CMapSnapshot::SetDrawingLine(float x1, float y1, float x2, float y2)
+{
+	m_drawingLine = { x1, y1, x2, y2, false };
+	m_drawing = true;
+}
+
+void CMapSnapshot::SetHighlight(const vector<Vertex> &points, bool closed)
+{
+	m_highlightPoints = points;
+	m_highlightClosed = closed;
+}
+
+void CMapSnapshot::SetSelectionBox(float x1, float y1, float x2, float y2)
+{
+	m_selectionBox = { x1, y1, x2, y2, false };
+	m_boxSelecting = true;
+}
\ No newline at end of file
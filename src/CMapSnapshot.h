@@ -0,0 +1,109 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CMAPSNAPSHOT_H__
+#define __CMAPSNAPSHOT_H__
+
+#include <memory>
+#include <vector>
+
+#include "SDL.h"
+
+#include "CGrid.h"
+#include "CMap.h"
+#include "CSpriteAtlas.h"
+
+// Zoomed out, vertex markers and lines shorter than this many pixels are
+// drawn at most once per square of this size, and things closer than a
+// tile are drawn as tiles shaded by THING_DENSITY_LEVELS steps of count.
+#define VERTEX_MARKER_SPACING	4
+#define THING_TILE_SIZE			16
+#define THING_DENSITY_LEVELS	3
+
+struct SnapshotLine
+{
+	float x1;
+	float y1;
+	float x2;
+	float y2;
+	bool shared;
+};
+
+struct SnapshotThing
+{
+	float x;
+	float y;
+	uint8_t id;
+};
+
+struct Chunk;
+
+// Immutable copy of everything needed to draw one frame of the editor. It is
+// built by the thread that owns the CMap and handed to the render thread.
+class CMapSnapshot
+{
+public:
+	CMapSnapshot(CMap &map, const CGrid &grid, int mode, float scale);
+
+	void Render(SDL_Renderer *renderer, CSpriteAtlas *spriteAtlas = nullptr) const;
+
+	void SetDrawingLine(float x1, float y1, float x2, float y2);
+	void SetHighlight(const std::vector<Vertex> &points, bool closed);
+	void SetSelectedLines(const std::vector<SnapshotLine> &lines) { m_selectedLines = lines; }
+	void SetSelectionBox(float x1, float y1, float x2, float y2);
+	void SetChunks(const std::vector<std::shared_ptr<const Chunk>> &chunks) { m_chunks = chunks; }
+
+	const CGrid &GetGrid() const { return m_grid; }
+	const bspheaderex_t &GetHeader() const { return m_header; }
+	unsigned char GetBlock(int x, int y) const { return ((x >= 0 && y >= 0 && x < 32 && y < 32) ? m_blockMap[y * 32 + x] : (unsigned char)BLOCK_SOLID); }
+	void GetPlayerStart(float &x, float &y, float &angle) const { x = m_playerX; y = m_playerY; angle = m_playerAngle; }
+	unsigned int GetIssueCount() const { return m_issueCount; }
+	void SetIssueCount(unsigned int issueCount) { m_issueCount = issueCount; }
+	int GetMode() const { return m_mode; }
+
+	// Sorted without duplicates.
+	const std::vector<unsigned int> &GetWallTextures() const { return m_wallTextures; }
+	const std::vector<unsigned int> &GetThingIds() const { return m_thingIds; }
+	float GetScale() const { return m_scale; }
+
+private:
+	void RenderLines(SDL_Renderer *renderer, const std::vector<SnapshotLine> &lines, Uint8 brightness) const;
+	void RenderChunks(SDL_Renderer *renderer) const;
+	void RenderThings(SDL_Renderer *renderer, CSpriteAtlas *spriteAtlas) const;
+	void AggregateThings(std::vector<const SnapshotThing *> &things, std::vector<SDL_Rect> *tiles) const;
+
+	CGrid m_grid;
+	int m_mode;
+	float m_scale;
+	unsigned int m_issueCount;
+	std::vector<SnapshotLine> m_lines;
+	std::vector<Vertex> m_vertices;
+	std::vector<SnapshotThing> m_things;
+	std::vector<unsigned int> m_wallTextures;
+	std::vector<unsigned int> m_thingIds;
+	bspheaderex_t m_header;
+	unsigned char m_blockMap[32 * 32];
+	float m_playerX;
+	float m_playerY;
+	float m_playerAngle;
+	bool m_drawing;
+	SnapshotLine m_drawingLine;
+	std::vector<Vertex> m_highlightPoints;
+	bool m_highlightClosed;
+	std::vector<SnapshotLine> m_selectedLines;
+	bool m_boxSelecting;
+	SnapshotLine m_selectionBox;
+	std::vector<std::shared_ptr<const Chunk>> m_chunks;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#include "CMapTab.h"
+
+using namespace std;
+
+CMapTab::CMapTab(int width, int height, CThreadPool &pool, const shared_ptr<CGameData> &gameData) : m_validator(pool), m_editor(width, height), m_commands(1024), m_gameData(gameData)
+{
+	m_validator.AddDefaultChecks();
+	m_editor.SetValidator(&m_validator);
+}
+
+CMapTab::~CMapTab()
+{
+	m_editor.Stop();
+
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void CMapTab::Open(const char *filename, CChunkPager *pager, int originX, int originY)
+{
+	if (filename != nullptr)
+		m_filename = filename;
+
+	if (pager != nullptr)
+		m_editor.SetChunkPager(pager, originX, originY);
+
+	m_gameData->ReadMap(filename, m_editor.GetMap());
+
+	// Autosaves go next to the map, never over it.
+	m_editor.SetAutosave(&m_autosave, (filename != nullptr ? m_filename : string("untitled.bsp")) + ".autosave");
+	m_editor.PublishSnapshot();
+
+	m_thread = thread(&CEditor::Run, &m_editor, ref(m_commands));
+}
+
+void CMapTab::Render(SDL_Renderer *renderer)
+{
+	m_layerCache.Render(renderer, m_editor.GetSnapshot(), m_gameData->GetSpriteAtlas());
+}
\ No newline at end of file
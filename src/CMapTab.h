@@ -0,0 +1,68 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#ifndef __CMAPTAB_H__
+#define __CMAPTAB_H__
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "SDL.h"
+
+#include "CAutosave.h"
+#include "CChunkPager.h"
+#include "CCommandQueue.h"
+#include "CEditor.h"
+#include "CGameData.h"
+#include "CLayerCache.h"
+#include "CThreadPool.h"
+#include "CValidator.h"
+
+// One open map: its editor, the thread the editor runs on, its validation
+// state and the cached rendering of its view. Tabs share the game data and
+// the thread pool, and everything else is their own.
+class CMapTab
+{
+public:
+	CMapTab(int width, int height, CThreadPool &pool, const std::shared_ptr<CGameData> &gameData);
+	~CMapTab();
+
+	// Reads the map and starts the editor thread. pager may be null.
+	void Open(const char *filename, CChunkPager *pager = nullptr, int originX = 0, int originY = 0);
+
+	bool Push(const Command &command) { return m_commands.Push(command); }
+	void Render(SDL_Renderer *renderer);
+	void Invalidate() { m_layerCache.Invalidate(); }
+
+	std::shared_ptr<const CMapSnapshot> GetSnapshot() const { return m_editor.GetSnapshot(); }
+	std::shared_ptr<const CMapVersion> GetVersion() const { return m_editor.GetVersion(); }
+	const std::string &GetFilename() const { return m_filename; }
+	bool IsRunning() const { return m_editor.IsRunning(); }
+
+private:
+	CMapTab(const CMapTab &) = delete;
+	CMapTab &operator=(const CMapTab &) = delete;
+
+	CValidator m_validator;
+	CEditor m_editor;
+	CCommandQueue<Command> m_commands;
+	std::thread m_thread;
+	CLayerCache m_layerCache;
+	CAutosave m_autosave;
+	std::shared_ptr<CGameData> m_gameData;
+	std::string m_filename;
+};
+
+#endif
\ No newline at end of file
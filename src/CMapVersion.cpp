@@ -0,0 +1,197 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#include <algorithm>
+
+#include "CHash.h"
+#include "CMapVersion.h"
+
+using namespace std;
+
+CMapVersion::CMapVersion(CMap &map) : m_revision(map.GetRevision()), m_header(map.GetHeader())
+{
+	vector<pair<size_t, VersionLine>> lines;
+	vector<pair<size_t, VersionSector>> sectors;
+	vector<pair<size_t, VersionThing>> things;
+
+	// Shared lines are reached twice and simply captured again.
+	for (CNode<Line> *currentLine = map.GetLines()->Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+	{
+		lines.push_back({ currentLine->GetData()->handle, VersionLine() });
+		CaptureLine(map, currentLine->GetData()->handle, currentLine->GetData(), lines.back().second);
+	}
+
+	for (CNode<Sector> *currentSector = map.GetSectors()->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+	{
+		sectors.push_back({ currentSector->GetData()->handle, VersionSector() });
+		CaptureSector(currentSector->GetData(), sectors.back().second);
+	}
+
+	for (CNode<Thing> *currentThing = map.GetThings()->Head(); currentThing->GetData() != nullptr; currentThing = currentThing->Next())
+	{
+		things.push_back({ currentThing->GetData()->handle, VersionThing() });
+		CaptureThing(map, currentThing->GetData()->handle, currentThing->GetData(), things.back().second);
+	}
+
+	m_lines = m_lines.Update(lines);
+	m_sectors = m_sectors.Update(sectors);
+	m_things = m_things.Update(things);
+}
+
+static vector<unsigned int> UniqueHandles(vector<unsigned int> handles)
+{
+	sort(handles.begin(), handles.end());
+	handles.erase(unique(handles.begin(), handles.end()), handles.end());
+
+	return handles;
+}
+
+CMapVersion::CMapVersion(const CMapVersion &previous, const CMap &map, const DirtyHandles &dirty) : m_revision(map.GetRevision()), m_header(map.GetHeader())
+{
+	vector<pair<size_t, VersionLine>> lines;
+	vector<pair<size_t, VersionSector>> sectors;
+	vector<pair<size_t, VersionThing>> things;
+
+	for (unsigned int handle : UniqueHandles(dirty.lines))
+	{
+		lines.push_back({ handle, previous.m_lines[handle] });
+		CaptureLine(map, handle, map.GetLine(handle), lines.back().second);
+	}
+
+	for (unsigned int handle : UniqueHandles(dirty.sectors))
+	{
+		sectors.push_back({ handle, VersionSector() });
+		CaptureSector(map.GetSector(handle), sectors.back().second);
+	}
+
+	for (unsigned int handle : UniqueHandles(dirty.things))
+	{
+		things.push_back({ handle, previous.m_things[handle] });
+		CaptureThing(map, handle, map.GetThing(handle), things.back().second);
+	}
+
+	m_lines = previous.m_lines.Update(lines);
+	m_sectors = previous.m_sectors.Update(sectors);
+	m_things = previous.m_things.Update(things);
+}
+
+void CMapVersion::CaptureLine(const CMap &map, unsigned int handle, const Line *line, VersionLine &versionLine)
+{
+	versionLine.texture = map.GetLineTexture(handle);
+	versionLine.flags = map.GetLineFlags(handle);
+	versionLine.source = map.GetLineSource(handle);
+
+	if (line == nullptr)
+		return;
+
+	versionLine.vertex1 = *line->vertex1->GetData();
+	versionLine.vertex2 = *line->vertex2->GetData();
+
+	for (unsigned int i = 0; i < 2; i++)
+		versionLine.sectors[i] = (line->sectors[i] != nullptr ? line->sectors[i]->handle : INVALID_HANDLE);
+}
+
+void CMapVersion::CaptureSector(const Sector *sector, VersionSector &versionSector)
+{
+	if (sector == nullptr)
+		return;
+
+	versionSector.minX = sector->minX;
+	versionSector.minY = sector->minY;
+	versionSector.maxX = sector->maxX;
+	versionSector.maxY = sector->maxY;
+	versionSector.floorTexture = sector->floorTexture;
+	versionSector.ceilingTexture = sector->ceilingTexture;
+
+	shared_ptr<vector<Vertex>> outline = make_shared<vector<Vertex>>();
+	outline->reserve(sector->vertexCount);
+
+	CNode<Vertex> *currentVertex = sector->firstVertex;
+
+	for (unsigned int vertexCount = sector->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+		outline->push_back(*currentVertex->GetData());
+
+	versionSector.outline = outline;
+}
+
+void CMapVersion::CaptureThing(const CMap &map, unsigned int handle, const Thing *thing, VersionThing &versionThing)
+{
+	versionThing.id = map.GetThingId(handle);
+	versionThing.flags = map.GetThingFlags(handle);
+	versionThing.used = (thing != nullptr);
+
+	if (thing == nullptr)
+		return;
+
+	versionThing.x = thing->x;
+	versionThing.y = thing->y;
+}
+
+uint64_t CMapVersion::Hash() const
+{
+	CHash hash;
+	hash.AddValue(m_header);
+
+	// Fields are hashed one at a time to leave out padding.
+	for (unsigned int handle = 0; handle < GetLineHandleCount(); handle++)
+	{
+		const VersionLine &line = m_lines[handle];
+
+		if (line.source == LINE_SOURCE_FREE)
+			continue;
+
+		hash.AddValue(handle);
+		hash.AddValue(line.vertex1.x);
+		hash.AddValue(line.vertex1.y);
+		hash.AddValue(line.vertex2.x);
+		hash.AddValue(line.vertex2.y);
+		hash.AddValue(line.texture);
+		hash.AddValue(line.flags);
+		hash.AddValue(line.source);
+	}
+
+	for (unsigned int handle = 0; handle < GetSectorHandleCount(); handle++)
+	{
+		const VersionSector &sector = m_sectors[handle];
+
+		if (sector.outline == nullptr)
+			continue;
+
+		hash.AddValue(handle);
+		hash.AddValue(sector.floorTexture);
+		hash.AddValue(sector.ceilingTexture);
+
+		for (const Vertex &vertex : *sector.outline)
+		{
+			hash.AddValue(vertex.x);
+			hash.AddValue(vertex.y);
+		}
+	}
+
+	for (unsigned int handle = 0; handle < GetThingHandleCount(); handle++)
+	{
+		const VersionThing &thing = m_things[handle];
+
+		if (!thing.used)
+			continue;
+
+		hash.AddValue(handle);
+		hash.AddValue(thing.x);
+		hash.AddValue(thing.y);
+		hash.AddValue(thing.id);
+		hash.AddValue(thing.flags);
+	}
+
+	return hash.GetValue();
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#ifndef __CMAPVERSION_H__
+#define __CMAPVERSION_H__
+
+#include <memory>
+#include <vector>
+
+#include "CMap.h"
+#include "CPersistentArray.h"
+
+// source is LINE_SOURCE_FREE for handles not in use. sectors are handles,
+// INVALID_HANDLE where the line has no sector on that side.
+struct VersionLine
+{
+	Vertex vertex1;
+	Vertex vertex2;
+	unsigned int sectors[2];
+	uint16_t texture;
+	uint16_t flags;
+	LineSource source;
+};
+
+// outline is nullptr for handles not in use. Outlines are only replaced
+// when their sector is marked dirty, so versions share the rest.
+struct VersionSector
+{
+	int32_t minX;
+	int32_t minY;
+	int32_t maxX;
+	int32_t maxY;
+	unsigned char floorTexture;
+	unsigned char ceilingTexture;
+	std::shared_ptr<const std::vector<Vertex>> outline;
+};
+
+// used is false for handles with no thing in the map.
+struct VersionThing
+{
+	int32_t x;
+	int32_t y;
+	uint8_t id;
+	uint16_t flags;
+	bool used;
+};
+
+// Lines, sectors and things of the map at one revision, indexed by handle.
+// Each version is built from the one before it and the handles marked dirty
+// since, sharing the storage of every element that did not change, so one
+// can be made after every edit. Versions are never modified and can be held
+// and read on any thread while editing goes on.
+class CMapVersion
+{
+public:
+	CMapVersion(CMap &map);
+	CMapVersion(const CMapVersion &previous, const CMap &map, const DirtyHandles &dirty);
+
+	unsigned int GetRevision() const { return m_revision; }
+	const bspheaderex_t &GetHeader() const { return m_header; }
+
+	// Handles are below these counts.
+	unsigned int GetLineHandleCount() const { return (unsigned int)m_lines.GetSize(); }
+	unsigned int GetSectorHandleCount() const { return (unsigned int)m_sectors.GetSize(); }
+	unsigned int GetThingHandleCount() const { return (unsigned int)m_things.GetSize(); }
+
+	const VersionLine &GetLine(unsigned int handle) const { return m_lines[handle]; }
+	const VersionSector &GetSector(unsigned int handle) const { return m_sectors[handle]; }
+	const VersionThing &GetThing(unsigned int handle) const { return m_things[handle]; }
+
+	// Hash of the header and every element in use.
+	uint64_t Hash() const;
+
+private:
+	static void CaptureLine(const CMap &map, unsigned int handle, const Line *line, VersionLine &versionLine);
+	static void CaptureSector(const Sector *sector, VersionSector &versionSector);
+	static void CaptureThing(const CMap &map, unsigned int handle, const Thing *thing, VersionThing &versionThing);
+
+	CPersistentArray<VersionLine> m_lines;
+	CPersistentArray<VersionSector> m_sectors;
+	CPersistentArray<VersionThing> m_things;
+	unsigned int m_revision;
+	bspheaderex_t m_header;
+};
+
+#endif
\ No newline at end of file
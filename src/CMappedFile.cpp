@@ -0,0 +1,109 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "CMappedFile.h"
+
+CMappedFile::CMappedFile() : m_data(nullptr), m_size(0)
+{
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = nullptr;
+#endif
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+bool CMappedFile::Open(const char *filename)
+{
+	Close();
+
+#ifdef _WIN32
+	m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (m_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+
+	if (GetFileSizeEx(m_file, &size) && size.QuadPart > 0)
+	{
+		m_size = size_t(size.QuadPart);
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (m_mapping != nullptr)
+			m_data = (const uint8_t *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	int file = open(filename, O_RDONLY);
+
+	if (file < 0)
+		return false;
+
+	struct stat status;
+
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		m_size = size_t(status.st_size);
+		void *data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, file, 0);
+
+		if (data != MAP_FAILED)
+			m_data = (const uint8_t *)data;
+	}
+
+	// The mapping keeps its own reference to the file.
+	close(file);
+#endif
+
+	if (m_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void CMappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_data != nullptr)
+		UnmapViewOfFile(m_data);
+
+	if (m_mapping != nullptr)
+		CloseHandle(m_mapping);
+
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = nullptr;
+#else
+	if (m_data != nullptr)
+		munmap((void *)m_data, m_size);
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
\ No newline at end of file
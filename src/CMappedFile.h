@@ -0,0 +1,47 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CMAPPEDFILE_H__
+#define __CMAPPEDFILE_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// A whole file mapped read-only into memory. Pages are read in by the
+// system as they are touched.
+class CMappedFile
+{
+public:
+	CMappedFile();
+	~CMappedFile();
+
+	bool Open(const char *filename);
+	void Close();
+	bool IsOpen() const { return m_data != nullptr; }
+
+	const uint8_t *GetData() const { return m_data; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	CMappedFile(const CMappedFile &) = delete;
+	CMappedFile &operator=(const CMappedFile &) = delete;
+
+	const uint8_t *m_data;
+	size_t m_size;
+#ifdef _WIN32
+	void *m_file;
+	void *m_mapping;
+#endif
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,141 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#ifndef __CPERSISTENTARRAY_H__
+#define __CPERSISTENTARRAY_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#define PERSISTENT_ARRAY_BITS	5
+
+// Immutable array stored as a tree of fixed size nodes. Update returns a
+// new array that shares every node the update does not touch, so it costs
+// time and memory in proportion to the number of elements changed. Arrays
+// can be read from any number of threads, since no node is ever written
+// once the Update that created it has returned.
+template <class T>
+class CPersistentArray
+{
+public:
+	CPersistentArray() : m_size(0), m_levels(0) {}
+
+	size_t GetSize() const { return m_size; }
+
+	// Elements that were never set read as T().
+	const T &operator[](size_t index) const
+	{
+		static const T empty = T();
+
+		if (index >= m_size)
+			return empty;
+
+		const Node *node = m_root.get();
+
+		for (unsigned int level = m_levels; level > 0 && node != nullptr; level--)
+			node = static_cast<const Branch *>(node)->children[(index >> (level * PERSISTENT_ARRAY_BITS)) & MASK].get();
+
+		if (node == nullptr)
+			return empty;
+
+		return static_cast<const Leaf *>(node)->values[index & MASK];
+	}
+
+	// Later updates to the same index win. Nodes copied by an earlier update
+	// in the same call are written in place.
+	CPersistentArray Update(const std::vector<std::pair<size_t, T>> &updates) const
+	{
+		static std::atomic<uint64_t> nextGeneration(0);
+
+		CPersistentArray array(*this);
+		uint64_t generation = ++nextGeneration;
+
+		for (const std::pair<size_t, T> &update : updates)
+		{
+			size_t index = update.first;
+
+			while ((index >> (array.m_levels * PERSISTENT_ARRAY_BITS)) > MASK)
+			{
+				std::shared_ptr<Branch> branch = std::make_shared<Branch>();
+				branch->generation = generation;
+				branch->children[0] = array.m_root;
+				array.m_root = branch;
+				array.m_levels++;
+			}
+
+			std::shared_ptr<Node> *node = &array.m_root;
+
+			for (unsigned int level = array.m_levels; ; level--)
+			{
+				if (*node == nullptr || (*node)->generation != generation)
+					*node = Copy(node->get(), level, generation);
+
+				if (level == 0)
+					break;
+
+				node = &static_cast<Branch *>(node->get())->children[(index >> (level * PERSISTENT_ARRAY_BITS)) & MASK];
+			}
+
+			static_cast<Leaf *>(node->get())->values[index & MASK] = update.second;
+
+			if (index >= array.m_size)
+				array.m_size = index + 1;
+		}
+
+		return array;
+	}
+
+private:
+	static const size_t WIDTH = size_t(1) << PERSISTENT_ARRAY_BITS;
+	static const size_t MASK = WIDTH - 1;
+
+	// Only the Update call whose generation matches may write to a node.
+	struct Node
+	{
+		uint64_t generation;
+	};
+
+	struct Leaf : Node
+	{
+		T values[WIDTH];
+	};
+
+	struct Branch : Node
+	{
+		std::shared_ptr<Node> children[WIDTH];
+	};
+
+	static std::shared_ptr<Node> Copy(const Node *node, unsigned int level, uint64_t generation)
+	{
+		std::shared_ptr<Node> copy;
+
+		if (level == 0)
+			copy = (node != nullptr ? std::make_shared<Leaf>(*static_cast<const Leaf *>(node)) : std::make_shared<Leaf>());
+		else
+			copy = (node != nullptr ? std::make_shared<Branch>(*static_cast<const Branch *>(node)) : std::make_shared<Branch>());
+
+		copy->generation = generation;
+
+		return copy;
+	}
+
+	std::shared_ptr<Node> m_root;
+	size_t m_size;
+	unsigned int m_levels;
+};
+
+#endif
\ No newline at end of file
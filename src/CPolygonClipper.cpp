@@ -0,0 +1,456 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "CPolygonClipper.h"
+
+using namespace std;
+
+// Points closer than this are the same point. Map coordinates are whole
+// units, so this is far below anything that can be drawn.
+#define CLIP_EPSILON	(1.0 / 512.0)
+
+static uint64_t GetPointKey(int64_t x, int64_t y)
+{
+	return (uint64_t(x) << 32) ^ uint32_t(y);
+}
+
+static uint64_t GetEdgeKey(unsigned int point1, unsigned int point2)
+{
+	return (uint64_t(point1) << 32) | point2;
+}
+
+void CPolygonClipper::Clip(const vector<ClipLoop> &subject, const vector<ClipLoop> &clip, ClipOperation operation, vector<ClipLoop> &result)
+{
+	vector<Edge> edges[2];
+	vector<vector<Split>> splits[2];
+	vector<Edge> pieces[2];
+	unordered_map<uint64_t, bool> pieceKeys[2];
+	vector<Edge> kept;
+
+	m_points.clear();
+	m_pointIndex.clear();
+	result.clear();
+
+	AddEdges(subject, edges[0], splits[0]);
+	AddEdges(clip, edges[1], splits[1]);
+	IntersectEdges(edges[0], splits[0], edges[1], splits[1]);
+
+	for (int region = 0; region < 2; region++)
+	{
+		SplitEdges(edges[region], splits[region], pieces[region]);
+
+		for (const Edge &piece : pieces[region])
+			pieceKeys[region][GetEdgeKey(piece.point1, piece.point2)] = true;
+	}
+
+	for (const Edge &piece : pieces[0])
+	{
+		EdgeClass edgeClass = ClassifyEdge(piece, clip, pieceKeys[1]);
+
+		if ((operation == CLIP_UNION && (edgeClass == EDGE_OUTSIDE || edgeClass == EDGE_SHARED_SAME)) ||
+			(operation == CLIP_INTERSECTION && (edgeClass == EDGE_INSIDE || edgeClass == EDGE_SHARED_SAME)) ||
+			(operation == CLIP_DIFFERENCE && (edgeClass == EDGE_OUTSIDE || edgeClass == EDGE_SHARED_OPPOSITE)))
+			kept.push_back(piece);
+	}
+
+	// Shared pieces were already taken from the subject.
+	for (const Edge &piece : pieces[1])
+	{
+		EdgeClass edgeClass = ClassifyEdge(piece, subject, pieceKeys[0]);
+
+		if (operation == CLIP_UNION && edgeClass == EDGE_OUTSIDE)
+			kept.push_back(piece);
+		else if (operation == CLIP_INTERSECTION && edgeClass == EDGE_INSIDE)
+			kept.push_back(piece);
+		else if (operation == CLIP_DIFFERENCE && edgeClass == EDGE_INSIDE)
+			kept.push_back({ piece.point2, piece.point1, piece.polygon, piece.edge });
+	}
+
+	ChainEdges(kept, result);
+}
+
+void CPolygonClipper::SplitHoles(vector<ClipLoop> &loops)
+{
+	vector<vector<ClipLoop>> regions(1, loops);
+
+	loops.clear();
+
+	while (!regions.empty())
+	{
+		vector<ClipLoop> region = regions.back();
+		regions.pop_back();
+
+		const ClipLoop *hole = nullptr;
+
+		for (const ClipLoop &loop : region)
+		{
+			if (GetArea(loop) < 0.0)
+			{
+				hole = &loop;
+				break;
+			}
+		}
+
+		if (hole == nullptr)
+		{
+			loops.insert(loops.end(), region.begin(), region.end());
+			continue;
+		}
+
+		double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX;
+		double holeMinX = DBL_MAX, holeMaxX = -DBL_MAX;
+
+		for (const ClipLoop &loop : region)
+		{
+			for (const ClipVertex &vertex : loop)
+			{
+				minX = min(minX, vertex.x);
+				minY = min(minY, vertex.y);
+				maxX = max(maxX, vertex.x);
+				maxY = max(maxY, vertex.y);
+			}
+		}
+
+		for (const ClipVertex &vertex : *hole)
+		{
+			holeMinX = min(holeMinX, vertex.x);
+			holeMaxX = max(holeMaxX, vertex.x);
+		}
+
+		// A hole too thin to cut through is dropped.
+		if (holeMaxX - holeMinX <= CLIP_EPSILON * 2.0)
+		{
+			region.erase(region.begin() + (hole - region.data()));
+			regions.push_back(region);
+			continue;
+		}
+
+		// The cut runs through the middle of the hole, which turns the hole
+		// into a notch in both halves.
+		double cutX = (holeMinX + holeMaxX) * 0.5;
+		minX -= 1.0, minY -= 1.0, maxX += 1.0, maxY += 1.0;
+
+		vector<ClipLoop> halves[2] = {
+			{ { { minX, minY, -1, 0 }, { cutX, minY, -1, 1 }, { cutX, maxY, -1, 2 }, { minX, maxY, -1, 3 } } },
+			{ { { cutX, minY, -1, 4 }, { maxX, minY, -1, 5 }, { maxX, maxY, -1, 6 }, { cutX, maxY, -1, 7 } } }
+		};
+
+		for (const vector<ClipLoop> &half : halves)
+		{
+			vector<ClipLoop> part;
+			Clip(region, half, CLIP_INTERSECTION, part);
+
+			if (!part.empty())
+				regions.push_back(part);
+		}
+	}
+}
+
+double CPolygonClipper::GetArea(const ClipLoop &loop)
+{
+	double area = 0.0;
+
+	for (size_t i = 0, j = loop.size() - 1; i < loop.size(); j = i++)
+		area += loop[j].x * loop[i].y - loop[i].x * loop[j].y;
+
+	return area * 0.5;
+}
+
+unsigned int CPolygonClipper::AddPoint(double x, double y)
+{
+	int64_t keyX = llround(x / CLIP_EPSILON), keyY = llround(y / CLIP_EPSILON);
+
+	// A point near a bucket edge may have been added to the neighbouring
+	// bucket.
+	for (int64_t offsetY = -1; offsetY <= 1; offsetY++)
+	{
+		for (int64_t offsetX = -1; offsetX <= 1; offsetX++)
+		{
+			auto point = m_pointIndex.find(GetPointKey(keyX + offsetX, keyY + offsetY));
+
+			if (point != m_pointIndex.end() && fabs(m_points[point->second].x - x) <= CLIP_EPSILON && fabs(m_points[point->second].y - y) <= CLIP_EPSILON)
+				return point->second;
+		}
+	}
+
+	unsigned int index = (unsigned int)m_points.size();
+	m_points.push_back({ x, y });
+	m_pointIndex[GetPointKey(keyX, keyY)] = index;
+
+	return index;
+}
+
+void CPolygonClipper::AddEdges(const vector<ClipLoop> &loops, vector<Edge> &edges, vector<vector<Split>> &splits)
+{
+	for (const ClipLoop &loop : loops)
+	{
+		for (size_t i = 0; i < loop.size(); i++)
+		{
+			const ClipVertex &vertex1 = loop[i];
+			const ClipVertex &vertex2 = loop[(i + 1) % loop.size()];
+			unsigned int point1 = AddPoint(vertex1.x, vertex1.y);
+			unsigned int point2 = AddPoint(vertex2.x, vertex2.y);
+
+			if (point1 != point2)
+				edges.push_back({ point1, point2, vertex1.polygon, vertex1.edge });
+		}
+	}
+
+	splits.assign(edges.size(), vector<Split>());
+}
+
+void CPolygonClipper::IntersectEdges(vector<Edge> &edges1, vector<vector<Split>> &splits1, vector<Edge> &edges2, vector<vector<Split>> &splits2)
+{
+	vector<Edge> *edges[2] = { &edges1, &edges2 };
+	vector<vector<Split>> *splits[2] = { &splits1, &splits2 };
+	vector<pair<int, unsigned int>> order;
+	vector<unsigned int> active[2];
+
+	auto GetMinX = [&](int region, unsigned int index) { return min(m_points[(*edges[region])[index].point1].x, m_points[(*edges[region])[index].point2].x); };
+	auto GetMaxX = [&](int region, unsigned int index) { return max(m_points[(*edges[region])[index].point1].x, m_points[(*edges[region])[index].point2].x); };
+
+	// Splits edge at point if point lies inside it.
+	auto SplitAtPoint = [&](int region, unsigned int index, unsigned int point)
+	{
+		const Edge &edge = (*edges[region])[index];
+		const Point &point1 = m_points[edge.point1], &point2 = m_points[edge.point2], &p = m_points[point];
+
+		if (point == edge.point1 || point == edge.point2)
+			return;
+
+		double dx = point2.x - point1.x, dy = point2.y - point1.y;
+		double length = sqrt(dx * dx + dy * dy);
+		double distance = fabs(dx * (p.y - point1.y) - dy * (p.x - point1.x)) / length;
+		double t = (dx * (p.x - point1.x) + dy * (p.y - point1.y)) / (length * length);
+
+		if (distance <= CLIP_EPSILON && t * length > CLIP_EPSILON && (1.0 - t) * length > CLIP_EPSILON)
+			(*splits[region])[index].push_back({ t, point });
+	};
+
+	for (int region = 0; region < 2; region++)
+	{
+		for (unsigned int i = 0; i < edges[region]->size(); i++)
+			order.push_back({ region, i });
+	}
+
+	sort(order.begin(), order.end(), [&](const pair<int, unsigned int> &edge1, const pair<int, unsigned int> &edge2)
+	{
+		return GetMinX(edge1.first, edge1.second) < GetMinX(edge2.first, edge2.second);
+	});
+
+	for (const pair<int, unsigned int> &current : order)
+	{
+		int region = current.first, otherRegion = 1 - region;
+		double minX = GetMinX(region, current.second) - CLIP_EPSILON;
+
+		for (vector<unsigned int> &activeEdges : active)
+		{
+			activeEdges.erase(remove_if(activeEdges.begin(), activeEdges.end(), [&](unsigned int index)
+			{
+				return GetMaxX(int(&activeEdges - active), index) < minX;
+			}), activeEdges.end());
+		}
+
+		const Edge edge = (*edges[region])[current.second];
+		const Point &a1 = m_points[edge.point1], &a2 = m_points[edge.point2];
+
+		for (unsigned int otherIndex : active[otherRegion])
+		{
+			const Edge otherEdge = (*edges[otherRegion])[otherIndex];
+			const Point &b1 = m_points[otherEdge.point1], &b2 = m_points[otherEdge.point2];
+
+			if (max(a1.y, a2.y) < min(b1.y, b2.y) - CLIP_EPSILON || min(a1.y, a2.y) > max(b1.y, b2.y) + CLIP_EPSILON)
+				continue;
+
+			double dxA = a2.x - a1.x, dyA = a2.y - a1.y, lengthA = sqrt(dxA * dxA + dyA * dyA);
+			double dxB = b2.x - b1.x, dyB = b2.y - b1.y, lengthB = sqrt(dxB * dxB + dyB * dyB);
+			double side1 = (dxA * (b1.y - a1.y) - dyA * (b1.x - a1.x)) / lengthA;
+			double side2 = (dxA * (b2.y - a1.y) - dyA * (b2.x - a1.x)) / lengthA;
+			double side3 = (dxB * (a1.y - b1.y) - dyB * (a1.x - b1.x)) / lengthB;
+			double side4 = (dxB * (a2.y - b1.y) - dyB * (a2.x - b1.x)) / lengthB;
+
+			// End points lying on the other edge cover touching and
+			// overlapping edges. Only crossings well away from both edges'
+			// end points are left after that.
+			if (fabs(side1) <= CLIP_EPSILON || fabs(side2) <= CLIP_EPSILON || fabs(side3) <= CLIP_EPSILON || fabs(side4) <= CLIP_EPSILON)
+			{
+				if (fabs(side1) <= CLIP_EPSILON)
+					SplitAtPoint(region, current.second, otherEdge.point1);
+
+				if (fabs(side2) <= CLIP_EPSILON)
+					SplitAtPoint(region, current.second, otherEdge.point2);
+
+				if (fabs(side3) <= CLIP_EPSILON)
+					SplitAtPoint(otherRegion, otherIndex, edge.point1);
+
+				if (fabs(side4) <= CLIP_EPSILON)
+					SplitAtPoint(otherRegion, otherIndex, edge.point2);
+
+				continue;
+			}
+
+			if ((side1 > 0.0) == (side2 > 0.0) || (side3 > 0.0) == (side4 > 0.0))
+				continue;
+
+			double t = side3 / (side3 - side4);
+			unsigned int point = AddPoint(a1.x + dxA * t, a1.y + dyA * t);
+
+			SplitAtPoint(region, current.second, point);
+			SplitAtPoint(otherRegion, otherIndex, point);
+		}
+
+		active[region].push_back(current.second);
+	}
+}
+
+void CPolygonClipper::SplitEdges(const vector<Edge> &edges, vector<vector<Split>> &splits, vector<Edge> &pieces) const
+{
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		const Edge &edge = edges[i];
+		unsigned int point = edge.point1;
+
+		sort(splits[i].begin(), splits[i].end(), [](const Split &split1, const Split &split2) { return split1.t < split2.t; });
+
+		for (const Split &split : splits[i])
+		{
+			if (split.point == point)
+				continue;
+
+			pieces.push_back({ point, split.point, edge.polygon, edge.edge });
+			point = split.point;
+		}
+
+		if (point != edge.point2)
+			pieces.push_back({ point, edge.point2, edge.polygon, edge.edge });
+	}
+}
+
+CPolygonClipper::EdgeClass CPolygonClipper::ClassifyEdge(const Edge &edge, const vector<ClipLoop> &region, const unordered_map<uint64_t, bool> &otherEdges) const
+{
+	if (otherEdges.count(GetEdgeKey(edge.point1, edge.point2)) != 0)
+		return EDGE_SHARED_SAME;
+
+	if (otherEdges.count(GetEdgeKey(edge.point2, edge.point1)) != 0)
+		return EDGE_SHARED_OPPOSITE;
+
+	const Point &point1 = m_points[edge.point1], &point2 = m_points[edge.point2];
+
+	return (RegionContainsPoint(region, (point1.x + point2.x) * 0.5, (point1.y + point2.y) * 0.5) ? EDGE_INSIDE : EDGE_OUTSIDE);
+}
+
+void CPolygonClipper::ChainEdges(const vector<Edge> &edges, vector<ClipLoop> &result) const
+{
+	vector<vector<unsigned int>> outgoing(m_points.size());
+	vector<bool> used(edges.size(), false);
+
+	for (unsigned int i = 0; i < edges.size(); i++)
+		outgoing[edges[i].point1].push_back(i);
+
+	for (unsigned int start = 0; start < edges.size(); start++)
+	{
+		if (used[start])
+			continue;
+
+		ClipLoop loop;
+		unsigned int current = start;
+		bool closed = false;
+
+		for (;;)
+		{
+			const Edge &edge = edges[current];
+			const Point &point1 = m_points[edge.point1], &point2 = m_points[edge.point2];
+			double dx = point2.x - point1.x, dy = point2.y - point1.y;
+			unsigned int next = UINT32_MAX;
+			double bestTurn = -DBL_MAX;
+
+			used[current] = true;
+			loop.push_back({ point1.x, point1.y, edge.polygon, edge.edge });
+
+			// Where several loops touch at a point, taking the sharpest left
+			// turn keeps each loop around its own area.
+			for (unsigned int candidate : outgoing[edge.point2])
+			{
+				if (used[candidate] && candidate != start)
+					continue;
+
+				const Point &point3 = m_points[edges[candidate].point2];
+				double nextX = point3.x - point2.x, nextY = point3.y - point2.y;
+				double turn = atan2(dx * nextY - dy * nextX, dx * nextX + dy * nextY);
+
+				if (turn > bestTurn)
+				{
+					bestTurn = turn;
+					next = candidate;
+				}
+			}
+
+			if (next == UINT32_MAX)
+				break;
+
+			if (next == start)
+			{
+				closed = true;
+				break;
+			}
+
+			current = next;
+		}
+
+		if (!closed)
+			continue;
+
+		// Pieces of the same input edge that follow each other are joined
+		// back into one edge.
+		ClipLoop merged;
+
+		for (size_t i = 0; i < loop.size(); i++)
+		{
+			const ClipVertex &previous = loop[(i + loop.size() - 1) % loop.size()];
+
+			if (previous.polygon != loop[i].polygon || previous.edge != loop[i].edge)
+				merged.push_back(loop[i]);
+		}
+
+		if (merged.size() >= 3 && fabs(GetArea(merged)) > CLIP_EPSILON)
+			result.push_back(merged);
+	}
+}
+
+bool CPolygonClipper::RegionContainsPoint(const vector<ClipLoop> &region, double x, double y)
+{
+	int winding = 0;
+
+	for (const ClipLoop &loop : region)
+	{
+		for (size_t i = 0, j = loop.size() - 1; i < loop.size(); j = i++)
+		{
+			const ClipVertex &vertex1 = loop[j], &vertex2 = loop[i];
+			double side = (vertex2.x - vertex1.x) * (y - vertex1.y) - (vertex2.y - vertex1.y) * (x - vertex1.x);
+
+			if (vertex1.y <= y)
+			{
+				if (vertex2.y > y && side > 0.0)
+					winding++;
+			}
+			else if (vertex2.y <= y && side < 0.0)
+				winding--;
+		}
+	}
+
+	return (winding != 0);
+}
\ No newline at end of file
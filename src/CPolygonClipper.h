@@ -0,0 +1,102 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CPOLYGONCLIPPER_H__
+#define __CPOLYGONCLIPPER_H__
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+enum ClipOperation
+{
+	CLIP_UNION,
+	CLIP_INTERSECTION,
+	CLIP_DIFFERENCE
+};
+
+// polygon and edge tag the edge that leaves this vertex and are copied to
+// every result edge that lies on it, so that callers can carry line
+// attributes through. Each edge needs its own tag, since result edges that
+// follow each other with the same tag are joined into one.
+struct ClipVertex
+{
+	double x;
+	double y;
+	int polygon;
+	unsigned int edge;
+};
+
+typedef std::vector<ClipVertex> ClipLoop;
+
+// Boolean operations on regions bounded by closed loops. Outer loops wind
+// with positive area (the same order as a clockwise sector) and holes with
+// negative area. Every edge is split where it meets the other region,
+// the pieces are classified as inside, outside or shared by testing their
+// midpoints, and the kept pieces are chained back into loops. Nothing
+// depends on walking a single intersection list, so touching and
+// overlapping edges need no special cases.
+class CPolygonClipper
+{
+public:
+	void Clip(const std::vector<ClipLoop> &subject, const std::vector<ClipLoop> &clip, ClipOperation operation, std::vector<ClipLoop> &result);
+
+	// Sectors cannot have holes, so each hole is cut in two by a vertical
+	// line through it. The cut edges are tagged with polygon -1.
+	void SplitHoles(std::vector<ClipLoop> &loops);
+
+	static double GetArea(const ClipLoop &loop);
+
+private:
+	enum EdgeClass
+	{
+		EDGE_INSIDE,
+		EDGE_OUTSIDE,
+		EDGE_SHARED_SAME,
+		EDGE_SHARED_OPPOSITE
+	};
+
+	struct Edge
+	{
+		unsigned int point1;
+		unsigned int point2;
+		int polygon;
+		unsigned int edge;
+	};
+
+	struct Split
+	{
+		double t;
+		unsigned int point;
+	};
+
+	unsigned int AddPoint(double x, double y);
+	void AddEdges(const std::vector<ClipLoop> &loops, std::vector<Edge> &edges, std::vector<std::vector<Split>> &splits);
+	void IntersectEdges(std::vector<Edge> &edges1, std::vector<std::vector<Split>> &splits1, std::vector<Edge> &edges2, std::vector<std::vector<Split>> &splits2);
+	void SplitEdges(const std::vector<Edge> &edges, std::vector<std::vector<Split>> &splits, std::vector<Edge> &pieces) const;
+	EdgeClass ClassifyEdge(const Edge &edge, const std::vector<ClipLoop> &region, const std::unordered_map<uint64_t, bool> &otherEdges) const;
+	void ChainEdges(const std::vector<Edge> &edges, std::vector<ClipLoop> &result) const;
+
+	static bool RegionContainsPoint(const std::vector<ClipLoop> &region, double x, double y);
+
+	struct Point
+	{
+		double x;
+		double y;
+	};
+
+	std::vector<Point> m_points;
+	std::unordered_map<uint64_t, unsigned int> m_pointIndex;
+};
+
+#endif
\ No newline at end of file
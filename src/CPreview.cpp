@@ -0,0 +1,154 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <cmath>
+#include <string>
+
+#include "CPreview.h"
+
+using namespace std;
+
+void CPreview::Open(const CMapSnapshot &snapshot)
+{
+	if (IsOpen())
+		return;
+
+	m_window = SDL_CreateWindow("Doom RPG Edit - Preview", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, m_width, m_height, 0);
+	m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED);
+	m_texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, m_width, m_height);
+	m_windowID = SDL_GetWindowID(m_window);
+
+	snapshot.GetPlayerStart(m_camera.x, m_camera.y, m_camera.angle);
+
+	m_frameTicks = SDL_GetTicks();
+	m_frameCount = 0;
+}
+
+void CPreview::Close()
+{
+	if (!IsOpen())
+		return;
+
+	SDL_DestroyTexture(m_texture);
+	SDL_DestroyRenderer(m_renderer);
+	SDL_DestroyWindow(m_window);
+
+	m_texture = nullptr;
+	m_renderer = nullptr;
+	m_window = nullptr;
+	m_windowID = 0;
+}
+
+bool CPreview::HandleEvent(const SDL_Event &event, const CMapSnapshot &snapshot)
+{
+	if (!IsOpen())
+		return false;
+
+	switch (event.type)
+	{
+	case SDL_KEYDOWN:
+		if (event.key.windowID != m_windowID)
+			return false;
+
+		switch (event.key.keysym.sym)
+		{
+		case SDLK_ESCAPE:
+			Close();
+			break;
+		case SDLK_UP:
+		case SDLK_w:
+			MoveCamera(snapshot, 16.0f);
+			break;
+		case SDLK_DOWN:
+		case SDLK_s:
+			MoveCamera(snapshot, -16.0f);
+			break;
+		case SDLK_LEFT:
+		case SDLK_a:
+			m_camera.angle += 0.1f;
+			break;
+		case SDLK_RIGHT:
+		case SDLK_d:
+			m_camera.angle -= 0.1f;
+			break;
+		case SDLK_HOME:
+			snapshot.GetPlayerStart(m_camera.x, m_camera.y, m_camera.angle);
+			break;
+		default:
+			break;
+		}
+
+		return true;
+	case SDL_KEYUP:
+		return (event.key.windowID == m_windowID);
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+		return (event.button.windowID == m_windowID);
+	case SDL_MOUSEMOTION:
+		return (event.motion.windowID == m_windowID);
+	case SDL_MOUSEWHEEL:
+		return (event.wheel.windowID == m_windowID);
+	case SDL_WINDOWEVENT:
+		if (event.window.windowID != m_windowID)
+			return false;
+
+		if (event.window.event == SDL_WINDOWEVENT_CLOSE)
+			Close();
+
+		return true;
+	default:
+		return false;
+	}
+}
+
+void CPreview::Render(const CMapSnapshot &snapshot)
+{
+	if (!IsOpen())
+		return;
+
+	void *pixels;
+	int pitch;
+
+	if (SDL_LockTexture(m_texture, nullptr, &pixels, &pitch) == 0)
+	{
+		m_raycaster.Render(snapshot, m_camera, (uint32_t *)pixels, m_width, m_height, pitch);
+		SDL_UnlockTexture(m_texture);
+	}
+
+	SDL_RenderCopy(m_renderer, m_texture, nullptr, nullptr);
+	SDL_RenderPresent(m_renderer);
+
+	m_frameCount++;
+
+	Uint32 ticks = SDL_GetTicks();
+
+	if (ticks - m_frameTicks >= 1000)
+	{
+		string title = "Doom RPG Edit - Preview - " + to_string(m_frameCount * 1000 / (ticks - m_frameTicks)) + " FPS";
+		SDL_SetWindowTitle(m_window, title.c_str());
+		m_frameTicks = ticks;
+		m_frameCount = 0;
+	}
+}
+
+void CPreview::MoveCamera(const CMapSnapshot &snapshot, float distance)
+{
+	float x = m_camera.x + cosf(m_camera.angle) * distance;
+	float y = m_camera.y - sinf(m_camera.angle) * distance;
+
+	if (snapshot.GetBlock(int(floorf(x / 64.0f)), int(floorf(m_camera.y / 64.0f))) == BLOCK_EMPTY)
+		m_camera.x = x;
+
+	if (snapshot.GetBlock(int(floorf(m_camera.x / 64.0f)), int(floorf(y / 64.0f))) == BLOCK_EMPTY)
+		m_camera.y = y;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CPREVIEW_H__
+#define __CPREVIEW_H__
+
+#include "SDL.h"
+
+#include "CMapSnapshot.h"
+#include "CRaycaster.h"
+#include "CThreadPool.h"
+
+// First person preview window. It lives on the render thread and draws
+// from the same snapshots as the editor view.
+class CPreview
+{
+public:
+	CPreview(CThreadPool &pool, int width = 640, int height = 480) : m_window(nullptr), m_renderer(nullptr), m_texture(nullptr), m_windowID(0), m_width(width), m_height(height), m_raycaster(pool), m_frameTicks(0), m_frameCount(0) {}
+	~CPreview() { Close(); }
+
+	void Open(const CMapSnapshot &snapshot);
+	void Close();
+	bool HandleEvent(const SDL_Event &event, const CMapSnapshot &snapshot);
+	void Render(const CMapSnapshot &snapshot);
+
+	bool IsOpen() const { return (m_window != nullptr); }
+
+	void SetTextureCache(CTextureCache *textureCache) { m_raycaster.SetTextureCache(textureCache); }
+
+private:
+	void MoveCamera(const CMapSnapshot &snapshot, float distance);
+
+	SDL_Window *m_window;
+	SDL_Renderer *m_renderer;
+	SDL_Texture *m_texture;
+	Uint32 m_windowID;
+	int m_width;
+	int m_height;
+	CRaycaster m_raycaster;
+	RaycastCamera m_camera;
+	Uint32 m_frameTicks;
+	unsigned int m_frameCount;
+};
+
+#endif
\ No newline at end of file
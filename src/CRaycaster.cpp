@@ -0,0 +1,178 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <algorithm>
+#include <cmath>
+
+#include "CRaycaster.h"
+
+using namespace std;
+
+static uint32_t PackColor(int r, int g, int b)
+{
+	return ((uint32_t(r) << 24) | (uint32_t(g) << 16) | (uint32_t(b) << 8) | 0xFF);
+}
+
+static int SampleFloor(float positionX, float positionY, float rayX, float rayY, float distance)
+{
+	int u = int((positionX + rayX * distance) * TEXTURE_SIZE) & (TEXTURE_SIZE - 1);
+	int v = int((positionY + rayY * distance) * TEXTURE_SIZE) & (TEXTURE_SIZE - 1);
+
+	return (v * TEXTURE_SIZE + u);
+}
+
+void CRaycaster::Render(const CMapSnapshot &snapshot, const RaycastCamera &camera, uint32_t *pixels, int width, int height, int pitch)
+{
+	Frame frame = { &snapshot, &camera, pixels, width, height, pitch / int(sizeof(uint32_t)), nullptr, nullptr };
+
+	if (m_textureCache != nullptr)
+	{
+		frame.floorTexture = m_textureCache->GetTexture(snapshot.GetHeader().floorTexture);
+		frame.ceilingTexture = m_textureCache->GetTexture(snapshot.GetHeader().ceilingTexture);
+	}
+
+	// Distance, in blocks, of the floor seen through each row below the
+	// horizon. Rows above it see the ceiling at the mirrored distance.
+	if (int(m_rowDistances.size()) != height)
+	{
+		m_rowDistances.resize(height);
+
+		for (int y = 0; y < height; y++)
+			m_rowDistances[y] = float(height) / fabsf(float(2 * y + 1 - height));
+	}
+
+	m_pool.ParallelFor(width, [&](unsigned int start, unsigned int end)
+	{
+		RenderColumns(frame, int(start), int(end));
+	});
+}
+
+void CRaycaster::RenderColumns(const Frame &frame, int startColumn, int endColumn)
+{
+	const CMapSnapshot &snapshot = *frame.snapshot;
+	const RaycastCamera &camera = *frame.camera;
+	const bspheaderex_t &header = snapshot.GetHeader();
+	uint32_t ceilingColor = PackColor(header.ceilingColor.r, header.ceilingColor.g, header.ceilingColor.b);
+	uint32_t floorColor = PackColor(header.floorColor.r, header.floorColor.g, header.floorColor.b);
+	const uint32_t *floorTexels = (frame.floorTexture != nullptr ? frame.floorTexture->pixels.data() : nullptr);
+	const uint32_t *ceilingTexels = (frame.ceilingTexture != nullptr ? frame.ceilingTexture->pixels.data() : nullptr);
+	int width = frame.width;
+	int height = frame.height;
+	int stride = frame.stride;
+
+	float positionX = camera.x / 64.0f;
+	float positionY = camera.y / 64.0f;
+	float directionX = cosf(camera.angle);
+	float directionY = -sinf(camera.angle);
+	float planeLength = tanf(m_fieldOfView * 0.5f);
+	float planeX = -directionY * planeLength;
+	float planeY = directionX * planeLength;
+
+	for (int column = startColumn; column < endColumn; column++)
+	{
+		float cameraX = 2.0f * column / width - 1.0f;
+		float rayX = directionX + planeX * cameraX;
+		float rayY = directionY + planeY * cameraX;
+
+		int cellX = int(floorf(positionX));
+		int cellY = int(floorf(positionY));
+
+		float deltaX = (rayX != 0.0f ? fabsf(1.0f / rayX) : 1e30f);
+		float deltaY = (rayY != 0.0f ? fabsf(1.0f / rayY) : 1e30f);
+
+		int stepX = (rayX < 0.0f ? -1 : 1);
+		int stepY = (rayY < 0.0f ? -1 : 1);
+
+		float sideX = (rayX < 0.0f ? (positionX - cellX) : (cellX + 1.0f - positionX)) * deltaX;
+		float sideY = (rayY < 0.0f ? (positionY - cellY) : (cellY + 1.0f - positionY)) * deltaY;
+
+		unsigned char block = BLOCK_EMPTY;
+		int side = 0;
+
+		for (int steps = 0; steps < 64 && block == BLOCK_EMPTY; steps++)
+		{
+			if (sideX < sideY)
+			{
+				sideX += deltaX;
+				cellX += stepX;
+				side = 0;
+			}
+			else
+			{
+				sideY += deltaY;
+				cellY += stepY;
+				side = 1;
+			}
+
+			block = snapshot.GetBlock(cellX, cellY);
+		}
+
+		int wallTop = height / 2;
+		int wallBottom = height / 2;
+		uint32_t wallColor = 0;
+
+		if (block != BLOCK_EMPTY)
+		{
+			float distance = (side == 0 ? sideX - deltaX : sideY - deltaY);
+			int wallHeight = (distance > 0.0f ? int(height / distance) : height);
+			wallTop = max(height / 2 - wallHeight / 2, 0);
+			wallBottom = min(height / 2 + wallHeight / 2, height);
+
+			int r = 160, g = 160, b = 160;
+
+			if (block == BLOCK_DOOR)
+			{
+				r = 150;
+				g = 100;
+				b = 50;
+			}
+			else if (block == BLOCK_OTHER)
+			{
+				r = 100;
+				g = 130;
+				b = 160;
+			}
+
+			float shade = max(1.0f - distance / 16.0f, 0.25f) * (side == 1 ? 0.75f : 1.0f);
+			wallColor = PackColor(int(r * shade), int(g * shade), int(b * shade));
+		}
+
+		uint32_t *pixel = frame.pixels + column;
+		int y = 0;
+
+		if (ceilingTexels != nullptr)
+		{
+			for (; y < wallTop; y++, pixel += stride)
+				*pixel = ceilingTexels[SampleFloor(positionX, positionY, rayX, rayY, m_rowDistances[y])];
+		}
+		else
+		{
+			for (; y < wallTop; y++, pixel += stride)
+				*pixel = ceilingColor;
+		}
+
+		for (; y < wallBottom; y++, pixel += stride)
+			*pixel = wallColor;
+
+		if (floorTexels != nullptr)
+		{
+			for (; y < height; y++, pixel += stride)
+				*pixel = floorTexels[SampleFloor(positionX, positionY, rayX, rayY, m_rowDistances[y])];
+		}
+		else
+		{
+			for (; y < height; y++, pixel += stride)
+				*pixel = floorColor;
+		}
+	}
+}
\ No newline at end of file
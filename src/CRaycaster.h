@@ -0,0 +1,66 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CRAYCASTER_H__
+#define __CRAYCASTER_H__
+
+#include <cstdint>
+
+#include "CMapSnapshot.h"
+#include "CTextureCache.h"
+#include "CThreadPool.h"
+
+struct RaycastCamera
+{
+	float x;
+	float y;
+	float angle;
+};
+
+// Software column raycaster over the 32x32 block map. Each block is 64 map
+// units wide and every screen column is traced independently, so columns
+// are spread across the thread pool. Output pixels are RGBA8888.
+class CRaycaster
+{
+public:
+	CRaycaster(CThreadPool &pool, float fieldOfView = 1.3962634f) : m_pool(pool), m_textureCache(nullptr), m_fieldOfView(fieldOfView) {}
+
+	void Render(const CMapSnapshot &snapshot, const RaycastCamera &camera, uint32_t *pixels, int width, int height, int pitch);
+
+	float GetFieldOfView() const { return m_fieldOfView; }
+	void SetFieldOfView(float fieldOfView) { m_fieldOfView = fieldOfView; }
+
+	void SetTextureCache(CTextureCache *textureCache) { m_textureCache = textureCache; }
+
+private:
+	struct Frame
+	{
+		const CMapSnapshot *snapshot;
+		const RaycastCamera *camera;
+		uint32_t *pixels;
+		int width;
+		int height;
+		int stride;
+		std::shared_ptr<const Image> floorTexture;
+		std::shared_ptr<const Image> ceilingTexture;
+	};
+
+	void RenderColumns(const Frame &frame, int startColumn, int endColumn);
+
+	CThreadPool &m_pool;
+	CTextureCache *m_textureCache;
+	float m_fieldOfView;
+	std::vector<float> m_rowDistances;
+};
+
+#endif
\ No newline at end of file
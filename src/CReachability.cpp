@@ -0,0 +1,200 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <cmath>
+#include <cstring>
+
+#include "CReachability.h"
+
+using namespace std;
+
+void CReachability::Analyze()
+{
+	uint32_t open[32];
+	uint32_t locked[32];
+
+	memset(locked, 0, sizeof(locked));
+
+	for (int y = 0; y < 32; y++)
+	{
+		open[y] = 0;
+
+		for (int x = 0; x < 32; x++)
+		{
+			if (m_map.GetBlock(x, y) == BLOCK_EMPTY || m_map.GetBlock(x, y) == BLOCK_DOOR)
+				open[y] |= 1u << x;
+		}
+	}
+
+	CList<Line> *lines = m_map.GetLines();
+
+	if (!lines->IsEmpty())
+	{
+		for (CNode<Line> *currentLine = lines->Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+		{
+			if (currentLine->VisitNode() != 0)
+				continue;
+
+			const Line *line = currentLine->GetData();
+
+			if (m_map.GetLineSource(line->handle) != LINE_SOURCE_SEGMENT || !(m_map.GetLineFlags(line->handle) & LF_LOCKED_DOOR))
+				continue;
+
+			int x = int(floorf((line->vertex1->GetData()->x + line->vertex2->GetData()->x) / 128.0f));
+			int y = int(floorf((line->vertex1->GetData()->y + line->vertex2->GetData()->y) / 128.0f));
+
+			if (x >= 0 && y >= 0 && x < 32 && y < 32)
+				locked[y] |= 1u << x;
+		}
+	}
+
+	m_things.clear();
+
+	CList<Thing> *things = m_map.GetThings();
+
+	if (!things->IsEmpty())
+	{
+		for (CNode<Thing> *currentThing = things->Head(); currentThing->GetData() != nullptr; currentThing = currentThing->Next())
+		{
+			if (currentThing->VisitNode() != 0)
+				continue;
+
+			const Thing *thing = currentThing->GetData();
+			m_things.push_back({ thing->handle, m_map.GetThingId(thing->handle), int(floorf(thing->x / 64.0f)), int(floorf(thing->y / 64.0f)), -1 });
+		}
+	}
+
+	uint32_t passable[32];
+	unsigned int keyCount = 0;
+	unsigned int usedKeyCount = 0;
+	unsigned int playerPosition = m_map.GetHeader().playerPosition;
+
+	memset(m_reachable, 0, sizeof(m_reachable));
+	m_layerCount = 0;
+
+	// A start outside the map or in a cell that cannot be walked reaches
+	// nothing, so every thing is left unreached.
+	m_hasStart = (playerPosition < 32 * 32 && (open[playerPosition / 32] & ~locked[playerPosition / 32] & (1u << (playerPosition % 32))) != 0);
+
+	if (!m_hasStart)
+		return;
+
+	m_reachable[playerPosition / 32] = 1u << (playerPosition % 32);
+
+	for (int layer = 0; ; layer++)
+	{
+		for (int y = 0; y < 32; y++)
+			passable[y] = open[y] & ~locked[y];
+
+		Flood(passable, m_reachable);
+		m_layerCount++;
+
+		// Things in walls or doorways count as reached when a neighbouring
+		// cell is.
+		for (ThingReachability &thing : m_things)
+		{
+			if (thing.layer >= 0 || thing.cellX < 0 || thing.cellY < 0 || thing.cellX >= 32 || thing.cellY >= 32)
+				continue;
+
+			uint32_t bit = 1u << thing.cellX;
+
+			if ((m_reachable[thing.cellY] & bit) || (!(passable[thing.cellY] & bit) && (Grow(m_reachable, thing.cellY) & bit)))
+			{
+				thing.layer = layer;
+
+				if (IsKey(thing.id))
+					keyCount++;
+			}
+		}
+
+		if (keyCount == usedKeyCount)
+			break;
+
+		// A new key opens the locked doors on the edge of the reachable
+		// region for the next layer.
+		bool opened = false;
+
+		for (int y = 0; y < 32; y++)
+		{
+			uint32_t frontier = Grow(m_reachable, y) & locked[y] & open[y];
+
+			if (frontier != 0)
+			{
+				locked[y] &= ~frontier;
+				opened = true;
+			}
+		}
+
+		if (!opened)
+			break;
+
+		usedKeyCount = keyCount;
+	}
+}
+
+unsigned int CReachability::GetUnreachableCount() const
+{
+	unsigned int count = 0;
+
+	for (const ThingReachability &thing : m_things)
+	{
+		if (thing.layer < 0)
+			count++;
+	}
+
+	return count;
+}
+
+void CReachability::Flood(const uint32_t *passable, uint32_t *reachable)
+{
+	bool changed = true;
+
+	for (int y = 0; y < 32; y++)
+		reachable[y] &= passable[y];
+
+	// Grow the reachable set by one cell in each direction per pass. Each
+	// row is a bitmask, so a whole row moves with a few shifts.
+	while (changed)
+	{
+		changed = false;
+
+		for (int y = 0; y < 32; y++)
+		{
+			uint32_t row = Grow(reachable, y) & passable[y];
+
+			if (row != reachable[y])
+			{
+				reachable[y] = row;
+				changed = true;
+			}
+		}
+	}
+}
+
+uint32_t CReachability::Grow(const uint32_t *cells, int y)
+{
+	uint32_t row = cells[y] | (cells[y] << 1) | (cells[y] >> 1);
+
+	if (y > 0)
+		row |= cells[y - 1];
+
+	if (y < 31)
+		row |= cells[y + 1];
+
+	return row;
+}
+
+bool CReachability::IsKey(uint8_t id)
+{
+	return (id == ENTITY_RED_KEY || id == ENTITY_BLUE_KEY || id == ENTITY_GREEN_KEY || id == ENTITY_YELLOW_KEY);
+}
\ No newline at end of file
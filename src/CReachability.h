@@ -0,0 +1,62 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CREACHABILITY_H__
+#define __CREACHABILITY_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "CMap.h"
+
+struct ThingReachability
+{
+	unsigned int handle;
+	uint8_t id;
+	int cellX;
+	int cellY;
+	int layer;
+};
+
+// Flood fills the block map from the player start one row bitmask at a
+// time. Layer 0 is what can be reached without keys. Each new key found
+// opens the locked doors on the edge of the region for the next layer,
+// since the map data does not say which key opens which door. Things that
+// are never reached have a layer of -1.
+class CReachability
+{
+public:
+	CReachability(CMap &map) : m_map(map), m_layerCount(0), m_hasStart(false) {}
+
+	void Analyze();
+
+	const uint32_t *GetReachable() const { return m_reachable; }
+	unsigned int GetLayerCount() const { return m_layerCount; }
+	bool HasStart() const { return m_hasStart; }
+	const std::vector<ThingReachability> &GetThings() const { return m_things; }
+	unsigned int GetUnreachableCount() const;
+
+	static void Flood(const uint32_t *passable, uint32_t *reachable);
+
+private:
+	static uint32_t Grow(const uint32_t *cells, int y);
+	static bool IsKey(uint8_t id);
+
+	CMap &m_map;
+	uint32_t m_reachable[32];
+	unsigned int m_layerCount;
+	bool m_hasStart;
+	std::vector<ThingReachability> m_things;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CSCREENCELLS_H__
+#define __CSCREENCELLS_H__
+
+#include <vector>
+
+// One flag per square of cellSize pixels over the view, for drawing at most
+// one primitive in each square.
+class CScreenCells
+{
+public:
+	CScreenCells(int width, int height, int cellSize) : m_columns((width + cellSize - 1) / cellSize), m_rows((height + cellSize - 1) / cellSize), m_cellSize(cellSize), m_cells(m_columns * m_rows, false) {}
+
+	// False if the point is outside the view or its cell is already taken.
+	bool Occupy(int x, int y)
+	{
+		if (x < 0 || y < 0 || x >= m_columns * m_cellSize || y >= m_rows * m_cellSize)
+			return false;
+
+		std::vector<bool>::reference cell = m_cells[(y / m_cellSize) * m_columns + x / m_cellSize];
+
+		if (cell)
+			return false;
+
+		cell = true;
+
+		return true;
+	}
+
+private:
+	int m_columns;
+	int m_rows;
+	int m_cellSize;
+	std::vector<bool> m_cells;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#include <algorithm>
+
+#include "CSectorGrid.h"
+
+using namespace std;
+
+CSectorGrid::CSectorGrid(int size, int cellSize) : m_cellSize(cellSize), m_cellCount((size + cellSize - 1) / cellSize), m_stamp(0), m_version(0)
+{
+	m_cells.resize(m_cellCount * m_cellCount);
+}
+
+void CSectorGrid::Clear()
+{
+	for (vector<unsigned int> &cell : m_cells)
+		cell.clear();
+
+	m_sectors.clear();
+	m_stamps.clear();
+}
+
+void CSectorGrid::Insert(CNode<Sector> *sector)
+{
+	unsigned int index = (unsigned int)m_sectors.size();
+	int x1 = GetCell(sector->GetData()->minX), x2 = GetCell(sector->GetData()->maxX);
+	int y1 = GetCell(sector->GetData()->minY), y2 = GetCell(sector->GetData()->maxY);
+
+	m_sectors.push_back(sector);
+	m_stamps.push_back(0);
+
+	for (int y = y1; y <= y2; y++)
+	{
+		for (int x = x1; x <= x2; x++)
+			m_cells[y * m_cellCount + x].push_back(index);
+	}
+}
+
+// Returns the sectors whose bounding boxes lie entirely inside the box.
+void CSectorGrid::Query(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, vector<CNode<Sector> *> &sectors) const
+{
+	int x1 = GetCell(minX), x2 = GetCell(maxX);
+	int y1 = GetCell(minY), y2 = GetCell(maxY);
+
+	sectors.clear();
+
+	if (++m_stamp == 0)
+	{
+		fill(m_stamps.begin(), m_stamps.end(), 0);
+		m_stamp = 1;
+	}
+
+	for (int y = y1; y <= y2; y++)
+	{
+		for (int x = x1; x <= x2; x++)
+		{
+			for (unsigned int index : m_cells[y * m_cellCount + x])
+			{
+				const Sector *sector = m_sectors[index]->GetData();
+
+				if (m_stamps[index] == m_stamp)
+					continue;
+
+				m_stamps[index] = m_stamp;
+
+				if (sector->minX >= minX && sector->minY >= minY && sector->maxX <= maxX && sector->maxY <= maxY)
+					sectors.push_back(m_sectors[index]);
+			}
+		}
+	}
+}
+
+int CSectorGrid::GetCell(int32_t coordinate) const
+{
+	return min(max(coordinate, 0) / m_cellSize, m_cellCount - 1);
+}
\ No newline at end of file
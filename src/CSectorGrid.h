@@ -0,0 +1,48 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+
+#ifndef __CSECTORGRID_H__
+#define __CSECTORGRID_H__
+
+#include <vector>
+
+#include "CMap.h"
+
+// Uniform grid of buckets holding sectors by bounding box, for finding the
+// sectors inside a selection box without testing every sector.
+class CSectorGrid
+{
+public:
+	CSectorGrid(int size = 2048, int cellSize = 128);
+
+	void Clear();
+	void Insert(CNode<Sector> *sector);
+	void Query(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, std::vector<CNode<Sector> *> &sectors) const;
+
+	unsigned int GetVersion() const { return m_version; }
+	void SetVersion(unsigned int version) { m_version = version; }
+
+private:
+	int GetCell(int32_t coordinate) const;
+
+	int m_cellSize;
+	int m_cellCount;
+	std::vector<CNode<Sector> *> m_sectors;
+	std::vector<std::vector<unsigned int>> m_cells;
+	mutable std::vector<unsigned int> m_stamps;
+	mutable unsigned int m_stamp;
+	unsigned int m_version;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,208 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <algorithm>
+
+#include "CSegmentGrid.h"
+
+using namespace std;
+
+static int Orientation(int64_t ax, int64_t ay, int64_t bx, int64_t by, int64_t cx, int64_t cy)
+{
+	int64_t cross = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+
+	return (cross > 0) - (cross < 0);
+}
+
+// Only proper crossings are reported. Segments that touch at an end point
+// or overlap along a line are left alone, since those already share a
+// vertex or need no split.
+bool SegmentsCross(const Segment &segment1, const Segment &segment2, SegmentIntersection *intersection)
+{
+	int o1 = Orientation(segment1.x1, segment1.y1, segment1.x2, segment1.y2, segment2.x1, segment2.y1);
+	int o2 = Orientation(segment1.x1, segment1.y1, segment1.x2, segment1.y2, segment2.x2, segment2.y2);
+	int o3 = Orientation(segment2.x1, segment2.y1, segment2.x2, segment2.y2, segment1.x1, segment1.y1);
+	int o4 = Orientation(segment2.x1, segment2.y1, segment2.x2, segment2.y2, segment1.x2, segment1.y2);
+
+	if (o1 * o2 >= 0 || o3 * o4 >= 0)
+		return false;
+
+	if (intersection != nullptr)
+	{
+		int64_t dx1 = int64_t(segment1.x2) - segment1.x1, dy1 = int64_t(segment1.y2) - segment1.y1;
+		int64_t dx2 = int64_t(segment2.x2) - segment2.x1, dy2 = int64_t(segment2.y2) - segment2.y1;
+		int64_t denominator = dx1 * dy2 - dy1 * dx2;
+		int64_t tNumerator = (int64_t(segment2.x1) - segment1.x1) * dy2 - (int64_t(segment2.y1) - segment1.y1) * dx2;
+
+		if (denominator < 0)
+		{
+			denominator = -denominator;
+			tNumerator = -tNumerator;
+		}
+
+		intersection->segment1 = segment1.id;
+		intersection->segment2 = segment2.id;
+		intersection->x = segment1.x1;
+		intersection->y = segment1.y1;
+		intersection->xNumerator = tNumerator * dx1;
+		intersection->yNumerator = tNumerator * dy1;
+		intersection->tNumerator = tNumerator;
+		intersection->denominator = denominator;
+	}
+
+	return true;
+}
+
+bool IsCloserAlongSegment(const SegmentIntersection &intersection1, const SegmentIntersection &intersection2)
+{
+	// Compare t1 / d1 < t2 / d2 without dividing. Denominators are positive.
+#ifdef __SIZEOF_INT128__
+	return __int128(intersection1.tNumerator) * intersection2.denominator < __int128(intersection2.tNumerator) * intersection1.denominator;
+#else
+	return (long double)intersection1.tNumerator * intersection2.denominator < (long double)intersection2.tNumerator * intersection1.denominator;
+#endif
+}
+
+// Rounds to the nearest whole unit, with halves rounded up. The
+// denominator is always positive.
+static int32_t RoundDivide(int64_t numerator, int64_t denominator)
+{
+	int64_t doubled = 2 * numerator + denominator;
+	int64_t quotient = doubled / (2 * denominator);
+
+	return int32_t(doubled % (2 * denominator) < 0 ? quotient - 1 : quotient);
+}
+
+void GetIntersectionPoint(const SegmentIntersection &intersection, int32_t &x, int32_t &y)
+{
+	x = intersection.x + RoundDivide(intersection.xNumerator, intersection.denominator);
+	y = intersection.y + RoundDivide(intersection.yNumerator, intersection.denominator);
+}
+
+void FindIntersections(const vector<Segment> &segments, vector<SegmentIntersection> &intersections)
+{
+	vector<unsigned int> order(segments.size());
+	vector<unsigned int> active;
+
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	sort(order.begin(), order.end(), [&](unsigned int segment1, unsigned int segment2)
+	{
+		return min(segments[segment1].x1, segments[segment1].x2) < min(segments[segment2].x1, segments[segment2].x2);
+	});
+
+	intersections.clear();
+
+	for (unsigned int index : order)
+	{
+		const Segment &segment = segments[index];
+		int32_t minX = min(segment.x1, segment.x2);
+		int32_t minY = min(segment.y1, segment.y2);
+		int32_t maxY = max(segment.y1, segment.y2);
+
+		// Drop the segments the sweep line has passed.
+		active.erase(remove_if(active.begin(), active.end(), [&](unsigned int activeIndex)
+		{
+			return max(segments[activeIndex].x1, segments[activeIndex].x2) < minX;
+		}), active.end());
+
+		for (unsigned int activeIndex : active)
+		{
+			const Segment &activeSegment = segments[activeIndex];
+			SegmentIntersection intersection;
+
+			if (max(activeSegment.y1, activeSegment.y2) < minY || min(activeSegment.y1, activeSegment.y2) > maxY)
+				continue;
+
+			if (SegmentsCross(activeSegment, segment, &intersection))
+				intersections.push_back(intersection);
+		}
+
+		active.push_back(index);
+	}
+}
+
+CSegmentGrid::CSegmentGrid(int size, int cellSize) : m_cellSize(cellSize), m_cellCount((size + cellSize - 1) / cellSize), m_stamp(0), m_version(0)
+{
+	m_cells.resize(m_cellCount * m_cellCount);
+}
+
+void CSegmentGrid::Clear()
+{
+	for (vector<unsigned int> &cell : m_cells)
+		cell.clear();
+
+	m_segments.clear();
+	m_stamps.clear();
+}
+
+void CSegmentGrid::Insert(const Segment &segment)
+{
+	unsigned int index = (unsigned int)m_segments.size();
+	int x1 = GetCell(min(segment.x1, segment.x2)), x2 = GetCell(max(segment.x1, segment.x2));
+	int y1 = GetCell(min(segment.y1, segment.y2)), y2 = GetCell(max(segment.y1, segment.y2));
+
+	m_segments.push_back(segment);
+	m_stamps.push_back(0);
+
+	for (int y = y1; y <= y2; y++)
+	{
+		for (int x = x1; x <= x2; x++)
+			m_cells[y * m_cellCount + x].push_back(index);
+	}
+}
+
+void CSegmentGrid::Query(const Segment &segment, vector<SegmentIntersection> &intersections) const
+{
+	int x1 = GetCell(min(segment.x1, segment.x2)), x2 = GetCell(max(segment.x1, segment.x2));
+	int y1 = GetCell(min(segment.y1, segment.y2)), y2 = GetCell(max(segment.y1, segment.y2));
+
+	intersections.clear();
+
+	// Segments spanning several cells are only tested once per query.
+	if (++m_stamp == 0)
+	{
+		fill(m_stamps.begin(), m_stamps.end(), 0);
+		m_stamp = 1;
+	}
+
+	for (int y = y1; y <= y2; y++)
+	{
+		for (int x = x1; x <= x2; x++)
+		{
+			for (unsigned int index : m_cells[y * m_cellCount + x])
+			{
+				SegmentIntersection intersection;
+
+				if (m_stamps[index] == m_stamp)
+					continue;
+
+				m_stamps[index] = m_stamp;
+
+				if (SegmentsCross(segment, m_segments[index], &intersection))
+					intersections.push_back(intersection);
+			}
+		}
+	}
+
+	sort(intersections.begin(), intersections.end(), [](const SegmentIntersection &intersection1, const SegmentIntersection &intersection2)
+	{
+		return IsCloserAlongSegment(intersection1, intersection2);
+	});
+}
+
+int CSegmentGrid::GetCell(int32_t coordinate) const
+{
+	return min(max(int(coordinate / m_cellSize), 0), m_cellCount - 1);
+}
\ No newline at end of file
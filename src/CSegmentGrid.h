@@ -0,0 +1,88 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CSEGMENTGRID_H__
+#define __CSEGMENTGRID_H__
+
+#include <cstdint>
+#include <vector>
+
+// Map coordinates are whole units, so segments are kept as integers and
+// every predicate below is exact.
+struct Segment
+{
+	int32_t x1;
+	int32_t y1;
+	int32_t x2;
+	int32_t y2;
+	unsigned int id;
+};
+
+// The crossing point is (x + xNumerator / denominator, y + yNumerator /
+// denominator), where (x, y) is the start of the first segment, and t is
+// its position along the first segment, scaled by denominator as well.
+// Measuring from the start keeps the numerators below 2 * d^3 for
+// coordinate differences of up to d, which fits in 64 bits while d stays
+// under 2^20.
+struct SegmentIntersection
+{
+	unsigned int segment1;
+	unsigned int segment2;
+	int32_t x;
+	int32_t y;
+	int64_t xNumerator;
+	int64_t yNumerator;
+	int64_t tNumerator;
+	int64_t denominator;
+};
+
+bool SegmentsCross(const Segment &segment1, const Segment &segment2, SegmentIntersection *intersection);
+
+// Whether intersection1 lies before intersection2 along their first
+// segment. Numerators and denominators can take 33 bits each, so their
+// cross products are compared in 128 bits where the compiler has them.
+bool IsCloserAlongSegment(const SegmentIntersection &intersection1, const SegmentIntersection &intersection2);
+void GetIntersectionPoint(const SegmentIntersection &intersection, int32_t &x, int32_t &y);
+
+// Sorts segments by their left end and sweeps a vertical line across
+// them, only testing segments whose x ranges are active at the same time
+// and whose y ranges overlap.
+void FindIntersections(const std::vector<Segment> &segments, std::vector<SegmentIntersection> &intersections);
+
+// Uniform grid of buckets for finding the segments that cross a single
+// new one without testing the whole map.
+class CSegmentGrid
+{
+public:
+	CSegmentGrid(int size = 2048, int cellSize = 128);
+
+	void Clear();
+	void Insert(const Segment &segment);
+	void Query(const Segment &segment, std::vector<SegmentIntersection> &intersections) const;
+
+	unsigned int GetVersion() const { return m_version; }
+	void SetVersion(unsigned int version) { m_version = version; }
+
+private:
+	int GetCell(int32_t coordinate) const;
+
+	int m_cellSize;
+	int m_cellCount;
+	std::vector<Segment> m_segments;
+	std::vector<std::vector<unsigned int>> m_cells;
+	mutable std::vector<unsigned int> m_stamps;
+	mutable unsigned int m_stamp;
+	unsigned int m_version;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,182 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "CSpriteAtlas.h"
+
+using namespace std;
+
+CSpriteAtlas::CSpriteAtlas(CSpriteDecoder &decoder, int width, int height) : m_decoder(decoder), m_width(width), m_height(height), m_texture(nullptr), m_renderer(nullptr), m_dirty(false)
+{
+	Clear();
+}
+
+CSpriteAtlas::~CSpriteAtlas()
+{
+	if (m_texture != nullptr)
+		SDL_DestroyTexture(m_texture);
+}
+
+AtlasRegion CSpriteAtlas::GetThingRegion(unsigned int thing)
+{
+	auto region = m_regions.find(thing);
+
+	if (region != m_regions.end())
+		return region->second;
+
+	AtlasRegion newRegion = {};
+	Sprite sprite;
+
+	if (m_decoder.DecodeThing(thing, sprite) && sprite.image.width > 0 && sprite.image.height > 0)
+	{
+		// Start over with an empty atlas rather than fail once it is full.
+		if (!Pack(sprite.image.width + 1, sprite.image.height + 1, newRegion.rect))
+		{
+			Clear();
+			Pack(sprite.image.width + 1, sprite.image.height + 1, newRegion.rect);
+		}
+
+		newRegion.rect.w = sprite.image.width;
+		newRegion.rect.h = sprite.image.height;
+		newRegion.xOffset = sprite.xOffset;
+		newRegion.yOffset = sprite.yOffset;
+		newRegion.valid = (newRegion.rect.x + newRegion.rect.w <= m_width && newRegion.rect.y + newRegion.rect.h <= m_height);
+
+		if (newRegion.valid)
+		{
+			for (int y = 0; y < sprite.image.height; y++)
+				memcpy(&m_pixels[(newRegion.rect.y + y) * m_width + newRegion.rect.x], &sprite.image.pixels[y * sprite.image.width], sprite.image.width * sizeof(uint32_t));
+
+			m_dirty = true;
+		}
+	}
+
+	m_regions[thing] = newRegion;
+
+	return newRegion;
+}
+
+SDL_Texture *CSpriteAtlas::GetTexture(SDL_Renderer *renderer)
+{
+	if (m_texture == nullptr || m_renderer != renderer)
+	{
+		if (m_texture != nullptr)
+			SDL_DestroyTexture(m_texture);
+
+		m_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, m_width, m_height);
+		m_renderer = renderer;
+		m_dirty = true;
+
+		SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+	}
+
+	if (m_dirty)
+	{
+		SDL_UpdateTexture(m_texture, nullptr, m_pixels.data(), m_width * sizeof(uint32_t));
+		m_dirty = false;
+	}
+
+	return m_texture;
+}
+
+void CSpriteAtlas::Clear()
+{
+	m_pixels.assign(m_width * m_height, 0);
+	m_skyline.assign(1, { 0, 0, m_width });
+	m_regions.clear();
+	m_dirty = true;
+}
+
+bool CSpriteAtlas::Pack(int width, int height, SDL_Rect &rect)
+{
+	size_t bestSegment = m_skyline.size();
+	int bestY = INT_MAX;
+	int bestWidth = INT_MAX;
+
+	for (size_t i = 0; i < m_skyline.size(); i++)
+	{
+		int y = FitSegment(i, width, height);
+
+		if (y >= 0 && (y < bestY || (y == bestY && m_skyline[i].width < bestWidth)))
+		{
+			bestSegment = i;
+			bestY = y;
+			bestWidth = m_skyline[i].width;
+		}
+	}
+
+	if (bestSegment == m_skyline.size())
+		return false;
+
+	rect = { m_skyline[bestSegment].x, bestY, width, height };
+
+	m_skyline.insert(m_skyline.begin() + bestSegment, { rect.x, rect.y + height, width });
+
+	// Trim or remove the segments now covered by the new one.
+	for (size_t i = bestSegment + 1; i < m_skyline.size(); )
+	{
+		int coveredWidth = rect.x + width - m_skyline[i].x;
+
+		if (coveredWidth <= 0)
+			break;
+
+		if (coveredWidth < m_skyline[i].width)
+		{
+			m_skyline[i].x += coveredWidth;
+			m_skyline[i].width -= coveredWidth;
+			break;
+		}
+
+		m_skyline.erase(m_skyline.begin() + i);
+	}
+
+	for (size_t i = 0; i + 1 < m_skyline.size(); )
+	{
+		if (m_skyline[i].y == m_skyline[i + 1].y)
+		{
+			m_skyline[i].width += m_skyline[i + 1].width;
+			m_skyline.erase(m_skyline.begin() + i + 1);
+		}
+		else
+			i++;
+	}
+
+	return true;
+}
+
+int CSpriteAtlas::FitSegment(size_t segment, int width, int height) const
+{
+	if (m_skyline[segment].x + width > m_width)
+		return -1;
+
+	int y = 0;
+	int remainingWidth = width;
+
+	for (size_t i = segment; remainingWidth > 0; i++)
+	{
+		if (i == m_skyline.size())
+			return -1;
+
+		y = max(y, m_skyline[i].y);
+
+		if (y + height > m_height)
+			return -1;
+
+		remainingWidth -= m_skyline[i].width;
+	}
+
+	return y;
+}
\ No newline at end of file
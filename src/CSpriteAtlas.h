@@ -0,0 +1,72 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CSPRITEATLAS_H__
+#define __CSPRITEATLAS_H__
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "SDL.h"
+
+#include "CSpriteDecoder.h"
+
+struct AtlasRegion
+{
+	SDL_Rect rect;
+	int xOffset;
+	int yOffset;
+	bool valid;
+};
+
+// Packs decoded thing sprites into one texture with a skyline packer so
+// that all things can be drawn with a single textured draw call. Sprites
+// are decoded on first use. Must only be used on the render thread.
+class CSpriteAtlas
+{
+public:
+	CSpriteAtlas(CSpriteDecoder &decoder, int width = 1024, int height = 1024);
+	~CSpriteAtlas();
+
+	AtlasRegion GetThingRegion(unsigned int thing);
+	SDL_Texture *GetTexture(SDL_Renderer *renderer);
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+
+	void Clear();
+
+private:
+	struct SkylineSegment
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	bool Pack(int width, int height, SDL_Rect &rect);
+	int FitSegment(size_t segment, int width, int height) const;
+
+	CSpriteDecoder &m_decoder;
+	int m_width;
+	int m_height;
+	std::vector<uint32_t> m_pixels;
+	std::vector<SkylineSegment> m_skyline;
+	std::unordered_map<unsigned int, AtlasRegion> m_regions;
+	SDL_Texture *m_texture;
+	SDL_Renderer *m_renderer;
+	bool m_dirty;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <cstring>
+
+#include "CSpriteDecoder.h"
+
+using namespace std;
+
+bool CSpriteDecoder::Decode(unsigned int sprite, Sprite &spriteOut) const
+{
+	TexelReference reference;
+
+	if (!m_textureCache.ResolveSprite(sprite, m_bitShapes, m_bitShapeSize, reference) || sprite >= m_texels.GetCount())
+		return false;
+
+	bitshape_t bitShape;
+	memcpy(&bitShape, m_bitShapes + reference.bitShapeOffset, sizeof(bitShape));
+
+	if (bitShape.xOffsetMax < bitShape.xOffsetMin || bitShape.yOffsetMax < bitShape.yOffsetMin || bitShape.xOffsetMax > SPRITE_SIZE || bitShape.yOffsetMax > SPRITE_SIZE)
+		return false;
+
+	vector<SpriteSpan> spans;
+	BuildSpans(bitShape, m_bitShapes + reference.bitShapeOffset + sizeof(bitShape), spans);
+
+	// Spans are in texel order, so the last one ends the texels used.
+	const TexelRange &range = m_texels.GetRange(sprite);
+
+	if (!spans.empty() && spans.back().texel + spans.back().length > range.size * 2u)
+		return false;
+
+	uint32_t palette[PALETTE_COLOR_COUNT];
+	ExpandPalette(m_textureCache.GetPalettes() + reference.paletteOffset, palette, PALETTE_COLOR_COUNT);
+
+	spriteOut.xOffset = bitShape.xOffsetMin;
+	spriteOut.yOffset = bitShape.yOffsetMin;
+	spriteOut.image.width = bitShape.xOffsetMax - bitShape.xOffsetMin;
+	spriteOut.image.height = bitShape.yOffsetMax - bitShape.yOffsetMin;
+	spriteOut.image.pixels.assign(spriteOut.image.width * spriteOut.image.height, 0);
+
+	const uint8_t *texels = m_texels.GetData() + range.offset;
+
+	for (const SpriteSpan &span : spans)
+	{
+		uint32_t *pixel = &spriteOut.image.pixels[span.y * spriteOut.image.width + span.x];
+
+		for (unsigned int i = span.texel, end = span.texel + span.length; i < end; i++)
+			*pixel++ = palette[(texels[i / 2] >> ((i & 1) * 4)) & 0xF];
+	}
+
+	return true;
+}
+
+bool CSpriteDecoder::DecodeThing(unsigned int thing, Sprite &spriteOut) const
+{
+	const mappings_t *mappings = m_textureCache.GetMappings();
+
+	if (mappings == nullptr || thing >= mappings->thingMappingCount)
+		return false;
+
+	return Decode(mappings->thingMappings[thing], spriteOut);
+}
+
+void CSpriteDecoder::BuildSpans(const bitshape_t &bitShape, const uint8_t *mask, vector<SpriteSpan> &spans)
+{
+	unsigned int width = bitShape.xOffsetMax - bitShape.xOffsetMin;
+	unsigned int height = bitShape.yOffsetMax - bitShape.yOffsetMin;
+	unsigned int bitCount = bitShape.byteCount * 8u;
+	unsigned int bit = 0;
+	unsigned int texel = 0;
+
+	spans.clear();
+
+	for (unsigned int y = 0; y < height; y++)
+	{
+		unsigned int x = 0;
+		unsigned int runStart = 0;
+		bool inRun = false;
+
+		while (x < width && bit < bitCount)
+		{
+			// Whole mask bytes that are fully transparent or fully opaque are
+			// consumed eight pixels at a time.
+			if ((bit & 7) == 0 && width - x >= 8 && bitCount - bit >= 8)
+			{
+				uint8_t byte = mask[bit >> 3];
+
+				if (byte == 0x00 || byte == 0xFF)
+				{
+					bool opaque = (byte == 0xFF);
+
+					if (opaque && !inRun)
+					{
+						runStart = x;
+						inRun = true;
+					}
+					else if (!opaque && inRun)
+					{
+						spans.push_back({ uint8_t(runStart), uint8_t(y), uint8_t(x - runStart), uint16_t(texel) });
+						texel += x - runStart;
+						inRun = false;
+					}
+
+					x += 8;
+					bit += 8;
+
+					continue;
+				}
+			}
+
+			bool opaque = ((mask[bit >> 3] >> (bit & 7)) & 1) != 0;
+
+			if (opaque && !inRun)
+			{
+				runStart = x;
+				inRun = true;
+			}
+			else if (!opaque && inRun)
+			{
+				spans.push_back({ uint8_t(runStart), uint8_t(y), uint8_t(x - runStart), uint16_t(texel) });
+				texel += x - runStart;
+				inRun = false;
+			}
+
+			x++;
+			bit++;
+		}
+
+		if (inRun)
+		{
+			spans.push_back({ uint8_t(runStart), uint8_t(y), uint8_t(x - runStart), uint16_t(texel) });
+			texel += x - runStart;
+		}
+	}
+}
\ No newline at end of file
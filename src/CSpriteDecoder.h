@@ -0,0 +1,66 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CSPRITEDECODER_H__
+#define __CSPRITEDECODER_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "CTexelStore.h"
+#include "CTextureCache.h"
+#include "doomrpg_data.h"
+
+#define SPRITE_SIZE	64
+
+// Horizontal run of opaque pixels. texel is the index of the first pixel's
+// texel in the sprite's texel stream.
+struct SpriteSpan
+{
+	uint8_t x;
+	uint8_t y;
+	uint8_t length;
+	uint16_t texel;
+};
+
+// Sprite cropped to its bit shape bounds. xOffset and yOffset give the
+// position of the image inside the SPRITE_SIZE x SPRITE_SIZE frame.
+struct Sprite
+{
+	int xOffset;
+	int yOffset;
+	Image image;
+};
+
+// A bit shape is a bitshape_t header followed by byteCount bytes of
+// opacity mask, one bit per pixel of the bounding box, least significant
+// bit first. The opaque pixels' 4-bit texels are stored back to back in
+// the sprite's range of the texel store.
+class CSpriteDecoder
+{
+public:
+	CSpriteDecoder(CTextureCache &textureCache, const uint8_t *bitShapes, size_t bitShapeSize, const CTexelStore &texels) : m_textureCache(textureCache), m_bitShapes(bitShapes), m_bitShapeSize(bitShapeSize), m_texels(texels) {}
+
+	bool Decode(unsigned int sprite, Sprite &spriteOut) const;
+	bool DecodeThing(unsigned int thing, Sprite &spriteOut) const;
+
+	static void BuildSpans(const bitshape_t &bitShape, const uint8_t *mask, std::vector<SpriteSpan> &spans);
+
+private:
+	CTextureCache &m_textureCache;
+	const uint8_t *m_bitShapes;
+	size_t m_bitShapeSize;
+	const CTexelStore &m_texels;
+};
+
+#endif
\ No newline at end of file
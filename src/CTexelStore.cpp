@@ -0,0 +1,178 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "CTexelStore.h"
+#include "CTextureCache.h"
+
+using namespace std;
+
+#ifndef _WIN32
+static size_t GetPageSize()
+{
+	static const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+
+	return pageSize;
+}
+#endif
+
+bool CTexelStore::Open(const char *filename)
+{
+	if (!m_file.Open(filename) || m_file.GetSize() < sizeof(uint32_t))
+		return false;
+
+	uint32_t length;
+	memcpy(&length, m_file.GetData(), sizeof(length));
+
+	m_data = m_file.GetData() + sizeof(length);
+	m_size = min(size_t(length), m_file.GetSize() - sizeof(length));
+
+	return true;
+}
+
+void CTexelStore::Attach(const uint8_t *data, size_t size)
+{
+	m_file.Close();
+	m_data = data;
+	m_size = size;
+}
+
+void CTexelStore::BuildTextureIndex(const mappings_t *mappings)
+{
+	m_ranges.assign(mappings->textureMappingCount, { 0, 0 });
+
+	// Ranges that run past the end of the texels are left empty.
+	for (uint32_t i = 0; i < mappings->textureMappingCount; i++)
+	{
+		uint32_t offset = mappings->textureMappings[i].texture;
+
+		if (offset <= m_size && TEXTURE_SIZE * TEXTURE_SIZE / 2 <= m_size - offset)
+			m_ranges[i] = { offset, TEXTURE_SIZE * TEXTURE_SIZE / 2 };
+	}
+}
+
+void CTexelStore::BuildSpriteIndex(const mappings_t *mappings, const uint8_t *bitShapes, size_t bitShapeSize)
+{
+	m_ranges.assign(mappings->spriteMappingCount, { 0, 0 });
+
+	// A sprite has one 4-bit texel for every opaque pixel of its bit shape.
+	// Bit shapes that run past the end of their data are left empty too.
+	for (uint32_t i = 0; i < mappings->spriteMappingCount; i++)
+	{
+		uint32_t offset = mappings->spriteMappings[i].sprite;
+
+		if (offset > bitShapeSize || sizeof(bitshape_t) > bitShapeSize - offset)
+			continue;
+
+		const uint8_t *bitShape = bitShapes + offset;
+
+		bitshape_t header;
+		memcpy(&header, bitShape, sizeof(header));
+
+		if (header.byteCount > bitShapeSize - offset - sizeof(header))
+			continue;
+
+		const uint8_t *mask = bitShape + sizeof(header);
+		uint32_t opaqueCount = 0;
+
+		for (unsigned int j = 0; j < header.byteCount; j++)
+		{
+			for (uint8_t byte = mask[j]; byte != 0; byte &= byte - 1)
+				opaqueCount++;
+		}
+
+		uint32_t size = (opaqueCount + 1) / 2;
+
+		if (header.spriteTexelsOffset <= m_size && size <= m_size - header.spriteTexelsOffset)
+			m_ranges[i] = { header.spriteTexelsOffset, size };
+	}
+}
+
+void CTexelStore::SetReferenced(const vector<unsigned int> &ids)
+{
+	vector<unsigned int> referenced(ids);
+	sort(referenced.begin(), referenced.end());
+	referenced.erase(unique(referenced.begin(), referenced.end()), referenced.end());
+
+	if (referenced == m_referenced)
+		return;
+
+	for (unsigned int id : referenced)
+	{
+		if (id < m_ranges.size() && !binary_search(m_referenced.begin(), m_referenced.end(), id))
+			Prefetch(m_ranges[id]);
+	}
+
+	m_referenced.swap(referenced);
+}
+
+size_t CTexelStore::GetResidentSize(unsigned int id) const
+{
+	if (id >= m_ranges.size() || m_ranges[id].size == 0)
+		return 0;
+
+	const TexelRange &range = m_ranges[id];
+
+#ifndef _WIN32
+	size_t pageSize = GetPageSize();
+	uintptr_t start = uintptr_t(m_data + range.offset), end = start + range.size;
+	uintptr_t firstPage = start & ~uintptr_t(pageSize - 1);
+	size_t pageCount = (end - firstPage + pageSize - 1) / pageSize;
+
+#if defined(__APPLE__)
+	vector<char> residency(pageCount);
+#else
+	vector<unsigned char> residency(pageCount);
+#endif
+
+	if (mincore((void *)firstPage, pageCount * pageSize, residency.data()) == 0)
+	{
+		size_t residentSize = 0;
+
+		for (size_t i = 0; i < pageCount; i++)
+		{
+			if ((residency[i] & 1) == 0)
+				continue;
+
+			uintptr_t pageStart = max(firstPage + i * pageSize, start);
+			uintptr_t pageEnd = min(firstPage + (i + 1) * pageSize, end);
+			residentSize += pageEnd - pageStart;
+		}
+
+		return residentSize;
+	}
+#endif
+
+	return (binary_search(m_referenced.begin(), m_referenced.end(), id) ? range.size : 0);
+}
+
+void CTexelStore::Prefetch(const TexelRange &range) const
+{
+	if (range.size == 0)
+		return;
+
+#ifndef _WIN32
+	size_t pageSize = GetPageSize();
+	uintptr_t start = uintptr_t(m_data + range.offset) & ~uintptr_t(pageSize - 1);
+	uintptr_t end = uintptr_t(m_data + range.offset) + range.size;
+
+	madvise((void *)start, end - start, MADV_WILLNEED);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CTEXELSTORE_H__
+#define __CTEXELSTORE_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "CMappedFile.h"
+#include "doomrpg_data.h"
+
+struct TexelRange
+{
+	uint32_t offset;
+	uint32_t size;
+};
+
+// Texel data left in a read-only mapping instead of being read whole, so
+// that only the pages holding textures that are actually drawn are ever
+// read from disk. The index gives each texture's or sprite's range of
+// texels. Referenced textures are prefetched as maps come to use them.
+class CTexelStore
+{
+public:
+	CTexelStore() : m_data(nullptr), m_size(0) {}
+
+	// Maps a texel file, which starts with the length of its texels.
+	bool Open(const char *filename);
+
+	// Uses texels that are already in memory, such as a pack's section.
+	void Attach(const uint8_t *data, size_t size);
+
+	const uint8_t *GetData() const { return m_data; }
+	size_t GetSize() const { return m_size; }
+
+	void BuildTextureIndex(const mappings_t *mappings);
+	void BuildSpriteIndex(const mappings_t *mappings, const uint8_t *bitShapes, size_t bitShapeSize);
+
+	unsigned int GetCount() const { return (unsigned int)m_ranges.size(); }
+	const TexelRange &GetRange(unsigned int id) const { return m_ranges[id]; }
+
+	// Asks for the pages of ids that were not referenced before to be read
+	// ahead. ids need not be sorted.
+	void SetReferenced(const std::vector<unsigned int> &ids);
+	const std::vector<unsigned int> &GetReferenced() const { return m_referenced; }
+
+	// Bytes of the range that are in memory right now. Where residency
+	// cannot be queried, referenced ranges count as resident.
+	size_t GetResidentSize(unsigned int id) const;
+
+private:
+	CTexelStore(const CTexelStore &) = delete;
+	CTexelStore &operator=(const CTexelStore &) = delete;
+
+	void Prefetch(const TexelRange &range) const;
+
+	CMappedFile m_file;
+	const uint8_t *m_data;
+	size_t m_size;
+	std::vector<TexelRange> m_ranges;
+	std::vector<unsigned int> m_referenced;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,228 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+#include "CTexelStore.h"
+#include "CTextureCache.h"
+
+using namespace std;
+
+void ExpandPalette(const uint16_t *colors, uint32_t *pixels, size_t count)
+{
+	size_t i = 0;
+
+#ifdef USE_SSE2
+	const __m128i redMask = _mm_set1_epi16(0x1F);
+	const __m128i greenMask = _mm_set1_epi16(0x3F);
+	const __m128i blueMask = _mm_set1_epi16(0x1F);
+	const __m128i alpha = _mm_set1_epi16(0xFF);
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i color = _mm_loadu_si128((const __m128i *)(colors + i));
+
+		__m128i r = _mm_and_si128(_mm_srli_epi16(color, 11), redMask);
+		__m128i g = _mm_and_si128(_mm_srli_epi16(color, 5), greenMask);
+		__m128i b = _mm_and_si128(color, blueMask);
+
+		r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+		g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+		b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+		// RGBA8888 is R << 24 | G << 16 | B << 8 | A, so the low half of each
+		// pixel is B << 8 | A and the high half is R << 8 | G.
+		__m128i low = _mm_or_si128(_mm_slli_epi16(b, 8), alpha);
+		__m128i high = _mm_or_si128(_mm_slli_epi16(r, 8), g);
+
+		_mm_storeu_si128((__m128i *)(pixels + i), _mm_unpacklo_epi16(low, high));
+		_mm_storeu_si128((__m128i *)(pixels + i + 4), _mm_unpackhi_epi16(low, high));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		uint32_t r = (colors[i] >> 11) & 0x1F;
+		uint32_t g = (colors[i] >> 5) & 0x3F;
+		uint32_t b = colors[i] & 0x1F;
+
+		r = (r << 3) | (r >> 2);
+		g = (g << 2) | (g >> 4);
+		b = (b << 3) | (b >> 2);
+
+		pixels[i] = (r << 24) | (g << 16) | (b << 8) | 0xFF;
+	}
+}
+
+bool CTextureCache::ResolveTexture(unsigned int texture, TexelReference &reference) const
+{
+	if (m_mappings == nullptr || texture >= m_mappings->textureMappingCount || texture >= m_texels.GetCount())
+		return false;
+
+	const TexelRange &range = m_texels.GetRange(texture);
+	uint32_t paletteOffset = m_mappings->textureMappings[texture].palette;
+
+	if (range.size < TEXTURE_SIZE * TEXTURE_SIZE / 2 || !IsPaletteValid(paletteOffset))
+		return false;
+
+	reference.texelOffset = range.offset;
+	reference.paletteOffset = paletteOffset;
+	reference.bitShapeOffset = 0;
+
+	return true;
+}
+
+// The sprite's texels are in another store, so only its bit shape and
+// palette are checked here.
+bool CTextureCache::ResolveSprite(unsigned int sprite, const uint8_t *bitShapes, size_t bitShapeSize, TexelReference &reference) const
+{
+	if (m_mappings == nullptr || bitShapes == nullptr || sprite >= m_mappings->spriteMappingCount)
+		return false;
+
+	uint32_t bitShapeOffset = m_mappings->spriteMappings[sprite].sprite;
+	uint32_t paletteOffset = m_mappings->spriteMappings[sprite].palette;
+
+	if (bitShapeOffset > bitShapeSize || sizeof(bitshape_t) > bitShapeSize - bitShapeOffset || !IsPaletteValid(paletteOffset))
+		return false;
+
+	bitshape_t bitShape;
+	memcpy(&bitShape, bitShapes + bitShapeOffset, sizeof(bitShape));
+
+	if (bitShape.byteCount > bitShapeSize - bitShapeOffset - sizeof(bitShape))
+		return false;
+
+	reference.texelOffset = bitShape.spriteTexelsOffset;
+	reference.paletteOffset = paletteOffset;
+	reference.bitShapeOffset = bitShapeOffset;
+
+	return true;
+}
+
+bool CTextureCache::ResolveWallTexture(unsigned int wallTexture, unsigned int &texture) const
+{
+	if (m_mappings == nullptr || wallTexture >= m_mappings->wallMappingCount)
+		return false;
+
+	texture = m_mappings->wallMappings[wallTexture];
+
+	return true;
+}
+
+shared_ptr<const Image> CTextureCache::GetTexture(unsigned int texture)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+
+		auto entry = m_index.find(texture);
+
+		if (entry != m_index.end())
+		{
+			m_entries.splice(m_entries.begin(), m_entries, entry->second);
+			m_hitCount++;
+
+			return entry->second->image;
+		}
+	}
+
+	TexelReference reference;
+
+	if (!ResolveTexture(texture, reference))
+		return nullptr;
+
+	shared_ptr<const Image> image = DecodeTexture(reference);
+
+	lock_guard<mutex> lock(m_mutex);
+
+	auto entry = m_index.find(texture);
+
+	if (entry != m_index.end())
+		return entry->second->image;
+
+	m_entries.push_front({ texture, image });
+	m_index[texture] = m_entries.begin();
+	m_memoryUsage += image->pixels.size() * sizeof(uint32_t);
+	m_missCount++;
+
+	Evict();
+
+	return image;
+}
+
+shared_ptr<const Image> CTextureCache::GetWallTexture(unsigned int wallTexture)
+{
+	unsigned int texture;
+
+	if (!ResolveWallTexture(wallTexture, texture))
+		return nullptr;
+
+	return GetTexture(texture);
+}
+
+void CTextureCache::Clear()
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	m_entries.clear();
+	m_index.clear();
+	m_memoryUsage = 0;
+}
+
+void CTextureCache::SetBudget(size_t budget)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	m_budget = budget;
+
+	Evict();
+}
+
+shared_ptr<const Image> CTextureCache::DecodeTexture(const TexelReference &reference) const
+{
+	shared_ptr<Image> image = make_shared<Image>();
+	image->width = TEXTURE_SIZE;
+	image->height = TEXTURE_SIZE;
+	image->pixels.resize(TEXTURE_SIZE * TEXTURE_SIZE);
+
+	uint32_t palette[PALETTE_COLOR_COUNT];
+	ExpandPalette(m_palettes + reference.paletteOffset, palette, PALETTE_COLOR_COUNT);
+
+	// Texels are 4 bits each, two per byte with the low nibble first.
+	const uint8_t *texels = m_texels.GetData() + reference.texelOffset;
+	uint32_t *pixels = image->pixels.data();
+
+	for (unsigned int i = 0; i < TEXTURE_SIZE * TEXTURE_SIZE / 2; i++)
+	{
+		pixels[i * 2] = palette[texels[i] & 0xF];
+		pixels[i * 2 + 1] = palette[texels[i] >> 4];
+	}
+
+	return image;
+}
+
+void CTextureCache::Evict()
+{
+	// Always keep the most recently used entry, even if it alone exceeds the
+	// budget.
+	while (m_memoryUsage > m_budget && m_entries.size() > 1)
+	{
+		const Entry &entry = m_entries.back();
+		m_memoryUsage -= entry.image->pixels.size() * sizeof(uint32_t);
+		m_index.erase(entry.texture);
+		m_entries.pop_back();
+	}
+}
\ No newline at end of file
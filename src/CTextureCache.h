@@ -0,0 +1,106 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CTEXTURECACHE_H__
+#define __CTEXTURECACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "doomrpg_data.h"
+
+class CTexelStore;
+
+#define TEXTURE_SIZE			64
+#define PALETTE_COLOR_COUNT		16
+
+// Decoded image in SDL_PIXELFORMAT_RGBA8888.
+struct Image
+{
+	int width;
+	int height;
+	std::vector<uint32_t> pixels;
+};
+
+// Offsets of an image in the texel, palette and, for sprites, bit shape
+// data.
+struct TexelReference
+{
+	uint32_t texelOffset;
+	uint32_t paletteOffset;
+	uint32_t bitShapeOffset;
+};
+
+// Expands RGB565 palette entries to RGBA8888.
+void ExpandPalette(const uint16_t *colors, uint32_t *pixels, size_t count);
+
+// Decodes wall textures from the texel and palette data on first use and
+// keeps them in a least recently used cache limited to budget bytes. The
+// cache does not own the mapping, texel or palette data. Textures are
+// read from the texel store's ranges, and references that reach past the
+// end of the data they point into fail to resolve.
+class CTextureCache
+{
+public:
+	CTextureCache(const mappings_t *mappings, const CTexelStore &texels, const uint16_t *palettes, size_t paletteSize, size_t budget = 16 * 1024 * 1024) : m_mappings(mappings), m_texels(texels), m_palettes(palettes), m_paletteSize(paletteSize), m_budget(budget), m_memoryUsage(0), m_hitCount(0), m_missCount(0) {}
+
+	bool ResolveTexture(unsigned int texture, TexelReference &reference) const;
+	bool ResolveSprite(unsigned int sprite, const uint8_t *bitShapes, size_t bitShapeSize, TexelReference &reference) const;
+	bool ResolveWallTexture(unsigned int wallTexture, unsigned int &texture) const;
+
+	std::shared_ptr<const Image> GetTexture(unsigned int texture);
+	std::shared_ptr<const Image> GetWallTexture(unsigned int wallTexture);
+
+	void Clear();
+
+	size_t GetBudget() const { return m_budget; }
+	void SetBudget(size_t budget);
+
+	size_t GetMemoryUsage() const { return m_memoryUsage; }
+	unsigned int GetHitCount() const { return m_hitCount; }
+	unsigned int GetMissCount() const { return m_missCount; }
+
+	const mappings_t *GetMappings() const { return m_mappings; }
+	const uint16_t *GetPalettes() const { return m_palettes; }
+
+private:
+	struct Entry
+	{
+		unsigned int texture;
+		std::shared_ptr<const Image> image;
+	};
+
+	std::shared_ptr<const Image> DecodeTexture(const TexelReference &reference) const;
+	void Evict();
+
+	bool IsPaletteValid(uint32_t paletteOffset) const { return (paletteOffset <= m_paletteSize / sizeof(uint16_t) && PALETTE_COLOR_COUNT <= m_paletteSize / sizeof(uint16_t) - paletteOffset); }
+
+	const mappings_t *m_mappings;
+	const CTexelStore &m_texels;
+	const uint16_t *m_palettes;
+	size_t m_paletteSize;
+	size_t m_budget;
+	size_t m_memoryUsage;
+	unsigned int m_hitCount;
+	unsigned int m_missCount;
+	std::list<Entry> m_entries;
+	std::unordered_map<unsigned int, std::list<Entry>::iterator> m_index;
+	std::mutex m_mutex;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <algorithm>
+
+#include "CThreadPool.h"
+
+using namespace std;
+
+CThreadPool::CThreadPool(unsigned int threadCount) : m_running(true)
+{
+	if (threadCount == 0)
+		threadCount = max(thread::hardware_concurrency(), 2u) - 1;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		m_threads.emplace_back(&CThreadPool::WorkerThread, this);
+}
+
+CThreadPool::~CThreadPool()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_taskAvailable.notify_all();
+
+	for (thread &worker : m_threads)
+		worker.join();
+}
+
+void CThreadPool::ParallelFor(unsigned int count, const function<void(unsigned int, unsigned int)> &callback)
+{
+	if (count == 0)
+		return;
+
+	// Helpers queued after the last range was claimed find nothing left and
+	// never touch callback, so only the batch has to outlive this call.
+	unsigned int rangeCount = min(count, (GetThreadCount() + 1) * 4);
+
+	shared_ptr<Batch> batch = make_shared<Batch>();
+	batch->callback = &callback;
+	batch->count = count;
+	batch->rangeSize = (count + rangeCount - 1) / rangeCount;
+	batch->rangeCount = (count + batch->rangeSize - 1) / batch->rangeSize;
+	batch->nextRange = 0;
+	batch->remaining = batch->rangeCount;
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+
+		for (unsigned int i = 0, helperCount = min(GetThreadCount(), batch->rangeCount - 1); i < helperCount; i++)
+			m_tasks.push_back([this, batch]() { RunRanges(*batch); });
+	}
+
+	m_taskAvailable.notify_all();
+
+	RunRanges(*batch);
+
+	unique_lock<mutex> lock(m_mutex);
+	m_taskFinished.wait(lock, [&batch]() { return (batch->remaining == 0); });
+}
+
+void CThreadPool::RunRanges(Batch &batch)
+{
+	for (unsigned int range = batch.nextRange++; range < batch.rangeCount; range = batch.nextRange++)
+	{
+		unsigned int start = range * batch.rangeSize;
+		(*batch.callback)(start, min(start + batch.rangeSize, batch.count));
+
+		lock_guard<mutex> lock(m_mutex);
+
+		if (--batch.remaining == 0)
+			m_taskFinished.notify_all();
+	}
+}
+
+void CThreadPool::WorkerThread()
+{
+	unique_lock<mutex> lock(m_mutex);
+
+	while (m_running)
+	{
+		if (!RunTask(lock))
+			m_taskAvailable.wait(lock);
+	}
+}
+
+bool CThreadPool::RunTask(unique_lock<mutex> &lock)
+{
+	if (m_tasks.empty())
+		return false;
+
+	function<void()> task = move(m_tasks.front());
+	m_tasks.pop_front();
+
+	lock.unlock();
+	task();
+	lock.lock();
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CTHREADPOOL_H__
+#define __CTHREADPOOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CThreadPool
+{
+public:
+	CThreadPool(unsigned int threadCount = 0);
+	~CThreadPool();
+
+	// Splits [0, count) into ranges and calls callback(start, end) for each
+	// of them on the workers. The calling thread takes ranges of the same
+	// call, never other queued tasks, so callers sharing the pool do not
+	// stall each other, and returns once every range has been processed.
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int, unsigned int)> &callback);
+
+	// Queues function to run on a worker and returns a future for its
+	// result. The calling thread does not wait.
+	template <class Function>
+	auto Submit(Function function) -> std::future<decltype(function())>;
+
+	unsigned int GetThreadCount() const { return (unsigned int)m_threads.size(); }
+
+private:
+	CThreadPool(const CThreadPool &) = delete;
+	CThreadPool &operator=(const CThreadPool &) = delete;
+
+	// Ranges of one ParallelFor call. Ranges are claimed through nextRange,
+	// and remaining is guarded by m_mutex.
+	struct Batch
+	{
+		const std::function<void(unsigned int, unsigned int)> *callback;
+		unsigned int count;
+		unsigned int rangeSize;
+		unsigned int rangeCount;
+		std::atomic<unsigned int> nextRange;
+		unsigned int remaining;
+	};
+
+	void WorkerThread();
+	bool RunTask(std::unique_lock<std::mutex> &lock);
+	void RunRanges(Batch &batch);
+
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	std::condition_variable m_taskFinished;
+	bool m_running;
+};
+
+template <class Function>
+auto CThreadPool::Submit(Function function) -> std::future<decltype(function())>
+{
+	// std::function needs a copyable target, so the task is shared.
+	std::shared_ptr<std::packaged_task<decltype(function())()>> task = std::make_shared<std::packaged_task<decltype(function())()>>(std::move(function));
+	std::future<decltype(function())> future = task->get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back([task]() { (*task)(); });
+	}
+
+	m_taskAvailable.notify_one();
+
+	return future;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,175 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <cstdlib>
+
+#include "CValidationChecks.h"
+
+using namespace std;
+
+// True only when the segments cross at a point inside both of them, so
+// edges that share an end point or touch along a side do not count.
+static bool SegmentsCross(const Vertex &a1, const Vertex &a2, const Vertex &b1, const Vertex &b2)
+{
+	int64_t o1 = Orientation(a1, a2, b1.x, b1.y);
+	int64_t o2 = Orientation(a1, a2, b2.x, b2.y);
+	int64_t o3 = Orientation(b1, b2, a1.x, a1.y);
+	int64_t o4 = Orientation(b1, b2, a2.x, a2.y);
+
+	return (((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)) && ((o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0)));
+}
+
+// The point is in half units, so that points between whole units can be
+// tested exactly.
+static bool PolygonContainsPoint(const Vertex *points, unsigned int pointCount, int64_t x, int64_t y)
+{
+	bool oddNodes = false;
+
+	for (unsigned int i = 0, j = pointCount - 1; i < pointCount; j = i++)
+	{
+		int64_t x1 = points[i].x * 2, y1 = points[i].y * 2;
+		int64_t x2 = points[j].x * 2, y2 = points[j].y * 2;
+
+		if (x1 > x && x2 > x)
+			continue;
+
+		int64_t side = (x2 - x1) * (y - y1) - (y2 - y1) * (x - x1);
+
+		if (y1 < y && y2 >= y)
+			oddNodes ^= (side < 0);
+		else if (y2 < y && y1 >= y)
+			oddNodes ^= (side > 0);
+	}
+
+	return oddNodes;
+}
+
+// A point half a unit inside the middle of the first edge of a clockwise
+// outline, in half units.
+static void InteriorPoint(const Vertex *points, unsigned int pointCount, int64_t &x, int64_t &y)
+{
+	const Vertex &vertex1 = points[0];
+	const Vertex &vertex2 = points[1 % pointCount];
+	int64_t dx = int64_t(vertex2.x) - vertex1.x, dy = int64_t(vertex2.y) - vertex1.y;
+
+	x = int64_t(vertex1.x) + vertex2.x;
+	y = int64_t(vertex1.y) + vertex2.y;
+
+	if (llabs(dx) >= llabs(dy))
+		y += (dx > 0 ? 1 : -1);
+	else
+		x += (dy > 0 ? -1 : 1);
+}
+
+void CZeroLengthLineCheck::Check(const ValidationData &data, const unsigned int *indices, unsigned int count, vector<ValidationIssue> &issues) const
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const ValidationLine &line = data.lines[indices[i]];
+
+		if (line.x1 == line.x2 && line.y1 == line.y2)
+			issues.push_back({ GetName(), ELEMENT_LINE, line.handle, ELEMENT_NONE, 0, "line has zero length" });
+	}
+}
+
+void CSectorWindingCheck::Check(const ValidationData &data, const unsigned int *indices, unsigned int count, vector<ValidationIssue> &issues) const
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const ValidationSector &sector = data.sectors[indices[i]];
+		const Vertex *points = &data.points[sector.firstPoint];
+		int64_t sum = 0;
+
+		// Same sum as SectorIsClockwise.
+		for (unsigned int j = 0; j < sector.pointCount; j++)
+		{
+			const Vertex &vertex1 = points[j];
+			const Vertex &vertex2 = points[(j + 1) % sector.pointCount];
+			sum += (int64_t(vertex2.x) - vertex1.x) * (int64_t(vertex2.y) + vertex1.y);
+		}
+
+		if (sum >= 0)
+			issues.push_back({ GetName(), ELEMENT_SECTOR, sector.handle, ELEMENT_NONE, 0, "sector is not wound clockwise" });
+	}
+}
+
+void CSectorSelfIntersectionCheck::Check(const ValidationData &data, const unsigned int *indices, unsigned int count, vector<ValidationIssue> &issues) const
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const ValidationSector &sector = data.sectors[indices[i]];
+		const Vertex *points = &data.points[sector.firstPoint];
+		bool intersects = false;
+
+		for (unsigned int j = 0; j < sector.pointCount && !intersects; j++)
+		{
+			for (unsigned int k = j + 2; k < sector.pointCount && !intersects; k++)
+			{
+				if (j == 0 && k == sector.pointCount - 1)
+					continue;
+
+				intersects = SegmentsCross(points[j], points[j + 1], points[k], points[(k + 1) % sector.pointCount]);
+			}
+		}
+
+		if (intersects)
+			issues.push_back({ GetName(), ELEMENT_SECTOR, sector.handle, ELEMENT_NONE, 0, "sector outline intersects itself" });
+	}
+}
+
+void CSectorOverlapCheck::Check(const ValidationData &data, const unsigned int *indices, unsigned int count, vector<ValidationIssue> &issues) const
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const ValidationSector &sector = data.sectors[indices[i]];
+		const Vertex *points = &data.points[sector.firstPoint];
+
+		if (sector.pointCount < 3)
+			continue;
+
+		for (const ValidationSector &otherSector : data.sectors)
+		{
+			if (&otherSector == &sector || otherSector.pointCount < 3)
+				continue;
+
+			if (sector.maxX < otherSector.minX || otherSector.maxX < sector.minX || sector.maxY < otherSector.minY || otherSector.maxY < sector.minY)
+				continue;
+
+			const Vertex *otherPoints = &data.points[otherSector.firstPoint];
+			int64_t interiorX, interiorY, otherInteriorX, otherInteriorY;
+			InteriorPoint(points, sector.pointCount, interiorX, interiorY);
+			InteriorPoint(otherPoints, otherSector.pointCount, otherInteriorX, otherInteriorY);
+			bool overlaps = PolygonContainsPoint(otherPoints, otherSector.pointCount, interiorX, interiorY) || PolygonContainsPoint(points, sector.pointCount, otherInteriorX, otherInteriorY);
+
+			for (unsigned int j = 0; j < sector.pointCount && !overlaps; j++)
+			{
+				for (unsigned int k = 0; k < otherSector.pointCount && !overlaps; k++)
+					overlaps = SegmentsCross(points[j], points[(j + 1) % sector.pointCount], otherPoints[k], otherPoints[(k + 1) % otherSector.pointCount]);
+			}
+
+			if (overlaps)
+				issues.push_back({ GetName(), ELEMENT_SECTOR, sector.handle, ELEMENT_SECTOR, otherSector.handle, "sector overlaps sector " + to_string(otherSector.handle) });
+		}
+	}
+}
+
+void CThingBoundsCheck::Check(const ValidationData &data, const unsigned int *indices, unsigned int count, vector<ValidationIssue> &issues) const
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const ValidationThing &thing = data.things[indices[i]];
+
+		if (thing.x < data.minX || thing.y < data.minY || thing.x > data.maxX || thing.y > data.maxY)
+			issues.push_back({ GetName(), ELEMENT_THING, thing.handle, ELEMENT_NONE, 0, "thing is outside the grid" });
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CVALIDATIONCHECKS_H__
+#define __CVALIDATIONCHECKS_H__
+
+#include "CValidator.h"
+
+class CZeroLengthLineCheck : public CValidationCheck
+{
+public:
+	const char *GetName() const override { return "zero-length line"; }
+	ElementType GetElementType() const override { return ELEMENT_LINE; }
+	void Check(const ValidationData &data, const unsigned int *indices, unsigned int count, std::vector<ValidationIssue> &issues) const override;
+};
+
+class CSectorWindingCheck : public CValidationCheck
+{
+public:
+	const char *GetName() const override { return "sector winding"; }
+	ElementType GetElementType() const override { return ELEMENT_SECTOR; }
+	void Check(const ValidationData &data, const unsigned int *indices, unsigned int count, std::vector<ValidationIssue> &issues) const override;
+};
+
+class CSectorSelfIntersectionCheck : public CValidationCheck
+{
+public:
+	const char *GetName() const override { return "self-intersecting sector"; }
+	ElementType GetElementType() const override { return ELEMENT_SECTOR; }
+	void Check(const ValidationData &data, const unsigned int *indices, unsigned int count, std::vector<ValidationIssue> &issues) const override;
+};
+
+// Reports each overlapping pair once for each of the two sectors.
+class CSectorOverlapCheck : public CValidationCheck
+{
+public:
+	const char *GetName() const override { return "overlapping sectors"; }
+	ElementType GetElementType() const override { return ELEMENT_SECTOR; }
+	void Check(const ValidationData &data, const unsigned int *indices, unsigned int count, std::vector<ValidationIssue> &issues) const override;
+};
+
+class CThingBoundsCheck : public CValidationCheck
+{
+public:
+	const char *GetName() const override { return "thing out of bounds"; }
+	ElementType GetElementType() const override { return ELEMENT_THING; }
+	void Check(const ValidationData &data, const unsigned int *indices, unsigned int count, std::vector<ValidationIssue> &issues) const override;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+
+#include "CValidationChecks.h"
+#include "CValidator.h"
+
+using namespace std;
+
+void CValidator::AddDefaultChecks()
+{
+	AddCheck(unique_ptr<CValidationCheck>(new CZeroLengthLineCheck));
+	AddCheck(unique_ptr<CValidationCheck>(new CSectorWindingCheck));
+	AddCheck(unique_ptr<CValidationCheck>(new CSectorSelfIntersectionCheck));
+	AddCheck(unique_ptr<CValidationCheck>(new CSectorOverlapCheck));
+	AddCheck(unique_ptr<CValidationCheck>(new CThingBoundsCheck));
+}
+
+void CValidator::Validate(CMap &map, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY)
+{
+	ValidationData data;
+	BuildData(map, minX, minY, maxX, maxY, data);
+
+	m_issues.clear();
+
+	RunChecks(data, nullptr);
+}
+
+void CValidator::ValidateDirty(CMap &map, const DirtyHandles &dirty, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY)
+{
+	if (dirty.lines.empty() && dirty.sectors.empty() && dirty.things.empty())
+		return;
+
+	ValidationData data;
+	BuildData(map, minX, minY, maxX, maxY, data);
+
+	unordered_set<unsigned int> dirtyHandles[4];
+	dirtyHandles[ELEMENT_LINE].insert(dirty.lines.begin(), dirty.lines.end());
+	dirtyHandles[ELEMENT_SECTOR].insert(dirty.sectors.begin(), dirty.sectors.end());
+	dirtyHandles[ELEMENT_THING].insert(dirty.things.begin(), dirty.things.end());
+
+	// Every element that is dirty, had an issue with a dirty element, or
+	// now overlaps the bounds of a dirty sector is checked again.
+	unordered_set<unsigned int> recheckHandles[4] = { {}, dirtyHandles[ELEMENT_LINE], dirtyHandles[ELEMENT_SECTOR], dirtyHandles[ELEMENT_THING] };
+
+	for (const ValidationIssue &issue : m_issues)
+	{
+		if (issue.relatedType != ELEMENT_NONE && dirtyHandles[issue.relatedType].count(issue.relatedHandle) != 0)
+			recheckHandles[issue.type].insert(issue.handle);
+	}
+
+	for (const ValidationSector &sector : data.sectors)
+	{
+		if (dirtyHandles[ELEMENT_SECTOR].count(sector.handle) == 0)
+			continue;
+
+		for (const ValidationSector &otherSector : data.sectors)
+		{
+			if (sector.minX <= otherSector.maxX && otherSector.minX <= sector.maxX && sector.minY <= otherSector.maxY && otherSector.minY <= sector.maxY)
+				recheckHandles[ELEMENT_SECTOR].insert(otherSector.handle);
+		}
+	}
+
+	m_issues.erase(remove_if(m_issues.begin(), m_issues.end(), [&](const ValidationIssue &issue)
+	{
+		return (recheckHandles[issue.type].count(issue.handle) != 0);
+	}), m_issues.end());
+
+	vector<unsigned int> indices[4];
+
+	for (unsigned int i = 0; i < data.lines.size(); i++)
+	{
+		if (recheckHandles[ELEMENT_LINE].count(data.lines[i].handle) != 0)
+			indices[ELEMENT_LINE].push_back(i);
+	}
+
+	for (unsigned int i = 0; i < data.sectors.size(); i++)
+	{
+		if (recheckHandles[ELEMENT_SECTOR].count(data.sectors[i].handle) != 0)
+			indices[ELEMENT_SECTOR].push_back(i);
+	}
+
+	for (unsigned int i = 0; i < data.things.size(); i++)
+	{
+		if (recheckHandles[ELEMENT_THING].count(data.things[i].handle) != 0)
+			indices[ELEMENT_THING].push_back(i);
+	}
+
+	RunChecks(data, indices);
+}
+
+void CValidator::BuildData(CMap &map, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, ValidationData &data)
+{
+	CList<Line> *lines = map.GetLines();
+	CList<Sector> *sectors = map.GetSectors();
+	CList<Thing> *things = map.GetThings();
+
+	data.minX = minX;
+	data.minY = minY;
+	data.maxX = maxX;
+	data.maxY = maxY;
+
+	if (!lines->IsEmpty())
+	{
+		for (CNode<Line> *currentLine = lines->Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
+		{
+			if (currentLine->VisitNode() == 0)
+			{
+				const Line *line = currentLine->GetData();
+				data.lines.push_back({ line->vertex1->GetData()->x, line->vertex1->GetData()->y, line->vertex2->GetData()->x, line->vertex2->GetData()->y, line->handle });
+			}
+		}
+	}
+
+	if (!sectors->IsEmpty())
+	{
+		for (CNode<Sector> *currentSector = sectors->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+		{
+			const Sector *sector = currentSector->GetData();
+			CNode<Vertex> *currentVertex = sector->firstVertex;
+
+			data.sectors.push_back({ sector->minX, sector->minY, sector->maxX, sector->maxY, unsigned(data.points.size()), sector->vertexCount, sector->handle });
+
+			for (unsigned int vertexCount = sector->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+				data.points.push_back(*currentVertex->GetData());
+		}
+	}
+
+	if (!things->IsEmpty())
+	{
+		for (CNode<Thing> *currentThing = things->Head(); currentThing->GetData() != nullptr; currentThing = currentThing->Next())
+		{
+			if (currentThing->VisitNode() == 0)
+				data.things.push_back({ currentThing->GetData()->x, currentThing->GetData()->y, currentThing->GetData()->handle });
+		}
+	}
+}
+
+void CValidator::RunChecks(const ValidationData &data, const vector<unsigned int> *indices)
+{
+	vector<unsigned int> allIndices[4];
+
+	if (indices == nullptr)
+	{
+		const size_t counts[4] = { 0, data.lines.size(), data.sectors.size(), data.things.size() };
+
+		for (int type = ELEMENT_LINE; type <= ELEMENT_THING; type++)
+		{
+			allIndices[type].resize(counts[type]);
+
+			for (unsigned int i = 0; i < counts[type]; i++)
+				allIndices[type][i] = i;
+		}
+
+		indices = allIndices;
+	}
+
+	mutex issuesMutex;
+
+	for (const unique_ptr<CValidationCheck> &check : m_checks)
+	{
+		const vector<unsigned int> &checkIndices = indices[check->GetElementType()];
+
+		m_pool.ParallelFor((unsigned int)checkIndices.size(), [&](unsigned int start, unsigned int end)
+		{
+			vector<ValidationIssue> issues;
+			check->Check(data, &checkIndices[start], end - start, issues);
+
+			if (!issues.empty())
+			{
+				lock_guard<mutex> lock(issuesMutex);
+				m_issues.insert(m_issues.end(), issues.begin(), issues.end());
+			}
+		});
+	}
+
+	sort(m_issues.begin(), m_issues.end(), [](const ValidationIssue &issue1, const ValidationIssue &issue2)
+	{
+		if (issue1.type != issue2.type)
+			return issue1.type < issue2.type;
+
+		if (issue1.handle != issue2.handle)
+			return issue1.handle < issue2.handle;
+
+		return issue1.relatedHandle < issue2.relatedHandle;
+	});
+}
\ No newline at end of file
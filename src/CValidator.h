@@ -0,0 +1,118 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __CVALIDATOR_H__
+#define __CVALIDATOR_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CMap.h"
+#include "CThreadPool.h"
+
+enum ElementType
+{
+	ELEMENT_NONE,
+	ELEMENT_LINE,
+	ELEMENT_SECTOR,
+	ELEMENT_THING
+};
+
+struct ValidationIssue
+{
+	const char *check;
+	ElementType type;
+	unsigned int handle;
+	ElementType relatedType;
+	unsigned int relatedHandle;
+	std::string message;
+};
+
+struct ValidationLine
+{
+	int32_t x1;
+	int32_t y1;
+	int32_t x2;
+	int32_t y2;
+	unsigned int handle;
+};
+
+// points[firstPoint, firstPoint + pointCount) is the sector's outline.
+struct ValidationSector
+{
+	int32_t minX;
+	int32_t minY;
+	int32_t maxX;
+	int32_t maxY;
+	unsigned int firstPoint;
+	unsigned int pointCount;
+	unsigned int handle;
+};
+
+struct ValidationThing
+{
+	int32_t x;
+	int32_t y;
+	unsigned int handle;
+};
+
+// Flat copy of the map that checks can read from any thread.
+struct ValidationData
+{
+	std::vector<ValidationLine> lines;
+	std::vector<ValidationSector> sectors;
+	std::vector<Vertex> points;
+	std::vector<ValidationThing> things;
+	int32_t minX;
+	int32_t minY;
+	int32_t maxX;
+	int32_t maxY;
+};
+
+// A check looks at one kind of element. Check is called concurrently with
+// different index ranges, so it must not keep any state of its own.
+class CValidationCheck
+{
+public:
+	virtual ~CValidationCheck() {}
+
+	virtual const char *GetName() const = 0;
+	virtual ElementType GetElementType() const = 0;
+	virtual void Check(const ValidationData &data, const unsigned int *indices, unsigned int count, std::vector<ValidationIssue> &issues) const = 0;
+};
+
+class CValidator
+{
+public:
+	CValidator(CThreadPool &pool) : m_pool(pool) {}
+
+	void AddCheck(std::unique_ptr<CValidationCheck> check) { m_checks.push_back(std::move(check)); }
+	void AddDefaultChecks();
+
+	void Validate(CMap &map, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY);
+	void ValidateDirty(CMap &map, const DirtyHandles &dirty, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY);
+
+	const std::vector<ValidationIssue> &GetIssues() const { return m_issues; }
+
+	static void BuildData(CMap &map, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, ValidationData &data);
+
+private:
+	void RunChecks(const ValidationData &data, const std::vector<unsigned int> *indices);
+
+	CThreadPool &m_pool;
+	std::vector<std::unique_ptr<CValidationCheck>> m_checks;
+	std::vector<ValidationIssue> m_issues;
+};
+
+#endif
\ No newline at end of file
@@ -13,43 +13,109 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "doomrpg_data.h"
 
+// Reads from either an open file or a block of memory, so that the same
+// parsers serve files on disk and sections of an asset pack.
+typedef struct
+{
+	FILE *fp;
+	const uint8_t *data;
+	size_t size;
+	size_t position;
+} datareader_t;
+
+static size_t ReadData(void *buffer, size_t size, size_t count, datareader_t *reader)
+{
+	size_t available;
+	if (reader->fp != NULL)
+		return fread(buffer, size, count, reader->fp);
+	available = (size != 0 ? (reader->size - reader->position) / size : 0);
+	if (count > available)
+		count = available;
+	memcpy(buffer, reader->data + reader->position, size * count);
+	reader->position += size * count;
+	return count;
+}
+
+static void SeekData(datareader_t *reader, long offset, int origin)
+{
+	long position;
+	if (reader->fp != NULL)
+	{
+		fseek(reader->fp, offset, origin);
+		return;
+	}
+	position = offset + (origin == SEEK_END ? (long)reader->size : (origin == SEEK_CUR ? (long)reader->position : 0));
+	reader->position = (position < 0 ? 0 : ((size_t)position > reader->size ? reader->size : (size_t)position));
+}
+
+static long TellData(datareader_t *reader)
+{
+	if (reader->fp != NULL)
+		return ftell(reader->fp);
+	return (long)reader->position;
+}
+
+static mappings_t *ReadMappingsData(datareader_t *reader)
+{
+	mappings_t *mappings = NULL;
+	mappings = (mappings_t *)malloc(sizeof(mappings_t));
+	ReadData(&mappings->textureMappingCount, sizeof(uint32_t), 1, reader);
+	ReadData(&mappings->spriteMappingCount, sizeof(uint32_t), 1, reader);
+	ReadData(&mappings->wallMappingCount, sizeof(uint32_t), 1, reader);
+	ReadData(&mappings->thingMappingCount, sizeof(uint32_t), 1, reader);
+	mappings->textureMappings = (texturemapping_t *)malloc(sizeof(texturemapping_t) * mappings->textureMappingCount);
+	ReadData(mappings->textureMappings, sizeof(texturemapping_t), mappings->textureMappingCount, reader);
+	mappings->spriteMappings = (spritemapping_t *)malloc(sizeof(spritemapping_t) * mappings->spriteMappingCount);
+	ReadData(mappings->spriteMappings, sizeof(spritemapping_t), mappings->spriteMappingCount, reader);
+	mappings->wallMappings = (uint16_t *)malloc(sizeof(uint16_t) * mappings->wallMappingCount);
+	ReadData(mappings->wallMappings, sizeof(uint16_t), mappings->wallMappingCount, reader);
+	mappings->thingMappings = (uint16_t *)malloc(sizeof(uint16_t) * mappings->thingMappingCount);
+	ReadData(mappings->thingMappings, sizeof(uint16_t), mappings->thingMappingCount, reader);
+	return mappings;
+}
+
 mappings_t *LoadMappings(const char *filename)
 {
 	mappings_t *mappings = NULL;
-	FILE *fp = fopen(filename, "rb");
-	if (fp != NULL)
+	datareader_t reader = { fopen(filename, "rb"), NULL, 0, 0 };
+	if (reader.fp != NULL)
 	{
-		mappings = (mappings_t *)malloc(sizeof(mappings_t));
-		fread(&mappings->textureMappingCount, sizeof(uint32_t), 1, fp);
-		fread(&mappings->spriteMappingCount, sizeof(uint32_t), 1, fp);
-		fread(&mappings->wallMappingCount, sizeof(uint32_t), 1, fp);
-		fread(&mappings->thingMappingCount, sizeof(uint32_t), 1, fp);
-		mappings->textureMappings = (texturemapping_t *)malloc(sizeof(texturemapping_t) * mappings->textureMappingCount);
-		fread(mappings->textureMappings, sizeof(texturemapping_t), mappings->textureMappingCount, fp);
-		mappings->spriteMappings = (spritemapping_t *)malloc(sizeof(spritemapping_t) * mappings->spriteMappingCount);
-		fread(mappings->spriteMappings, sizeof(spritemapping_t), mappings->spriteMappingCount, fp);
-		mappings->wallMappings = (uint16_t *)malloc(sizeof(uint16_t) * mappings->wallMappingCount);
-		fread(mappings->wallMappings, sizeof(uint16_t), mappings->wallMappingCount, fp);
-		mappings->thingMappings = (uint16_t *)malloc(sizeof(uint16_t) * mappings->thingMappingCount);
-		fread(mappings->thingMappings, sizeof(uint16_t), mappings->thingMappingCount, fp);
-		fclose(fp);
+		mappings = ReadMappingsData(&reader);
+		fclose(reader.fp);
 	}
 	return mappings;
 }
 
+mappings_t *ReadMappings(const uint8_t *data, size_t size)
+{
+	datareader_t reader = { NULL, data, size, 0 };
+	return ReadMappingsData(&reader);
+}
+
 uint8_t *LoadBitShapes(const char *filename)
 {
-	uint8_t *bitShapes = NULL;
 	uint32_t length;
+	return LoadBitShapesEx(filename, &length);
+}
+
+uint8_t *LoadBitShapesEx(const char *filename, uint32_t *length)
+{
+	uint8_t *bitShapes = NULL;
 	FILE *fp = fopen(filename, "rb");
+	*length = 0;
 	if (fp != NULL)
 	{
-		fread(&length, sizeof(uint32_t), 1, fp);
-		bitShapes = (uint8_t *)malloc(length);
-		fread(bitShapes, sizeof(uint8_t), length, fp);
+		if (fread(length, sizeof(uint32_t), 1, fp) == 1)
+		{
+			bitShapes = (uint8_t *)malloc(*length);
+			*length = (uint32_t)fread(bitShapes, sizeof(uint8_t), *length, fp);
+		}
+		else
+			*length = 0;
 		fclose(fp);
 	}
 	return bitShapes;
@@ -72,14 +138,24 @@ uint8_t *LoadTexels(const char *filename)
 
 uint16_t *LoadPalettes(const char *filename)
 {
-	uint16_t *palettes = NULL;
 	uint32_t length;
+	return LoadPalettesEx(filename, &length);
+}
+
+uint16_t *LoadPalettesEx(const char *filename, uint32_t *length)
+{
+	uint16_t *palettes = NULL;
 	FILE *fp = fopen(filename, "rb");
+	*length = 0;
 	if (fp != NULL)
 	{
-		fread(&length, sizeof(uint32_t), 1, fp);
-		palettes = (uint16_t *)malloc(length);
-		fread(palettes, sizeof(uint8_t), length, fp);
+		if (fread(length, sizeof(uint32_t), 1, fp) == 1)
+		{
+			palettes = (uint16_t *)malloc(*length);
+			*length = (uint32_t)fread(palettes, sizeof(uint8_t), *length, fp);
+		}
+		else
+			*length = 0;
 		fclose(fp);
 	}
 	return palettes;
@@ -100,22 +176,35 @@ entities_t *LoadEntities(const char *filename)
 	return entities;
 }
 
+static entitiesex_t *ReadEntitiesExData(datareader_t *reader)
+{
+	entitiesex_t *entities = NULL;
+	entities = (entitiesex_t *)malloc(sizeof(entitiesex_t));
+	ReadData(&entities->entityCount, sizeof(uint16_t), 1, reader);
+	entities->entities = (entityex_t *)malloc(sizeof(entityex_t) * entities->entityCount);
+	ReadData(entities->entities, sizeof(entityex_t), entities->entityCount, reader);
+	return entities;
+}
+
 entitiesex_t *LoadEntitiesEx(const char *filename)
 {
 	entitiesex_t *entities = NULL;
-	FILE *fp = fopen(filename, "rb");
-	if (fp != NULL)
+	datareader_t reader = { fopen(filename, "rb"), NULL, 0, 0 };
+	if (reader.fp != NULL)
 	{
-		entities = (entitiesex_t *)malloc(sizeof(entitiesex_t));
-		fread(&entities->entityCount, sizeof(uint16_t), 1, fp);
-		entities->entities = (entityex_t *)malloc(sizeof(entityex_t) * entities->entityCount);
-		fread(entities->entities, sizeof(entityex_t), entities->entityCount, fp);
-		fclose(fp);
+		entities = ReadEntitiesExData(&reader);
+		fclose(reader.fp);
 	}
 	return entities;
 }
 
-strings_t *LoadStrings(const char *filename)
+entitiesex_t *ReadEntitiesEx(const uint8_t *data, size_t size)
+{
+	datareader_t reader = { NULL, data, size, 0 };
+	return ReadEntitiesExData(&reader);
+}
+
+static strings_t *ReadStringsData(datareader_t *reader)
 {
 	strings_t *strings = NULL;
 	long size;
@@ -123,31 +212,44 @@ strings_t *LoadStrings(const char *filename)
 	char *pBuffer;
 	uint16_t length;
 	int i;
-	FILE *fp = fopen(filename, "rb");
-	if (fp != NULL)
+	strings = (strings_t *)malloc(sizeof(strings_t));
+	SeekData(reader, 0, SEEK_END);
+	size = TellData(reader);
+	SeekData(reader, 0, SEEK_SET);
+	ReadData(&strings->stringCount, sizeof(uint16_t), 1, reader);
+	strings->strings = (char **)malloc(sizeof(char *) * strings->stringCount);
+	buffer = (char *)malloc(size - sizeof(uint16_t) * (strings->stringCount + 1) + sizeof(char) * strings->stringCount);
+	pBuffer = buffer;
+	for (i = 0; i < strings->stringCount; i++)
 	{
-		strings = (strings_t *)malloc(sizeof(strings_t));
-		fseek(fp, 0, SEEK_END);
-		size = ftell(fp);
-		fseek(fp, 0, SEEK_SET);
-		fread(&strings->stringCount, sizeof(uint16_t), 1, fp);
-		strings->strings = (char **)malloc(sizeof(char *) * strings->stringCount);
-		buffer = (char *)malloc(size - sizeof(uint16_t) * (strings->stringCount + 1) + sizeof(char) * strings->stringCount);
-		pBuffer = buffer;
-		for (i = 0; i < strings->stringCount; i++)
-		{
-			fread(&length, sizeof(uint16_t), 1, fp);
-			fread(pBuffer, sizeof(char), length, fp);
-			strings->strings[i] = pBuffer;
-			pBuffer += length;
-			*pBuffer = '\0';
-			pBuffer++;
-		}
-		fclose(fp);
+		ReadData(&length, sizeof(uint16_t), 1, reader);
+		ReadData(pBuffer, sizeof(char), length, reader);
+		strings->strings[i] = pBuffer;
+		pBuffer += length;
+		*pBuffer = '\0';
+		pBuffer++;
 	}
 	return strings;
 }
 
+strings_t *LoadStrings(const char *filename)
+{
+	strings_t *strings = NULL;
+	datareader_t reader = { fopen(filename, "rb"), NULL, 0, 0 };
+	if (reader.fp != NULL)
+	{
+		strings = ReadStringsData(&reader);
+		fclose(reader.fp);
+	}
+	return strings;
+}
+
+strings_t *ReadStrings(const uint8_t *data, size_t size)
+{
+	datareader_t reader = { NULL, data, size, 0 };
+	return ReadStringsData(&reader);
+}
+
 bspmap_t *LoadBspMap(const char *filename)
 {
 	bspmap_t *map = NULL;
@@ -177,7 +279,7 @@ bspmap_t *LoadBspMap(const char *filename)
 	return map;
 }
 
-bspmapex_t *LoadBspMapEx(const char *filename)
+static bspmapex_t *ReadBspMapExData(datareader_t *reader)
 {
 	bspmapex_t *map = NULL;
 	uint16_t stringCount;
@@ -187,57 +289,70 @@ bspmapex_t *LoadBspMapEx(const char *filename)
 	char *pBuffer;
 	uint16_t length;
 	int i;
-	FILE *fp = fopen(filename, "rb");
-	if (fp != NULL)
+	map = (bspmapex_t *)malloc(sizeof(bspmapex_t));
+	ReadData(&map->header, sizeof(bspheaderex_t), 1, reader);
+	ReadData(&map->nodeCount, sizeof(uint16_t), 1, reader);
+	map->nodes = (bspnode_t *)malloc(sizeof(bspnode_t) * map->nodeCount);
+	ReadData(map->nodes, sizeof(bspnode_t), map->nodeCount, reader);
+	ReadData(&map->lineCount, sizeof(uint16_t), 1, reader);
+	map->lines = (linesegmentex_t *)malloc(sizeof(linesegmentex_t) * map->lineCount);
+	ReadData(map->lines, sizeof(linesegmentex_t), map->lineCount, reader);
+	ReadData(&map->thingCount, sizeof(uint16_t), 1, reader);
+	map->things = (thing_t *)malloc(sizeof(thing_t) * map->thingCount);
+	ReadData(map->things, sizeof(thing_t), map->thingCount, reader);
+	ReadData(&map->eventCount, sizeof(uint16_t), 1, reader);
+	map->events = (uint32_t *)malloc(sizeof(uint32_t) * map->eventCount);
+	ReadData(map->events, sizeof(uint32_t), map->eventCount, reader);
+	ReadData(&map->commandCount, sizeof(uint16_t), 1, reader);
+	map->commands = (command_t *)malloc(sizeof(command_t) * map->commandCount);
+	ReadData(map->commands, sizeof(command_t), map->commandCount, reader);
+	ReadData(&stringCount, sizeof(uint16_t), 1, reader);
+	map->strings = NULL;
+	if (stringCount != 0)
 	{
-		map = (bspmapex_t *)malloc(sizeof(bspmapex_t));
-		fread(&map->header, sizeof(bspheaderex_t), 1, fp);
-		fread(&map->nodeCount, sizeof(uint16_t), 1, fp);
-		map->nodes = (bspnode_t *)malloc(sizeof(bspnode_t) * map->nodeCount);
-		fread(map->nodes, sizeof(bspnode_t), map->nodeCount, fp);
-		fread(&map->lineCount, sizeof(uint16_t), 1, fp);
-		map->lines = (linesegmentex_t *)malloc(sizeof(linesegmentex_t) * map->lineCount);
-		fread(map->lines, sizeof(linesegmentex_t), map->lineCount, fp);
-		fread(&map->thingCount, sizeof(uint16_t), 1, fp);
-		map->things = (thing_t *)malloc(sizeof(thing_t) * map->thingCount);
-		fread(map->things, sizeof(thing_t), map->thingCount, fp);
-		fread(&map->eventCount, sizeof(uint16_t), 1, fp);
-		map->events = (uint32_t *)malloc(sizeof(uint32_t) * map->eventCount);
-		fread(map->events, sizeof(uint32_t), map->eventCount, fp);
-		fread(&map->commandCount, sizeof(uint16_t), 1, fp);
-		map->commands = (command_t *)malloc(sizeof(command_t) * map->commandCount);
-		fread(map->commands, sizeof(command_t), map->commandCount, fp);
-		fread(&stringCount, sizeof(uint16_t), 1, fp);
-		map->strings = NULL;
-		if (stringCount != 0)
+		map->strings = (strings_t *)malloc(sizeof(strings_t));
+		map->strings->stringCount = stringCount;
+		offset = TellData(reader);
+		SeekData(reader, -2304, SEEK_END);
+		size = TellData(reader) - offset;
+		SeekData(reader, offset, SEEK_SET);
+		map->strings->strings = (char **)malloc(sizeof(char *) * map->strings->stringCount);
+		buffer = (char *)malloc(size - sizeof(uint16_t) * map->strings->stringCount + sizeof(char) * map->strings->stringCount);
+		pBuffer = buffer;
+		for (i = 0; i < map->strings->stringCount; i++)
 		{
-			map->strings = (strings_t *)malloc(sizeof(strings_t));
-			map->strings->stringCount = stringCount;
-			offset = ftell(fp);
-			fseek(fp, -2304, SEEK_END);
-			size = ftell(fp) - offset;
-			fseek(fp, offset, SEEK_SET);
-			map->strings->strings = (char **)malloc(sizeof(char *) * map->strings->stringCount);
-			buffer = (char *)malloc(size - sizeof(uint16_t) * map->strings->stringCount + sizeof(char) * map->strings->stringCount);
-			pBuffer = buffer;
-			for (i = 0; i < map->strings->stringCount; i++)
-			{
-				fread(&length, sizeof(uint16_t), 1, fp);
-				fread(pBuffer, sizeof(char), length, fp);
-				map->strings->strings[i] = pBuffer;
-				pBuffer += length;
-				*pBuffer = '\0';
-				pBuffer++;
-			}
+			ReadData(&length, sizeof(uint16_t), 1, reader);
+			ReadData(pBuffer, sizeof(char), length, reader);
+			map->strings->strings[i] = pBuffer;
+			pBuffer += length;
+			*pBuffer = '\0';
+			pBuffer++;
 		}
-		fread(map->blockMap, sizeof(uint8_t), 256, fp);
-		fread(map->floorMap, sizeof(uint8_t), 1024, fp);
-		fread(map->ceilingMap, sizeof(uint8_t), 1024, fp);
-		fclose(fp);
 	}
+	ReadData(map->blockMap, sizeof(uint8_t), 256, reader);
+	ReadData(map->floorMap, sizeof(uint8_t), 1024, reader);
+	ReadData(map->ceilingMap, sizeof(uint8_t), 1024, reader);
 	return map;
 }
 
+bspmapex_t *LoadBspMapEx(const char *filename)
+{
+	bspmapex_t *map = NULL;
+	datareader_t reader = { fopen(filename, "rb"), NULL, 0, 0 };
+	if (reader.fp != NULL)
+	{
+		map = ReadBspMapExData(&reader);
+		fclose(reader.fp);
+	}
+	return map;
+}
+
+bspmapex_t *ReadBspMapEx(const uint8_t *data, size_t size)
+{
+	datareader_t reader = { NULL, data, size, 0 };
+	return ReadBspMapExData(&reader);
+}
+
 void FreeMappings(mappings_t *mappings)
 {
 	if (mappings != NULL)
@@ -14,6 +14,7 @@
 #ifndef __DOOMRPG_DATA_H__
 #define __DOOMRPG_DATA_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "doomrpg_entities.h"
@@ -236,13 +237,19 @@ typedef struct
 
 mappings_t *LoadMappings(const char *filename);
 uint8_t *LoadBitShapes(const char *filename);
+uint8_t *LoadBitShapesEx(const char *filename, uint32_t *length);
 uint8_t *LoadTexels(const char *filename);
 uint16_t *LoadPalettes(const char *filename);
+uint16_t *LoadPalettesEx(const char *filename, uint32_t *length);
 entities_t *LoadEntities(const char *filename);
 entitiesex_t *LoadEntitiesEx(const char *filename);
 strings_t *LoadStrings(const char *filename);
 bspmap_t *LoadBspMap(const char *filename);
 bspmapex_t *LoadBspMapEx(const char *filename);
+mappings_t *ReadMappings(const uint8_t *data, size_t size);
+entitiesex_t *ReadEntitiesEx(const uint8_t *data, size_t size);
+strings_t *ReadStrings(const uint8_t *data, size_t size);
+bspmapex_t *ReadBspMapEx(const uint8_t *data, size_t size);
 void FreeMappings(mappings_t *mappings);
 void FreeBitShapes(uint8_t *bitShapes);
 void FreeTexels(uint8_t *texels);
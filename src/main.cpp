@@ -12,1078 +12,557 @@
 // GNU General Public License for more details.
 
 #include "SDL.h"
+#include <algorithm>
+#include <cstdio>
 #include <string>
 #include <vector>
-
-#include "CGrid.h"
-#include "CList.h"
-#include "CMap.h"
+#include <thread>
+
+#include "CChunkPager.h"
+#include "CCommandQueue.h"
+#include "CEditor.h"
+#include "CGameData.h"
+#include "CInputLog.h"
+#include "CMapSnapshot.h"
+#include "CMapTab.h"
+#include "CPreview.h"
+#include "CReachability.h"
+#include "CSpriteAtlas.h"
+#include "CTextureCache.h"
+#include "CThreadPool.h"
+#include "CValidator.h"
+#include "doomrpg_data.h"
 
 using namespace std;
 
-enum Mode
-{
-	MODE_DRAW,
-	MODE_MOVE,
-	MODE_VERTEX,
-	MODE_NONE
-};
-
-enum Selection
-{
-	SELECTION_VERTEX,
-	SELECTION_LINE,
-	SELECTION_SECTOR,
-	SELECTION_NONE
-};
-
-bool SectorIsClockwise(const Sector &sector);
-bool AABBContainsPoint(float x, float y, float minX, float minY, float maxX, float maxY);
-Selection FindSelection(CList<Sector> *sectors, float x, float y, CNode<Sector> **selectedSector, CNode<Line> **selectedLine, CNode<Vertex> **selectedVertex);
-CNode<Line> *FindLine(const CList<Line> *lines, const Vertex *vertex1, const Vertex *vertex2);
-void ProjectPointOnSegment(const Vertex &vertex1, const Vertex &vertex2, float x, float y, Vertex &vertexOut);
-void CalculateSectorAABB(Sector &sector);
-void InitializeSector(Sector &sector);
-void CancelSector(CMap &map, Sector &sector);
-void DeleteSector(CMap &map, CNode<Sector> &sector);
-CNode<Vertex> *InsertVertex(CMap &map, Vertex &vertex);
-CNode<Line> *InsertLine(CMap &map, Line &line);
-CNode<Sector> *InsertSector(CMap &map, Sector &sector);
-void CloseSector(CMap &map, Sector &sector, Line &line);
-void MoveVertex(Vertex &vertex, int x, int y, CGrid &grid);
-void MoveLine(Line &line, int x, int y, int referenceX, int referenceY, int &initialX, int &initialY, float scaleInverse, CGrid &grid);
-void MoveSector(Sector &sector, int x, int y, int referenceX, int referenceY, int &initialX, int &initialY, float scaleInverse, CGrid &grid);
-void RecalculateSectorsAABB(CMap &map, CNode<Vertex> &vertex);
-void RecalculateSectorsAABB(CMap &map, CNode<Line> &line);
-void RecalculateSectorsAABB(CMap &map, CNode<Sector> &sector);
+bool TranslateEvent(const SDL_Event &event, Command &command);
+int ValidateMaps(const vector<const char *> &filenames);
+bool WritesBack(const CMap &map, const char *filename);
+int ReplayLog(const char *logFilename, const char *mapFilename);
+void ReportTexelResidency(const CGameData &gameData);
 
 int main(int argc, char *argv[]) {
-	char *filename = nullptr;
+	vector<const char *> filenames;
+	string dataDirectory;
+	string packFilename;
+	string mapCacheDirectory;
+	size_t textureBudget = 16;
+	char *workspaceFilename = nullptr;
+	bool validate = false;
+	vector<const char *> validateFilenames;
+	const char *recordFilename = nullptr;
+	const char *replayFilename = nullptr;
 
 	if (argc > 1)
 	{
 		for (int i = 1; i < argc; i++)
 		{
-			if (!strcmp(argv[i], "-map"))
-				filename = argv[i + 1];
+			if (!strcmp(argv[i], "-map") && i + 1 < argc)
+				filenames.push_back(argv[i + 1]);
+			else if (!strcmp(argv[i], "-data") && i + 1 < argc)
+				dataDirectory = string(argv[i + 1]) + "/";
+			else if (!strcmp(argv[i], "-pack") && i + 1 < argc)
+				packFilename = argv[i + 1];
+			else if (!strcmp(argv[i], "-mapcache") && i + 1 < argc)
+				mapCacheDirectory = argv[i + 1];
+			else if (!strcmp(argv[i], "-workspace") && i + 1 < argc)
+				workspaceFilename = argv[i + 1];
+			else if (!strcmp(argv[i], "-record") && i + 1 < argc)
+				recordFilename = argv[i + 1];
+			else if (!strcmp(argv[i], "-replay") && i + 1 < argc)
+				replayFilename = argv[i + 1];
+			else if (!strcmp(argv[i], "-texturebudget") && i + 1 < argc)
+				textureBudget = size_t(atoi(argv[i + 1]));
+			else if (!strcmp(argv[i], "-validate"))
+			{
+				validate = true;
+
+				while (i + 1 < argc && argv[i + 1][0] != '-')
+					validateFilenames.push_back(argv[++i]);
+			}
 		}
 	}
 
+	if (validate)
+	{
+		validateFilenames.insert(validateFilenames.end(), filenames.begin(), filenames.end());
+
+		return ValidateMaps(validateFilenames);
+	}
+
+	if (replayFilename != nullptr)
+		return ReplayLog(replayFilename, (filenames.empty() ? nullptr : filenames[0]));
+
 	SDL_Init(SDL_INIT_VIDEO);
 
 	SDL_Window *window = SDL_CreateWindow("Doom RPG Edit - Mode: Draw - Zoom: 25%", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 515, 515, SDL_WINDOW_RESIZABLE);
 	SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
 
-	CGrid grid(515, 515, 8, 0, 0, 0.25f);
+	CThreadPool pool;
 
-	grid.SetMinX(0);
-	grid.SetMinY(0);
-	grid.SetMaxX(256);
-	grid.SetMaxY(256);
+	shared_ptr<CGameData> gameData = make_shared<CGameData>();
 
-	grid.SetXDisplacement(-grid.GetScaledCellSize() * grid.GetMaxX() / 2);
-	grid.SetYDisplacement(-grid.GetScaledCellSize() * grid.GetMaxY() / 2);
+	if (!mapCacheDirectory.empty())
+		gameData->SetMapCache(mapCacheDirectory);
 
-	CMap map;
-	map.Read(filename);
+	if (!packFilename.empty())
+	{
+		if (!gameData->LoadPack(packFilename, textureBudget * 1024 * 1024))
+			printf("Failed to open pack %s\n", packFilename.c_str());
+	}
+	else if (!dataDirectory.empty())
+		gameData->Load(dataDirectory, textureBudget * 1024 * 1024);
 
-	Mode mode = MODE_DRAW;
+	unique_ptr<CChunkPager> pager;
+	string chunkFilename;
+	int originX = 0, originY = 0;
 
-	bool drawing = false;
-	bool moving = false;
-	bool scrolling = false;
+	if (workspaceFilename != nullptr)
+	{
+		pager.reset(new CChunkPager(64 * 1024 * 1024, gameData->GetMapCache()));
 
-	float x, y;
+		if (pager->ReadWorkspace(workspaceFilename))
+		{
+			// Without -map, the chunk at (0, 0) is edited.
+			if (filenames.empty() && pager->GetChunkFilename(0, 0, chunkFilename))
+				filenames.push_back(chunkFilename.c_str());
+			else if (!filenames.empty())
+				pager->FindChunk(filenames[0], originX, originY);
+		}
+		else
+			pager.reset();
+	}
 
-	Sector sector;
-	InitializeSector(sector);
+	if (filenames.empty())
+		filenames.push_back(nullptr);
 
-	Line line;
-	line.sectors[0] = nullptr;
-	line.sectors[1] = nullptr;
+	// Each map is opened in its own tab, and the workspace pages chunks
+	// around the first one.
+	vector<unique_ptr<CMapTab>> tabs;
 
-	CNode<Sector> *selectedSector = nullptr;
-	CNode<Line> *selectedLine = nullptr;
-	CNode<Vertex> *selectedVertex = nullptr;
+	for (const char *filename : filenames)
+	{
+		tabs.emplace_back(new CMapTab(515, 515, pool, gameData));
+		tabs.back()->Open(filename, (tabs.size() == 1 ? pager.get() : nullptr), originX, originY);
+	}
 
-	Selection selection = SELECTION_NONE;
+	size_t activeTab = 0;
 
-	int referenceX, referenceY;
-	int initialX, initialY;
+	// Only the commands sent to the first map are recorded.
+	CInputRecorder recorder;
+	const CMapTab *recordedTab = tabs[0].get();
 
-	float scale = 0.25f;
-	float scaleInverse = 4.0f;
+	if (recordFilename != nullptr && !recorder.Open(recordFilename, recordedTab->GetVersion()->Hash(), 515, 515))
+		printf("Failed to open input log %s\n", recordFilename);
 
-	bool updateTitle = false;
+	CPreview preview(pool);
+	preview.SetTextureCache(gameData->GetTextureCache());
 
-	bool running = true;
+	int mode = MODE_DRAW;
+	float scale = 0.25f;
+	unsigned int issueCount = 0;
+	bool titleChanged = true;
+	bool loadReported = dataDirectory.empty();
 
-	while (running)
+	// Quitting, resizing and the texture count apply to every tab,
+	// everything else to the active one.
+	auto dispatch = [&](const Command &command)
 	{
-		SDL_Event event;
-
-		while (SDL_PollEvent(&event))
+		for (size_t i = 0; i < tabs.size(); i++)
 		{
-			switch (event.type)
+			if (i != activeTab && command.type != COMMAND_QUIT && command.type != COMMAND_RESIZE && command.type != COMMAND_TEXTURE_COUNT)
+				continue;
+
+			bool pushed = tabs[i]->Push(command);
+
+			// A stopped editor never empties its queue, and its tab is only
+			// closed after the events are handled.
+			while (!pushed && command.type != COMMAND_MOTION && tabs[i]->IsRunning())
 			{
-			case SDL_QUIT:
-				running = false;
-				break;
-			case SDL_KEYDOWN:
-				switch (event.key.keysym.sym)
-				{
-				case SDLK_ESCAPE:
-					if (drawing)
-					{
-						CancelSector(map, sector);
-						InitializeSector(sector);
-						drawing = false;
-					}
-					break;
-				case SDLK_RETURN:
-					if (drawing && sector.vertexCount > 4)
-					{
-						CloseSector(map, sector, line);
-						InitializeSector(sector);
-						drawing = false;
-					}
-
-					break;
-				case SDLK_DELETE:
-					if (mode == MODE_MOVE && selection == SELECTION_SECTOR)
-					{
-						DeleteSector(map, *selectedSector);
-						selection = SELECTION_NONE;
-					}
-
-					break;
-				case SDLK_q:
-					running = false;
-					break;
-				case SDLK_d:
-					if (!moving)
-					{
-						mode = MODE_DRAW;
-						updateTitle = true;
-					}
-
-					break;
-				case SDLK_m:
-					if (!drawing)
-					{
-						mode = MODE_MOVE;
-						updateTitle = true;
-						int x, y;
-						SDL_GetMouseState(&x, &y);
-						selection = FindSelection(map.GetSectors(), grid.TranslateXToGridSpace(float(x)), grid.TranslateYToGridSpace(float(y)), &selectedSector, &selectedLine, &selectedVertex);
-					}
-
-					break;
-				case SDLK_v:
-					if (!drawing && !moving)
-					{
-						mode = MODE_VERTEX;
-						updateTitle = true;
-					}
-
-					break;
-				case SDLK_c:
-					grid.CenterOrigin();
-					grid.SetXDisplacement(-grid.GetScaledCellSize() * grid.GetMaxX() / 2);
-					grid.SetYDisplacement(-grid.GetScaledCellSize() * grid.GetMaxY() / 2);
-					break;
-				case SDLK_LEFT:
-					grid.ScrollX(grid.GetScaledCellSize());
-					break;
-				case SDLK_RIGHT:
-					grid.ScrollX(-grid.GetScaledCellSize());
-					break;
-				case SDLK_UP:
-					grid.ScrollY(grid.GetScaledCellSize());
-					break;
-				case SDLK_DOWN:
-					grid.ScrollY(-grid.GetScaledCellSize());
-					break;
-				case SDLK_MINUS:
-				case SDLK_KP_MINUS:
-					if (scale > 0.25f)
-						scale -= 0.25f;
-
-					scaleInverse = 1.0f / scale;
-
-					grid.SetScale(scale);
-
-					updateTitle = true;
-
-					break;
-				case SDLK_EQUALS:
-				case SDLK_KP_PLUS:
-					if (scale < 2.0f)
-						scale += 0.25f;
-
-					scaleInverse = 1.0f / scale;
-
-					grid.SetScale(scale);
-
-					updateTitle = true;
-
-					break;
-				default:
-					break;
-				}
-
-				break;
-			case SDL_MOUSEBUTTONDOWN:
-				if (event.button.button == SDL_BUTTON_LEFT && !scrolling)
-				{
-					if (mode == MODE_DRAW)
-					{
-						Vertex vertex;
-
-						x = float(event.button.x);
-						y = float(event.button.y);
-
-						grid.Snap(x, y);
-
-						vertex.x = x;
-						vertex.y = y;
-
-						if (sector.vertexCount > 0 && vertex.x == map.GetVertices()->Tail()->GetData()->x && vertex.y == map.GetVertices()->Tail()->GetData()->y)
-							break;
-
-						if (sector.vertexCount > 2 && AABBContainsPoint(vertex.x, vertex.y, sector.firstVertex->GetData()->x - 2, sector.firstVertex->GetData()->y - 2, sector.firstVertex->GetData()->x + 2, sector.firstVertex->GetData()->y + 2))
-						{
-							CloseSector(map, sector, line);
-							InitializeSector(sector);
-							drawing = false;
-						}
-						else
-						{
-							line.vertex2 = InsertVertex(map, vertex);
-
-							if (line.vertex2->GetData()->x < sector.minX)
-								sector.minX = line.vertex2->GetData()->x;
-
-							if (line.vertex2->GetData()->y < sector.minY)
-								sector.minY = line.vertex2->GetData()->y;
-
-							if (line.vertex2->GetData()->x > sector.maxX)
-								sector.maxX = line.vertex2->GetData()->x;
-
-							if (line.vertex2->GetData()->y > sector.maxY)
-								sector.maxY = line.vertex2->GetData()->y;
-
-							if ((++sector.vertexCount % 2) == 0)
-							{
-								CNode<Line> *newLineNode = InsertLine(map, line);
-
-								if (sector.lineCount++ == 0)
-									sector.firstLine = sector.lastLine = newLineNode;
-								else
-									sector.lastLine = newLineNode;
-
-								sector.vertexCount++;
-							}
-
-							line.vertex1 = line.vertex2;
-
-							if (sector.vertexCount == 1)
-								sector.firstVertex = sector.lastVertex = line.vertex1;
-							else
-								sector.lastVertex = line.vertex1;
-
-							drawing = true;
-						}
-					}
-					else if (mode == MODE_MOVE)
-					{
-						referenceX = event.button.x;
-						referenceY = event.button.y;
-						initialX = initialY = 0;
-						moving = true;
-					}
-					else if (mode == MODE_VERTEX)
-					{
-						x = float(event.button.x);
-						y = float(event.button.y);
-
-						grid.Snap(x, y);
-
-						selection = FindSelection(map.GetSectors(), grid.TranslateXToGridSpace(float(event.button.x)), grid.TranslateYToGridSpace(float(event.button.y)), nullptr, &selectedLine, nullptr);
-
-						if (selection == SELECTION_LINE)
-						{
-							Line *line = selectedLine->GetData();
-							Vertex *newVertex = new Vertex;
-							ProjectPointOnSegment(*line->vertex1->GetData(), *line->vertex2->GetData(), x, y, *newVertex);
-							CNode<Vertex> *newVertexNode = map.GetVertices()->Insert(newVertex, true, line->vertex1);
-							Line *newLine = new Line;
-							newLine->vertex1 = line->vertex1;
-							newLine->vertex2 = newVertexNode;
-							newLine->sectors[0] = line->sectors[0];
-							newLine->sectors[1] = line->sectors[1];
-							line->vertex1 = newVertexNode;
-							CNode<Line> *newLineNode = map.GetLines()->Insert(newLine, true, selectedLine->Prev());
-
-							line->sectors[0]->vertexCount++;
-							line->sectors[0]->lineCount++;
-
-							if (selectedLine == line->sectors[0]->firstLine)
-								line->sectors[0]->firstLine = newLineNode;
-							else if (selectedLine == line->sectors[0]->lastLine)
-								line->sectors[0]->lastVertex = newVertexNode;
-
-							if (line->sectors[1] != nullptr)
-							{
-								CNode<Vertex> *currentVertex = line->sectors[1]->firstVertex;
-
-								for (unsigned int vertexCount = line->sectors[1]->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
-								{
-									if (currentVertex->GetData() == line->vertex2->GetData())
-									{
-										newVertexNode = map.GetVertices()->Insert(newVertexNode, currentVertex);
-
-										break;
-									}
-								}
-
-								CNode<Line> *currentLine = line->sectors[1]->firstLine;
-
-								for (unsigned int lineCount = line->sectors[1]->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
-								{
-									if (currentLine->GetData() == line)
-									{
-										newLineNode = map.GetLines()->Insert(newLineNode, currentLine);
-
-										if (currentLine == line->sectors[1]->lastLine)
-										{
-											line->sectors[1]->lastLine = newLineNode;
-											line->sectors[1]->lastVertex = newVertexNode;
-										}
-
-										break;
-									}
-								}
-
-								line->sectors[1]->vertexCount++;
-								line->sectors[1]->lineCount++;
-							}
-						}
-					}
-				}
-				else if (event.button.button == SDL_BUTTON_RIGHT && !drawing && !moving)
-				{
-					referenceX = event.button.x;
-					referenceY = event.button.y;
-					initialX = initialY = 0;
-					scrolling = true;
-				}
-
-				break;
-			case SDL_MOUSEBUTTONUP:
-				if (event.button.button == SDL_BUTTON_LEFT && !scrolling)
-				{
-					if (drawing)
-					{
-						Vertex vertex;
-
-						x = float(event.button.x);
-						y = float(event.button.y);
-
-						grid.Snap(x, y);
-
-						vertex.x = x;
-						vertex.y = y;
-
-						if (vertex.x == map.GetVertices()->Tail()->GetData()->x && vertex.y == map.GetVertices()->Tail()->GetData()->y)
-							break;
-
-						if (sector.vertexCount > 2 && AABBContainsPoint(vertex.x, vertex.y, sector.firstVertex->GetData()->x - 2, sector.firstVertex->GetData()->y - 2, sector.firstVertex->GetData()->x + 2, sector.firstVertex->GetData()->y + 2))
-						{
-							CloseSector(map, sector, line);
-							InitializeSector(sector);
-							drawing = false;
-						}
-						else
-						{
-							line.vertex2 = InsertVertex(map, vertex);
-
-							if (line.vertex2->GetData()->x < sector.minX)
-								sector.minX = line.vertex2->GetData()->x;
-
-							if (line.vertex2->GetData()->y < sector.minY)
-								sector.minY = line.vertex2->GetData()->y;
-
-							if (line.vertex2->GetData()->x > sector.maxX)
-								sector.maxX = line.vertex2->GetData()->x;
-
-							if (line.vertex2->GetData()->y > sector.maxY)
-								sector.maxY = line.vertex2->GetData()->y;
-
-							if ((++sector.vertexCount % 2) == 0)
-							{
-								CNode<Line> *newLineNode = InsertLine(map, line);
-
-								if (sector.lineCount++ == 0)
-									sector.firstLine = sector.lastLine = newLineNode;
-								else
-									sector.lastLine = newLineNode;
-
-								sector.vertexCount++;
-							}
-
-							line.vertex1 = line.vertex2;
-
-							if (sector.vertexCount == 1)
-								sector.firstVertex = sector.lastVertex = line.vertex1;
-							else
-								sector.lastVertex = line.vertex1;
-
-							drawing = true;
-						}
-					}
-					else if (moving)
-					{
-						if (selection == SELECTION_VERTEX)
-							RecalculateSectorsAABB(map, *selectedVertex);
-						else if (selection == SELECTION_LINE)
-							RecalculateSectorsAABB(map, *selectedLine);
-						else if (selection == SELECTION_SECTOR)
-							RecalculateSectorsAABB(map, *selectedSector);
-
-						moving = false;
-					}
-				}
-				else if (event.button.button == SDL_BUTTON_RIGHT && scrolling)
-					scrolling = false;
-
-				break;
-			case SDL_MOUSEMOTION:
-				if (drawing)
-				{
-					x = float(event.motion.x);
-					y = float(event.motion.y);
-
-					grid.Snap(x, y);
-				}
-				else if (moving)
-				{
-					if (selection == SELECTION_VERTEX)
-						MoveVertex(*selectedVertex->GetData(), event.motion.x, event.motion.y, grid);
-					else if (selection == SELECTION_LINE)
-						MoveLine(*selectedLine->GetData(), event.motion.x, event.motion.y, referenceX, referenceY, initialX, initialY, scaleInverse, grid);
-					else if (selection == SELECTION_SECTOR)
-						MoveSector(*selectedSector->GetData(), event.motion.x, event.motion.y, referenceX, referenceY, initialX, initialY, scaleInverse, grid);
-				}
-				else if (scrolling)
-				{
-					int finalX = event.motion.x - referenceX, finalY = event.motion.y - referenceY;
-					grid.Scroll(finalX - initialX, finalY - initialY);
-					initialX = finalX;
-					initialY = finalY;
-				}
-				else if (mode == MODE_MOVE)
-					selection = FindSelection(map.GetSectors(), grid.TranslateXToGridSpace(float(event.motion.x)), grid.TranslateYToGridSpace(float(event.motion.y)), &selectedSector, &selectedLine, &selectedVertex);
-
-				break;
-			case SDL_MOUSEWHEEL:
-				if (event.wheel.y < 0 && scale > 0.25f)
-					scale -= 0.25f;
-				else if (event.wheel.y > 0 && scale < 2.0f)
-					scale += 0.25f;
-
-				scaleInverse = 1.0f / scale;
-
-				grid.SetScale(scale);
-
-				updateTitle = true;
-
-				break;
-			case SDL_WINDOWEVENT:
-				if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
-					grid.Resize(event.window.data1, event.window.data2);
-
-				break;
-			default:
-				break;
+				this_thread::yield();
+				pushed = tabs[i]->Push(command);
 			}
-		}
 
-		if (updateTitle)
-		{
-			string title = "Doom RPG Edit - Mode: " + (mode == MODE_DRAW ? string("Draw") : (mode == MODE_MOVE ? string("Move") : string("Vertex"))) + " - Zoom: " + to_string(int(scale * 100)) + "%";
-			SDL_SetWindowTitle(window, title.c_str());
-			updateTitle = false;
+			if (pushed && tabs[i].get() == recordedTab)
+				recorder.Record(command);
 		}
+	};
 
-		grid.Render(renderer);
-		map.Render(renderer, grid);
+	while (!tabs.empty())
+	{
+		SDL_Event event;
+		shared_ptr<const CMapSnapshot> snapshot = tabs[activeTab]->GetSnapshot();
 
-		if (drawing)
+		while (SDL_PollEvent(&event))
 		{
-			const Vertex *vertex = line.vertex1->GetData();
-			int x1 = int(grid.TranslateXToViewSpace(vertex->x));
-			int y1 = int(grid.TranslateYToViewSpace(vertex->y));
-			int x2 = int(grid.TranslateXToViewSpace(x));
-			int y2 = int(grid.TranslateYToViewSpace(y));
-			vector<SDL_Rect> rects;
-			rects.push_back({ x1 - 2, y1 - 2, 5, 5 });
-			rects.push_back({ x2 - 2, y2 - 2, 5, 5 });
-
-			SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-			SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
-
-			SDL_SetRenderDrawColor(renderer, 0, 128, 255, 255);
-			SDL_RenderFillRects(renderer, rects.data(), rects.size());
-		}
+			Command command;
 
-		
-		if (mode == MODE_MOVE && selection != SELECTION_NONE)
-		{
-			if (selection == SELECTION_VERTEX)
-			{
-				SDL_Rect rect = { int(grid.TranslateXToViewSpace(selectedVertex->GetData()->x)) - 2, int(grid.TranslateYToViewSpace(selectedVertex->GetData()->y)) - 2, 5, 5 };
+			if (preview.HandleEvent(event, *snapshot))
+				continue;
 
-				SDL_SetRenderDrawColor(renderer, 255, 128, 0, 255);
-				SDL_RenderFillRect(renderer, &rect);
-			}
-			else if (selection == SELECTION_LINE)
+			if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_p)
 			{
-				const Vertex *vertex1 = selectedLine->GetData()->vertex1->GetData();
-				const Vertex *vertex2 = selectedLine->GetData()->vertex2->GetData();
-				SDL_Rect rects[2] = { { int(grid.TranslateXToViewSpace(vertex1->x)) - 2, int(grid.TranslateYToViewSpace(vertex1->y)) - 2, 5, 5 }, { int(grid.TranslateXToViewSpace(vertex2->x)) - 2, int(grid.TranslateYToViewSpace(vertex2->y)) - 2, 5, 5 } };
-
-				SDL_SetRenderDrawColor(renderer, 255, 128, 0, 255);
-				SDL_RenderDrawLine(renderer, int(grid.TranslateXToViewSpace(vertex1->x)), int(grid.TranslateYToViewSpace(vertex1->y)), int(grid.TranslateXToViewSpace(vertex2->x)), int(grid.TranslateYToViewSpace(vertex2->y)));
-				
-				SDL_SetRenderDrawColor(renderer, 0, 128, 255, 255);
-				SDL_RenderFillRects(renderer, rects, 2);
-			}
-			else if (selection == SELECTION_SECTOR)
-			{
-				vector<SDL_Point> screenCoords;
-				vector<SDL_Rect> rects;
-				CNode<Line> *currentLine = selectedSector->GetData()->firstLine;
-
-				for (unsigned int lineCount = selectedSector->GetData()->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
-				{
-					const Vertex *vertex = (currentLine->GetData()->sectors[0] == selectedSector->GetData() ? currentLine->GetData()->vertex1->GetData() : currentLine->GetData()->vertex2->GetData());
-					screenCoords.push_back({ int(grid.TranslateXToViewSpace(vertex->x)), int(grid.TranslateYToViewSpace(vertex->y)) });
-					rects.push_back({ screenCoords.back().x - 2, screenCoords.back().y - 2, 5, 5 });
-				}
-
-				SDL_SetRenderDrawColor(renderer, 255, 128, 0, 255);
-				SDL_RenderDrawLines(renderer, screenCoords.data(), screenCoords.size());
-				SDL_RenderDrawLine(renderer, screenCoords.front().x, screenCoords.front().y, screenCoords.back().x, screenCoords.back().y);
-
-				SDL_SetRenderDrawColor(renderer, 0, 128, 255, 255);
-				SDL_RenderFillRects(renderer, rects.data(), rects.size());
-			}
-		}
-
-		SDL_RenderPresent(renderer);
-	}
+				if (preview.IsOpen())
+					preview.Close();
+				else
+					preview.Open(*snapshot);
 
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyWindow(window);
-
-	SDL_Quit();
-
-	return 0;
-}
+				continue;
+			}
 
-bool SectorIsClockwise(const Sector &sector)
-{
-	float sum = 0.0f;
-	CNode<Vertex> *currentVertex = sector.firstVertex;
+			if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F2)
+			{
+				ReportTexelResidency(*gameData);
 
-	for (unsigned int vertexCount = sector.vertexCount - 1; vertexCount-- != 0; currentVertex = currentVertex->Next())
-	{
-		const Vertex *vertex1 = currentVertex->GetData();
-		const Vertex *vertex2 = currentVertex->Next()->GetData();
-		sum += (vertex2->x - vertex1->x) * (vertex2->y + vertex1->y);
-	}
+				continue;
+			}
 
-	const Vertex *vertex1 = currentVertex->GetData();
-	const Vertex *vertex2 = sector.firstVertex->GetData();
-	sum += (vertex2->x - vertex1->x) * (vertex2->y + vertex1->y);
+			if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_TAB && (event.key.keysym.mod & KMOD_CTRL) != 0)
+			{
+				if ((event.key.keysym.mod & KMOD_SHIFT) != 0)
+					activeTab = (activeTab + tabs.size() - 1) % tabs.size();
+				else
+					activeTab = (activeTab + 1) % tabs.size();
 
-	return (sum < 0.0f);
-}
+				snapshot = tabs[activeTab]->GetSnapshot();
+				titleChanged = true;
 
-bool AABBContainsPoint(float x, float y, float minX, float minY, float maxX, float maxY)
-{
-	return (x >= minX && y >= minY && x <= maxX && y <= maxY);
-}
+				continue;
+			}
 
-bool AABBContainsSegment(float x1, float y1, float x2, float y2, float minX, float minY, float maxX, float maxY)
-{
-	if ((x1 < minX && x2 < minX) || (y1 < minY && y2 < minY) || (x1 > maxX && x2 > maxX) || (y1 > maxY && y2 > maxY))
-		return false;
+			if (TranslateEvent(event, command))
+				dispatch(command);
+		}
 
-	float m = (y2 - y1) / (x2 - x1);
+		// Tabs whose editor stopped are closed.
+		for (size_t i = tabs.size(); i-- != 0;)
+		{
+			if (tabs[i]->IsRunning())
+				continue;
 
-	float y = m * (minX - x1) + y1;
+			tabs.erase(tabs.begin() + i);
 
-	if (y >= minY && y <= maxY)
-		return true;
+			if (activeTab > i || activeTab == tabs.size())
+				activeTab = (activeTab != 0 ? activeTab - 1 : 0);
 
-	y = m * (maxX - x1) + y1;
-	
-	if (y >= minY && y < maxY)
-		return true;
+			titleChanged = true;
+		}
 
-	float x = (minY - y1) / m + x1;
-	
-	if (x >= minX && x <= maxX)
-		return true;
+		if (tabs.empty())
+			break;
 
-	x = (maxY - y1) / m + x1;
+		snapshot = tabs[activeTab]->GetSnapshot();
 
-	if (x >= minX && x <= maxX)
-		return true;
+		if (titleChanged || snapshot->GetMode() != mode || snapshot->GetScale() != scale || snapshot->GetIssueCount() != issueCount)
+		{
+			mode = snapshot->GetMode();
+			scale = snapshot->GetScale();
+			issueCount = snapshot->GetIssueCount();
+			titleChanged = false;
 
-	return false;
-}
+			string title = "Doom RPG Edit - Mode: " + (mode == MODE_DRAW ? string("Draw") : (mode == MODE_MOVE ? string("Move") : string("Vertex"))) + " - Zoom: " + to_string(int(scale * 100)) + "%";
 
-bool SectorContainsPoint(const Sector &sector, float x, float y)
-{
-	bool oddNodes = false;
-	CNode<Line> *currentLine = sector.firstLine;
+			if (issueCount != 0)
+				title += " - Issues: " + to_string(issueCount);
 
-	for (unsigned int lineCount = sector.lineCount; lineCount-- != 0; currentLine = currentLine->Next())
-	{
-		const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
-		const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
+			if (tabs.size() > 1)
+				title += " - Map " + to_string(activeTab + 1) + "/" + to_string(tabs.size()) + ": " + tabs[activeTab]->GetFilename();
 
-		if ((vertex1->y < y && vertex2->y >= y || vertex2->y < y && vertex1->y >= y) && (vertex1->x <= x || vertex2->x <= x))
-			oddNodes ^= (vertex1->x + (y - vertex1->y) / (vertex2->y - vertex1->y) * (vertex2->x - vertex1->x) < x);
-	}
+			SDL_SetWindowTitle(window, title.c_str());
+		}
 
-	return oddNodes;
-}
+		// Game data arrives in the background, and views are drawn again as
+		// textures and sprites become available.
+		if (gameData->Update())
+		{
+			preview.SetTextureCache(gameData->GetTextureCache());
 
-Selection FindSelection(CList<Sector> *sectors, float x, float y, CNode<Sector> **selectedSector, CNode<Line> **selectedLine, CNode<Vertex> **selectedVertex)
-{
-	if (selectedSector == nullptr && selectedLine == nullptr && selectedVertex == nullptr)
-		return SELECTION_NONE;
+			// Sent as a command so that input logs replay texture changes
+			// the way they were made.
+			if (gameData->GetTextureCache() != nullptr)
+				dispatch({ COMMAND_TEXTURE_COUNT, int(gameData->GetTextureCache()->GetMappings()->textureMappingCount), 0, 0 });
 
-	for (CNode<Sector> *currentSector = sectors->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
-	{
-		if (!AABBContainsPoint(x, y, currentSector->GetData()->minX - 3, currentSector->GetData()->minY - 3, currentSector->GetData()->maxX + 3, currentSector->GetData()->maxY + 3))
-			continue;
+			for (unique_ptr<CMapTab> &tab : tabs)
+				tab->Invalidate();
+		}
 
-		CNode<Line> *currentLine = currentSector->GetData()->firstLine;
+		// Texels are read ahead for whatever the open maps use.
+		vector<unsigned int> wallTextures, textures, things;
 
-		for (unsigned int lineCount = currentSector->GetData()->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+		for (unique_ptr<CMapTab> &tab : tabs)
 		{
-			const Vertex *vertex1 = currentLine->GetData()->vertex1->GetData();
-			const Vertex *vertex2 = currentLine->GetData()->vertex2->GetData();
+			shared_ptr<const CMapSnapshot> tabSnapshot = tab->GetSnapshot();
+			wallTextures.insert(wallTextures.end(), tabSnapshot->GetWallTextures().begin(), tabSnapshot->GetWallTextures().end());
+			things.insert(things.end(), tabSnapshot->GetThingIds().begin(), tabSnapshot->GetThingIds().end());
+			textures.push_back(tabSnapshot->GetHeader().floorTexture);
+			textures.push_back(tabSnapshot->GetHeader().ceilingTexture);
+		}
 
-			if (selectedVertex != nullptr && AABBContainsPoint(x, y, vertex1->x - 2, vertex1->y - 2, vertex1->x + 2, vertex1->y + 2))
-			{
-				*selectedVertex = currentLine->GetData()->vertex1;
-				return SELECTION_VERTEX;
-			}
+		gameData->SetReferenced(wallTextures, textures, things);
 
-			if (selectedVertex != nullptr && AABBContainsPoint(x, y, vertex2->x - 2, vertex2->y - 2, vertex2->x + 2, vertex2->y + 2))
+		if (!loadReported && gameData->IsLoaded())
+		{
+			for (int file = 0; file < ASSET_COUNT; file++)
 			{
-				*selectedVertex = currentLine->GetData()->vertex2;
-				return SELECTION_VERTEX;
+				const AssetTiming &timing = gameData->GetTiming(AssetFile(file));
+				printf("%s: %.1f ms%s\n", timing.filename.c_str(), timing.milliseconds, (timing.loaded ? "" : ", failed"));
 			}
 
-			if (selectedLine != nullptr && AABBContainsSegment(vertex1->x, vertex1->y, vertex2->x, vertex2->y, x - 2, y - 2, x + 2, y + 2))
-			{
-				*selectedLine = currentLine;
-				return SELECTION_LINE;
-			}
+			loadReported = true;
 		}
 
-		if (selectedSector != nullptr && SectorContainsPoint(*currentSector->GetData(), x, y))
-		{
-			*selectedSector = currentSector;
-			return SELECTION_SECTOR;
-		}
-	}
-
-	return SELECTION_NONE;
-}
+		tabs[activeTab]->Render(renderer);
 
-CNode<Line> *FindLine(const CList<Line> *lines, const Vertex *vertex1, const Vertex *vertex2)
-{
-	for (CNode<Line> *currentLine = lines->Head(); currentLine->GetData() != nullptr; currentLine = currentLine->Next())
-	{
-		const Line *line = currentLine->GetData();
+		SDL_RenderPresent(renderer);
 
-		if ((line->vertex1->GetData() == vertex1 && line->vertex2->GetData() == vertex2) || (line->vertex1->GetData() == vertex2 && line->vertex2->GetData() == vertex1))
-			return currentLine;
+		preview.Render(*snapshot);
 	}
 
-	return nullptr;
-}
-
-void ProjectPointOnSegment(const Vertex &vertex1, const Vertex &vertex2, float x, float y, Vertex &vertexOut)
-{
-	float t = ((vertex2.x - vertex1.x) * (x - vertex1.x) + (vertex2.y - vertex1.y) * (y - vertex1.y)) / ((vertex2.x - vertex1.x) * (vertex2.x - vertex1.x) + (vertex2.y - vertex1.y) * (vertex2.y - vertex1.y));
-	vertexOut.x = vertex1.x + (vertex2.x - vertex1.x) * t;
-	vertexOut.y = vertex1.y + (vertex2.y - vertex1.y) * t;
-}
-
-void CalculateSectorAABB(Sector &sector)
-{
-	sector.minX = sector.minY = FLT_MAX;
-	sector.maxX = sector.maxY = -FLT_MAX;
-	CNode<Vertex> *currentVertex = sector.firstVertex;
+	preview.Close();
 
-	for (unsigned int vertexCount = sector.vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
-	{
-		if (currentVertex->GetData()->x < sector.minX)
-			sector.minX = currentVertex->GetData()->x;
+	tabs.clear();
+	pager.reset();
+	gameData.reset();
 
-		if (currentVertex->GetData()->y < sector.minY)
-			sector.minY = currentVertex->GetData()->y;
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroyWindow(window);
 
-		if (currentVertex->GetData()->x > sector.maxX)
-			sector.maxX = currentVertex->GetData()->x;
+	SDL_Quit();
 
-		if (currentVertex->GetData()->y > sector.maxY)
-			sector.maxY = currentVertex->GetData()->y;
-	}
+	return 0;
 }
 
-void InitializeSector(Sector &sector)
+int ValidateMaps(const vector<const char *> &filenames)
 {
-	sector = Sector();
-	sector.vertexCount = 0;
-	sector.lineCount = 0;
-	sector.minX = sector.minY = FLT_MAX;
-	sector.maxX = sector.maxY = -FLT_MAX;
-}
+	int result = 0;
+	CThreadPool pool;
+	CValidator validator(pool);
+	validator.AddDefaultChecks();
 
-void CancelSector(CMap &map, Sector &sector)
-{
-	if (sector.lineCount > 0)
+	for (const char *filename : filenames)
 	{
-		map.GetVertices()->Delete(sector.firstVertex, sector.lastVertex->Next());
-		map.GetLines()->Delete(sector.firstLine, sector.lastLine->Next());
-	}
-	else
-		map.GetVertices()->Delete(sector.firstVertex);
-}
+		CMap map;
+		map.Read(filename);
 
-void DeleteSector(CMap &map, CNode<Sector> &sector)
-{
-	CNode<Line> *currentLine = sector.GetData()->firstLine;
+		validator.Validate(map, 0, 0, CHUNK_SIZE, CHUNK_SIZE);
 
-	for (unsigned int lineCount = sector.GetData()->lineCount; lineCount-- != 0; currentLine = currentLine->Next())
-	{
-		if (currentLine->GetRefCount() == 2)
-		{
-			if (currentLine->GetData()->sectors[0] == sector.GetData())
-			{
-				CNode<Vertex> *currentVertex = currentLine->GetData()->sectors[1]->firstVertex;
+		bool writesBack = WritesBack(map, filename);
 
-				for (unsigned int vertexCount = currentLine->GetData()->sectors[1]->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
-				{
-					if (currentVertex->GetData() == currentLine->GetData()->vertex2->GetData())
-					{
-						currentLine->GetData()->vertex1 = currentVertex;
-						currentLine->GetData()->vertex2 = (vertexCount != 0 ? currentVertex->Next() : currentLine->GetData()->sectors[1]->firstVertex);
+		if (!writesBack)
+			printf("%s: writing the map back does not give the bytes it was read from\n", filename);
 
-						break;
-					}
-				}
+		for (const ValidationIssue &issue : validator.GetIssues())
+			printf("%s: %s %u: %s\n", filename, (issue.type == ELEMENT_LINE ? "line" : (issue.type == ELEMENT_SECTOR ? "sector" : "thing")), issue.handle, issue.message.c_str());
 
-				currentLine->GetData()->sectors[0] = currentLine->GetData()->sectors[1];
-				currentLine->GetData()->sectors[1] = nullptr;
-			}
-			else
-				currentLine->GetData()->sectors[1] = nullptr;
-		}
-	}
+		CReachability reachability(map);
+		reachability.Analyze();
 
-	map.GetVertices()->Delete(sector.GetData()->firstVertex, sector.GetData()->lastVertex->Next());
-	map.GetLines()->Delete(sector.GetData()->firstLine, sector.GetData()->lastLine->Next());
-	map.GetSectors()->Delete(&sector);
-}
-
-CNode<Vertex> *InsertVertex(CMap &map, Vertex &vertex)
-{
-	CNode<Vertex> *selectedVertex = nullptr;
-	CNode<Line> *selectedLine = nullptr;
-	Selection selection = FindSelection(map.GetSectors(), vertex.x, vertex.y, nullptr, &selectedLine, &selectedVertex);
+		if (!reachability.HasStart())
+			printf("%s: player start %u is outside the map or not passable\n", filename, unsigned(map.GetHeader().playerPosition));
 
-	if (selection == SELECTION_VERTEX)
-		return map.GetVertices()->Insert(selectedVertex);
-	else if (selection == SELECTION_LINE)
-	{
-		Line *line = selectedLine->GetData();
-		Vertex *newVertex = new Vertex;
-		ProjectPointOnSegment(*line->vertex1->GetData(), *line->vertex2->GetData(), vertex.x, vertex.y, *newVertex);
-		CNode<Vertex> *newVertexNode = map.GetVertices()->Insert(newVertex, true, line->vertex1);
-		Line *newLine = new Line;
-		newLine->vertex1 = line->vertex1;
-		newLine->vertex2 = newVertexNode;
-		newLine->sectors[0] = line->sectors[0];
-		newLine->sectors[1] = line->sectors[1];
-		line->vertex1 = newVertexNode;
-		CNode<Line> *newLineNode = map.GetLines()->Insert(newLine, true, selectedLine->Prev());
-
-		line->sectors[0]->vertexCount++;
-		line->sectors[0]->lineCount++;
-
-		if (selectedLine == line->sectors[0]->firstLine)
-			line->sectors[0]->firstLine = newLineNode;
-		else if (selectedLine == line->sectors[0]->lastLine)
-			line->sectors[0]->lastVertex = newVertexNode;
-
-		return map.GetVertices()->Insert(newVertexNode);
-	}
-	else
-		return map.GetVertices()->Insert(new Vertex(vertex));
-}
+		for (const ThingReachability &thing : reachability.GetThings())
+		{
+			if (thing.layer < 0)
+				printf("%s: unreachable thing 0x%02X at block (%d, %d)\n", filename, thing.id, thing.cellX, thing.cellY);
+		}
 
-CNode<Line> *InsertLine(CMap &map, Line &line)
-{
-	CNode<Line> *newLineNode;
+		printf("%s: %u of %u things unreachable, %u key layers\n", filename, reachability.GetUnreachableCount(), unsigned(reachability.GetThings().size()), reachability.GetLayerCount());
 
-	if (line.vertex1->GetRefCount() > 1 && line.vertex2->GetRefCount() > 1)
-	{
-		CNode<Line> *refLineNode = FindLine(map.GetLines(), line.vertex1->GetData(), line.vertex2->GetData());
-
-		if (refLineNode != nullptr)
-			newLineNode = map.GetLines()->Insert(refLineNode);
-		else
-			newLineNode = map.GetLines()->Insert(new Line(line));
+		if (!writesBack || !reachability.HasStart() || reachability.GetUnreachableCount() != 0 || !validator.GetIssues().empty())
+			result = 1;
 	}
-	else
-		newLineNode = map.GetLines()->Insert(new Line(line));
 
-	return newLineNode;
+	return result;
 }
 
-CNode<Sector> *InsertSector(CMap &map, Sector &sector)
+// A map that has not been edited must be written back exactly as it was
+// read.
+bool WritesBack(const CMap &map, const char *filename)
 {
-	if (!SectorIsClockwise(sector))
-	{
-		CNode<Vertex> *tempVertexNode = sector.firstVertex->Next();
+	MapImage image;
+	map.Capture(image);
 
-		map.GetVertices()->Reverse(sector.firstVertex->Next(), sector.lastVertex->Next());
-		map.GetLines()->Reverse(sector.firstLine, sector.lastLine->Next());
+	FILE *written = tmpfile();
+	FILE *original = fopen(filename, "rb");
+	bool same = (written != nullptr && original != nullptr && CMap::WriteImage(image, written) && fseek(written, 0, SEEK_SET) == 0);
 
-		sector.lastVertex = tempVertexNode;
-
-		CNode<Line> *tempLineNode = sector.firstLine;
-		sector.firstLine = sector.lastLine;
-		sector.lastLine = tempLineNode;
-
-		CNode<Line> *currentLine = sector.firstLine;
+	while (same)
+	{
+		int byte = fgetc(original);
 
-		for (unsigned int lineCount = sector.lineCount; lineCount-- != 0; currentLine = currentLine->Next())
-		{
-			if (currentLine->GetRefCount() == 1)
-			{
-				tempVertexNode = currentLine->GetData()->vertex1;
-				currentLine->GetData()->vertex1 = currentLine->GetData()->vertex2;
-				currentLine->GetData()->vertex2 = tempVertexNode;
-			}
-		}
+		if (byte != fgetc(written))
+			same = false;
+		else if (byte == EOF)
+			break;
 	}
 
-	Sector *newSector = new Sector(sector);
+	if (written != nullptr)
+		fclose(written);
 
-	CNode<Line> *currentLine = sector.firstLine;
+	if (original != nullptr)
+		fclose(original);
 
-	for (unsigned int lineCount = sector.lineCount; lineCount-- != 0; currentLine = currentLine->Next())
-	{
-		if (currentLine->GetRefCount() == 1)
-			currentLine->GetData()->sectors[0] = newSector;
-		else
-			currentLine->GetData()->sectors[1] = newSector;
-	}
-
-	return map.GetSectors()->Insert(newSector);
+	return same;
 }
 
-void CloseSector(CMap &map, Sector &sector, Line &line)
+// Applies the commands of an input log to the map as fast as they can be
+// processed, publishing a snapshot after each one as the editor would when
+// keeping up with input, and reports how long each kind of command took.
+int ReplayLog(const char *logFilename, const char *mapFilename)
 {
-	line.vertex2 = sector.firstVertex;
-
-	sector.vertexCount = (sector.vertexCount + 1) / 2;
-	sector.lineCount++;
-	sector.lastLine = InsertLine(map, line);
+	CInputLog log;
 
-	InsertSector(map, sector);
-}
-
-void MoveVertex(Vertex &vertex, int x, int y, CGrid &grid)
-{
-	vertex.x = float(x);
-	vertex.y = float(y);
+	if (!log.Read(logFilename))
+	{
+		printf("Failed to read input log %s\n", logFilename);
 
-	grid.Snap(vertex.x, vertex.y);
-}
+		return 1;
+	}
 
-void MoveLine(Line &line, int x, int y, int referenceX, int referenceY, int &initialX, int &initialY, float scaleInverse, CGrid &grid)
-{
-	int finalX = (x - referenceX) / grid.GetScaledCellSize() * grid.GetScaledCellSize();
-	int finalY = (y - referenceY) / grid.GetScaledCellSize() * grid.GetScaledCellSize();
+	CThreadPool pool;
+	CValidator validator(pool);
+	validator.AddDefaultChecks();
 
-	int xDisplacement = finalX - initialX, yDisplacement = finalY - initialY;
+	CEditor editor(log.GetWidth(), log.GetHeight());
+	editor.SetValidator(&validator);
 
-	line.vertex1->GetData()->x += xDisplacement * scaleInverse;
-	line.vertex1->GetData()->y += yDisplacement * scaleInverse;
-	line.vertex2->GetData()->x += xDisplacement * scaleInverse;
-	line.vertex2->GetData()->y += yDisplacement * scaleInverse;
+	if (mapFilename != nullptr)
+		editor.GetMap().Read(mapFilename);
 
-	initialX = finalX;
-	initialY = finalY;
-}
+	editor.PublishSnapshot();
 
-void MoveSector(Sector &sector, int x, int y, int referenceX, int referenceY, int &initialX, int &initialY, float scaleInverse, CGrid &grid)
-{
-	int finalX = (x - referenceX) / grid.GetScaledCellSize() * grid.GetScaledCellSize();
-	int finalY = (y - referenceY) / grid.GetScaledCellSize() * grid.GetScaledCellSize();
+	if (editor.GetVersion()->Hash() != log.GetMapHash())
+	{
+		printf("%s: map does not match the one %s was recorded with\n", (mapFilename != nullptr ? mapFilename : "untitled"), logFilename);
 
-	int xDisplacement = finalX - initialX, yDisplacement = finalY - initialY;
+		return 1;
+	}
 
-	CNode<Line> *currentLine = sector.firstLine;
+	const char *names[] = { "quit", "key down", "button down", "button up", "motion", "wheel", "resize", "copy", "paste", "texture count", "publish" };
+	const int publish = COMMAND_COUNT;
+	vector<double> latencies[publish + 1];
 
-	for (unsigned int lineCount = sector.lineCount; lineCount-- != 0; currentLine = currentLine->Next())
+	for (const RecordedCommand &recorded : log.GetCommands())
 	{
-		Vertex *vertex = (currentLine->GetData()->sectors[0] == &sector ? currentLine->GetData()->vertex1->GetData() : currentLine->GetData()->vertex2->GetData());
-		vertex->x += xDisplacement * scaleInverse;
-		vertex->y += yDisplacement * scaleInverse;
-	}
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		editor.ProcessCommand(recorded.command);
+		chrono::steady_clock::time_point processed = chrono::steady_clock::now();
 
-	sector.minX += xDisplacement * scaleInverse;
-	sector.minY += yDisplacement * scaleInverse;
-	sector.maxX += xDisplacement * scaleInverse;
-	sector.maxY += yDisplacement * scaleInverse;
+		latencies[recorded.command.type].push_back(chrono::duration<double, milli>(processed - start).count());
 
-	initialX = finalX;
-	initialY = finalY;
-}
+		if (!editor.IsRunning())
+			break;
 
-void RecalculateSectorsAABB(CMap &map, CNode<Vertex> &vertex)
-{
-	unsigned int refCount = vertex.GetRefCount();
-	bool allReferencesFound = false;
+		editor.PublishSnapshot();
+		latencies[publish].push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - processed).count());
+	}
 
-	for (CNode<Sector> *currentSector = map.GetSectors()->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+	for (int type = 0; type <= publish; type++)
 	{
-		CNode<Vertex> *currentVertex = currentSector->GetData()->firstVertex;
+		vector<double> &times = latencies[type];
 
-		for (unsigned int vertexCount = currentSector->GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
-		{
-			if (currentVertex->GetData() == vertex.GetData())
-			{
-				allReferencesFound = (--refCount == 0);
+		if (times.empty())
+			continue;
 
-				CalculateSectorAABB(*currentSector->GetData());
+		sort(times.begin(), times.end());
 
-				break;
-			}
-		}
-
-		if (allReferencesFound)
-			break;
+		size_t last = times.size() - 1;
+		printf("%-12s %7zu  p50 %8.3f ms  p90 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n", names[type], times.size(), times[last * 50 / 100], times[last * 90 / 100], times[last * 99 / 100], times[last]);
 	}
+
+	// Equal for every replay of the same log, so a changed result means the
+	// editor no longer behaves the same.
+	printf("final map hash %016llx\n", (unsigned long long)editor.GetVersion()->Hash());
+
+	return 0;
 }
 
-void RecalculateSectorsAABB(CMap &map, CNode<Line> &line)
+void ReportTexelResidency(const CGameData &gameData)
 {
-	unsigned int refCount = line.GetData()->vertex1->GetRefCount() + line.GetData()->vertex2->GetRefCount();
-	bool allReferencesFound = false;
+	const char *kinds[] = { "texture", "sprite" };
+	const CTexelStore *stores[] = { &gameData.GetTextureTexelStore(), &gameData.GetSpriteTexelStore() };
 
-	for (CNode<Sector> *currentSector = map.GetSectors()->Head(); currentSector->GetData() != nullptr; currentSector = currentSector->Next())
+	for (int i = 0; i < 2; i++)
 	{
-		CNode<Vertex> *currentVertex = currentSector->GetData()->firstVertex;
+		size_t residentSize = 0, referencedSize = 0;
 
-		for (unsigned int vertexCount = currentSector->GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
+		for (unsigned int id : stores[i]->GetReferenced())
 		{
-			if (currentVertex->GetData() == line.GetData()->vertex1->GetData())
-			{
-				allReferencesFound = (--refCount == 0);
-
-				if ((currentVertex != currentSector->GetData()->lastVertex && currentVertex->Next()->GetData() == line.GetData()->vertex2->GetData()) ||
-					(currentSector->GetData()->firstVertex->GetData() == line.GetData()->vertex2->GetData()) ||
-					(currentVertex != currentSector->GetData()->firstVertex && currentVertex->Prev()->GetData() == line.GetData()->vertex2->GetData()) ||
-					(currentSector->GetData()->lastVertex->GetData() == line.GetData()->vertex2->GetData()))
-					allReferencesFound = (--refCount == 0);
-
-				CalculateSectorAABB(*currentSector->GetData());
-
-				break;
-			}
-			else if (currentVertex->GetData() == line.GetData()->vertex2->GetData())
-			{
-				allReferencesFound = (--refCount == 0);
-
-				if ((currentVertex != currentSector->GetData()->lastVertex && currentVertex->Next()->GetData() == line.GetData()->vertex1->GetData()) ||
-					(currentSector->GetData()->firstVertex->GetData() == line.GetData()->vertex1->GetData()) ||
-					(currentVertex != currentSector->GetData()->firstVertex && currentVertex->Prev()->GetData() == line.GetData()->vertex1->GetData()) ||
-					(currentSector->GetData()->lastVertex->GetData() == line.GetData()->vertex1->GetData()))
-					allReferencesFound = (--refCount == 0);
+			if (id >= stores[i]->GetCount())
+				continue;
 
-				CalculateSectorAABB(*currentSector->GetData());
+			size_t size = stores[i]->GetResidentSize(id);
+			printf("%s %u: %zu of %u bytes resident\n", kinds[i], id, size, stores[i]->GetRange(id).size);
 
-				break;
-			}
+			residentSize += size;
+			referencedSize += stores[i]->GetRange(id).size;
 		}
 
-		if (allReferencesFound)
-			break;
+		printf("%u %ss referenced: %zu of %zu bytes resident, %zu bytes of texels mapped\n", unsigned(stores[i]->GetReferenced().size()), kinds[i], residentSize, referencedSize, stores[i]->GetSize());
 	}
+
+	if (gameData.GetTextureCache() != nullptr)
+		printf("decoded textures: %zu bytes\n", gameData.GetTextureCache()->GetMemoryUsage());
 }
 
-void RecalculateSectorsAABB(CMap &map, CNode<Sector> &sector)
+bool TranslateEvent(const SDL_Event &event, Command &command)
 {
-	unsigned int refCount = 0;
-	bool allReferencesFound = false;
-	bool sectorReferencesVertices = false;
-	CNode<Vertex> *currentVertex = sector.GetData()->firstVertex;
+	command.key = 0;
+	command.x = 0;
+	command.y = 0;
 
-	for (unsigned int vertexCount = sector.GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
-		refCount += currentVertex->GetRefCount() - 1;
-
-	if (refCount > 0)
+	switch (event.type)
 	{
-		for (CNode<Sector> *currentSector = map.GetSectors()->Head(); sector.GetData() != nullptr; currentSector = currentSector->Next())
-		{
-			if (currentSector == &sector)
-				continue;
-
-			CNode<Vertex> *currentVertex = currentSector->GetData()->firstVertex;
-
-			for (unsigned int vertexCount = currentSector->GetData()->vertexCount; vertexCount-- != 0; currentVertex = currentVertex->Next())
-			{
-				CNode<Vertex> *currentSelectedVertex = sector.GetData()->firstVertex;
-
-				for (unsigned int selectedVertexCount = sector.GetData()->vertexCount; selectedVertexCount-- != 0; currentSelectedVertex = currentSelectedVertex->Next())
-				{
-					if (currentVertex->GetData() == currentSelectedVertex->GetData())
-					{
-						allReferencesFound = (--refCount == 0);
-						sectorReferencesVertices = true;
-
-						if (allReferencesFound)
-							break;
-					}
-				}
-
-				if (allReferencesFound)
-					break;
-			}
+	case SDL_QUIT:
+		command.type = COMMAND_QUIT;
+		return true;
+	case SDL_KEYDOWN:
+		command.type = COMMAND_KEY_DOWN;
+		command.key = event.key.keysym.sym;
 
-			if (sectorReferencesVertices)
-			{
-				CalculateSectorAABB(*currentSector->GetData());
-				sectorReferencesVertices = false;
-			}
+		if ((event.key.keysym.mod & KMOD_CTRL) != 0 && command.key == SDLK_c)
+			command.type = COMMAND_COPY;
+		else if ((event.key.keysym.mod & KMOD_CTRL) != 0 && command.key == SDLK_v)
+			command.type = COMMAND_PASTE;
 
-			if (allReferencesFound)
-				break;
+		SDL_GetMouseState(&command.x, &command.y);
+		return true;
+	case SDL_MOUSEBUTTONDOWN:
+		command.type = COMMAND_BUTTON_DOWN;
+		command.key = event.button.button;
+		command.x = event.button.x;
+		command.y = event.button.y;
+		return true;
+	case SDL_MOUSEBUTTONUP:
+		command.type = COMMAND_BUTTON_UP;
+		command.key = event.button.button;
+		command.x = event.button.x;
+		command.y = event.button.y;
+		return true;
+	case SDL_MOUSEMOTION:
+		command.type = COMMAND_MOTION;
+		command.x = event.motion.x;
+		command.y = event.motion.y;
+		return true;
+	case SDL_MOUSEWHEEL:
+		command.type = COMMAND_WHEEL;
+		command.key = event.wheel.y;
+		SDL_GetMouseState(&command.x, &command.y);
+		return true;
+	case SDL_WINDOWEVENT:
+		if (event.window.event == SDL_WINDOWEVENT_CLOSE)
+		{
+			command.type = COMMAND_QUIT;
+			return true;
 		}
+		else if (event.window.event != SDL_WINDOWEVENT_SIZE_CHANGED)
+			return false;
+
+		command.type = COMMAND_RESIZE;
+		command.x = event.window.data1;
+		command.y = event.window.data2;
+		return true;
+	default:
+		return false;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+// drpge
+// Copyright(C) 2020-2022 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../CAssetPack.h"
+
+using namespace std;
+
+// Packs the game data files and any maps given into one file that the
+// editor maps with -pack. Maps are stored under their file names.
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		printf("usage: drpgpack output.pak datadir [map.bsp ...]\n");
+		return 1;
+	}
+
+	static const char *dataFiles[] = { "mappings.bin", "wtexels.bin", "palettes.bin", "bitshapes.bin", "stexels.bin", "entities.db", "strings.bin" };
+
+	vector<PackSource> sources;
+	string directory = string(argv[2]) + "/";
+
+	for (const char *dataFile : dataFiles)
+		sources.push_back({ dataFile, directory + dataFile });
+
+	for (int i = 3; i < argc; i++)
+	{
+		const char *name = argv[i];
+
+		for (const char *c = argv[i]; *c != '\0'; c++)
+		{
+			if (*c == '/' || *c == '\\')
+				name = c + 1;
+		}
+
+		sources.push_back({ name, argv[i] });
+	}
+
+	if (!CAssetPack::Write(argv[1], sources))
+	{
+		printf("failed to write %s\n", argv[1]);
+		return 1;
+	}
+
+	CAssetPack pack;
+
+	if (!pack.Open(argv[1]))
+	{
+		printf("failed to read back %s\n", argv[1]);
+		return 1;
+	}
+
+	for (unsigned int i = 0; i < pack.GetEntryCount(); i++)
+		printf("%3u %-32s %10llu bytes at %llu\n", i, pack.GetEntry(i)->name, (unsigned long long)pack.GetEntry(i)->size, (unsigned long long)pack.GetEntry(i)->offset);
+
+	return 0;
+}
\ No newline at end of file